@@ -0,0 +1,54 @@
+// Measures the throughput of the array kernels on each instruction set the CPU supports.
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+#include "ArrayKernels.h"
+
+namespace {
+
+constexpr int kRepetitions = 20;
+
+template<typename Kernel>
+double Throughput(size_t bytes, Kernel kernel) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < kRepetitions; ++i) {
+        kernel();
+    }
+    auto finish = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(finish - start).count();
+    return static_cast<double>(bytes) * kRepetitions / seconds / (1 << 20);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    size_t count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+    std::vector<int64_t> a(count, 3), b(count, 5), out(count);
+    std::vector<double> x(count, 0.5), y(count, 1.5);
+    size_t bytes = count * sizeof(int64_t);
+    const char* names[] = {"scalar", "sse", "avx2"};
+    for (auto set : {ArrayKernels::InstructionSet::kScalar, ArrayKernels::InstructionSet::kSse,
+                     ArrayKernels::InstructionSet::kAvx2}) {
+        ArrayKernels::Select(set);
+        if (ArrayKernels::Selected() != set) {
+            continue;
+        }
+        volatile double sink = 0;
+        std::cout << names[static_cast<int>(set)] << ":"
+                  << " v+ " << Throughput(3 * bytes, [&] {
+                      ArrayKernels::Add(a.data(), b.data(), out.data(), count);
+                  }) << " MB/s,"
+                  << " vsum " << Throughput(bytes, [&] {
+                      sink = sink + ArrayKernels::Sum(a.data(), count);
+                  }) << " MB/s,"
+                  << " fvaxpy " << Throughput(3 * bytes, [&] {
+                      ArrayKernels::Axpy(0.5, x.data(), y.data(), count);
+                  }) << " MB/s,"
+                  << " fvdot " << Throughput(2 * bytes, [&] {
+                      sink = sink + ArrayKernels::Dot(x.data(), y.data(), count);
+                  }) << " MB/s\n";
+    }
+}
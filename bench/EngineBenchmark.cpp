@@ -0,0 +1,51 @@
+// Compares the plain stack engine of the VirtualMachine with the engine caching
+// the top of stack in a local variable, on arithmetic-heavy loops. The JIT is off, since it would
+// replace the loops with native code on either engine.
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "Compiler.h"
+
+namespace {
+
+struct Program {
+    const char* name;
+    std::string source;
+};
+
+// Compiles the program for the interpreter, with the top of stack cached or not, and runs it,
+// returning the time in milliseconds.
+double Run(const std::string& source, bool cache_top_of_stack) {
+    CompilerOptions options;
+    options.use_jit = false;
+    options.cache_top_of_stack = cache_top_of_stack;
+    auto program = Compiler(options).Compile(source);
+    auto context = program->NewContext();
+    auto start = std::chrono::steady_clock::now();
+    program->Run(*context);
+    auto finish = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(finish - start).count();
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::string iterations = argc > 1 ? argv[1] : "5000000";
+    std::vector<Program> programs = {
+        {"sum of squares", ": squares 0 1 " + iterations + " 0 DO I dup * + LOOP ; squares ."},
+        {"countdown", ": countdown 0 " + iterations + " BEGIN dup 0 > WHILE swap over + swap 1 - REPEAT drop ;"
+                      " countdown ."},
+        {"polynomial", ": poly 0 1 " + iterations + " 0 DO I 3 * 7 + I * 1023 and + LOOP ; poly ."},
+        {"modulus", ": mods 0 " + iterations + " BEGIN dup WHILE swap over 7 % + swap 1 - REPEAT drop ; mods ."},
+    };
+    for (const auto& program : programs) {
+        std::cout << program.name << ": ";
+        double stack_ms = Run(program.source, false);
+        std::cout << " ";
+        double cached_ms = Run(program.source, true);
+        std::cout << "\n    stack " << stack_ms << " ms, top of stack cache " << cached_ms
+                  << " ms, speedup " << stack_ms / cached_ms << "x\n";
+    }
+}
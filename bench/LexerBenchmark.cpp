@@ -0,0 +1,84 @@
+// Measures the throughput of the SourceScanner alone and of the whole lexer in MB/s on a large
+// generated program, for each instruction set the CPU supports, checking that all of them produce
+// the same lexemes.
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include "Compiler.h"
+#include "SourceScanner.h"
+
+namespace {
+
+constexpr int kRepetitions = 10;
+
+// Words with stack comments, line comments, strings and literals, like generated code.
+std::string Generate(size_t words) {
+    std::string source;
+    for (size_t i = 0; i < words; ++i) {
+        std::string name = "word" + std::to_string(i);
+        source += ": " + name + " ( a b -- c ) \\ generated\n";
+        source += "    dup * swap 3 + over ( keep it ) - 1.5 drop\n";
+        source += "    IF s\"" + name + " (taken)\" type ELSE 42 . ENDIF ;\n";
+    }
+    return source;
+}
+
+// Classifies the source kRepetitions times, returning the seconds taken and a checksum of the masks.
+double Classify(const std::string& source, uint64_t& checksum) {
+    SourceScanner::Block blocks[SourceScanner::kBatchBlocks];
+    constexpr size_t kBatchBytes = SourceScanner::kBlockSize * SourceScanner::kBatchBlocks;
+    checksum = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < kRepetitions; ++i) {
+        for (size_t offset = 0; offset < source.size(); offset += kBatchBytes) {
+            size_t size = std::min(kBatchBytes, source.size() - offset);
+            SourceScanner::Classify(source.data() + offset, size, blocks);
+            for (size_t block = 0; block * SourceScanner::kBlockSize < size; ++block) {
+                checksum += std::popcount(blocks[block].whitespace) + blocks[block].open + blocks[block].quote;
+            }
+        }
+    }
+    auto finish = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(finish - start).count();
+}
+
+double MegabytesPerSecond(const std::string& source, double seconds) {
+    return static_cast<double>(source.size()) * kRepetitions / seconds / (1 << 20);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    size_t words = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 100000;
+    std::string source = Generate(words);
+    Compiler compiler;
+    size_t lexemes = 0;
+    const char* names[] = {"scalar", "sse", "avx2"};
+    for (auto set : {ArrayKernels::InstructionSet::kScalar, ArrayKernels::InstructionSet::kSse,
+                     ArrayKernels::InstructionSet::kAvx2}) {
+        SourceScanner::Select(set);
+        if (SourceScanner::Selected() != set) {
+            continue;
+        }
+        uint64_t checksum = 0;
+        double classify_seconds = Classify(source, checksum);
+        size_t count = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < kRepetitions; ++i) {
+            count = compiler.Lex(source).GetResult().size();
+        }
+        auto finish = std::chrono::steady_clock::now();
+        double seconds = std::chrono::duration<double>(finish - start).count();
+        if (lexemes != 0 && count != lexemes) {
+            std::cout << names[static_cast<int>(set)] << " found " << count << " lexemes instead of " << lexemes << '\n';
+        }
+        lexemes = count;
+        std::cout << names[static_cast<int>(set)] << ": classify " << MegabytesPerSecond(source, classify_seconds)
+                  << " MB/s (checksum " << checksum << "), lex " << MegabytesPerSecond(source, seconds) << " MB/s, "
+                  << count << " lexemes in " << source.size() / (1 << 20) << " MB\n";
+    }
+}
@@ -0,0 +1,135 @@
+// Compares the std::variant based stack element the interpreter used to have
+// with the tagged StackElement stored in a DataStack.
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <variant>
+#include <vector>
+#include "DataStack.h"
+#include "StackElement.h"
+
+namespace {
+
+struct VariantElement {
+    std::variant<int64_t, double> value;
+
+    template<typename T>
+    VariantElement(T other) : value(other) {
+    }
+
+    VariantElement operator+(const VariantElement& other) const {
+        return std::visit([](auto a, auto b) {
+            return VariantElement(a + b);
+        }, value, other.value);
+    }
+
+    VariantElement operator*(const VariantElement& other) const {
+        return std::visit([](auto a, auto b) {
+            return VariantElement(a * b);
+        }, value, other.value);
+    }
+
+    VariantElement operator<(const VariantElement& other) const {
+        auto result = std::visit([](auto a, auto b) {
+            return a < b;
+        }, value, other.value);
+        return VariantElement(static_cast<int64_t>(result));
+    }
+
+    double ToDouble() const {
+        return std::visit([](auto a) {
+            return static_cast<double>(a);
+        }, value);
+    }
+};
+
+class VariantStack {
+public:
+    VariantElement Pop() {
+        auto result = stack_.back();
+        stack_.pop_back();
+        return result;
+    }
+
+    void Push(VariantElement element) {
+        stack_.push_back(element);
+    }
+
+private:
+    std::vector<VariantElement> stack_;
+};
+
+class TaggedStack {
+public:
+    StackElement Pop() {
+        auto result = stack_.back();
+        stack_.pop_back();
+        return result;
+    }
+
+    void Push(StackElement element) {
+        stack_.push_back(element);
+    }
+
+private:
+    DataStack stack_;
+};
+
+// Runs "x i + i * x <" style traffic: every operation pops two cells and pushes one.
+template<typename Stack, typename Element, typename T>
+double Run(int64_t iterations, T seed, double& checksum) {
+    Stack stack;
+    stack.Push(Element(seed));
+    auto start = std::chrono::steady_clock::now();
+    for (int64_t i = 0; i < iterations; ++i) {
+        stack.Push(Element(static_cast<T>(i & 7)));
+        auto b = stack.Pop();
+        auto a = stack.Pop();
+        stack.Push(a + b);
+        stack.Push(Element(static_cast<T>(3)));
+        b = stack.Pop();
+        a = stack.Pop();
+        auto product = a * b;
+        stack.Push(product);
+        stack.Push(Element(static_cast<T>(1)));
+        b = stack.Pop();
+        a = stack.Pop();
+        stack.Push(a < b);
+        a = stack.Pop();
+        stack.Push(product + a);
+        b = stack.Pop();
+        stack.Push(Element(static_cast<T>(i & 1023)));
+        a = stack.Pop();
+        stack.Push(a);
+        stack.Pop();
+        stack.Push(Element(static_cast<T>(b.ToDouble() > 1e6 ? 1 : b.ToDouble())));
+    }
+    auto finish = std::chrono::steady_clock::now();
+    checksum += stack.Pop().ToDouble();
+    return std::chrono::duration<double, std::nano>(finish - start).count() / iterations;
+}
+
+void Report(const char* name, double variant_ns, double tagged_ns) {
+    std::cout << name << ": variant " << variant_ns << " ns/iteration, tagged "
+              << tagged_ns << " ns/iteration, speedup " << variant_ns / tagged_ns << "x\n";
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    int64_t iterations = argc > 1 ? std::stoll(argv[1]) : 20000000;
+    double checksum = 0;
+
+    std::cout << "bytes per stack slot: variant " << sizeof(VariantElement)
+              << ", tagged " << sizeof(StackElement::Cell) + sizeof(StackElement::Type) << "\n";
+
+    Report("int/int",
+           Run<VariantStack, VariantElement, int64_t>(iterations, 1, checksum),
+           Run<TaggedStack, StackElement, int64_t>(iterations, 1, checksum));
+    Report("double/double",
+           Run<VariantStack, VariantElement, double>(iterations, 1.5, checksum),
+           Run<TaggedStack, StackElement, double>(iterations, 1.5, checksum));
+
+    std::cout << "checksum " << checksum << "\n";
+}
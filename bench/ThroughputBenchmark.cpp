@@ -0,0 +1,67 @@
+// Compiles one program once and runs it on 1, 2, 4, ... threads up to the number of hardware threads,
+// every run on a context of its own, reporting runs per second for each thread count.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Compiler.h"
+
+namespace {
+
+// Runs the program runs times on each of threads threads, returning the time in milliseconds.
+double Run(const CompiledProgram& program, int64_t expected, unsigned threads, int runs) {
+    std::atomic<int> wrong = 0;
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for (unsigned i = 0; i < threads; ++i) {
+        workers.emplace_back([&] {
+            for (int run = 0; run < runs; ++run) {
+                auto context = program.NewContext();
+                program.Run(*context);
+                if (context->stack.empty() || context->stack.back().Convert<int64_t>() != expected) {
+                    ++wrong;
+                }
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    auto finish = std::chrono::steady_clock::now();
+    if (wrong > 0) {
+        std::cout << wrong.load() << " runs computed a wrong result\n";
+    }
+    return std::chrono::duration<double, std::milli>(finish - start).count();
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    int runs = argc > 1 ? std::stoi(argv[1]) : 200;
+    int64_t iterations = 100000;
+    std::string source = "VARIABLE total : add ( n -- ) total @ + total ! ; 0 total ! 1 " +
+                         std::to_string(iterations) + " 0 DO I add LOOP total @";
+    int64_t expected = iterations * (iterations - 1) / 2;
+
+    auto program = Compiler().Compile(source);
+
+    unsigned hardware_threads = std::max(std::thread::hardware_concurrency(), 1u);
+    std::vector<unsigned> thread_counts;
+    for (unsigned threads = 1; threads < hardware_threads; threads *= 2) {
+        thread_counts.push_back(threads);
+    }
+    thread_counts.push_back(hardware_threads);
+    double single_rate = 0;
+    for (auto threads : thread_counts) {
+        double ms = Run(*program, expected, threads, runs);
+        double rate = threads * runs / ms * 1000;
+        if (threads == 1) {
+            single_rate = rate;
+        }
+        std::cout << threads << " threads: " << rate << " runs/s, " << rate / single_rate << "x of one thread\n";
+    }
+}
@@ -0,0 +1,20 @@
+# forth_add_program(<target> <source.fs>)
+#
+# Translates a Forth program to C++ with `forth_interpretator --emit-cpp` and builds it
+# into a native executable linked against the interpreter runtime.
+function(forth_add_program target source)
+    get_filename_component(source_path ${source} ABSOLUTE)
+    set(generated ${CMAKE_CURRENT_BINARY_DIR}/${target}.cpp)
+    add_custom_command(
+            OUTPUT ${generated}
+            COMMAND forth_interpretator --emit-cpp ${generated} ${source_path}
+            DEPENDS forth_interpretator ${source_path}
+            COMMENT "Translating ${source} to C++"
+            VERBATIM
+    )
+    add_executable(${target} ${generated})
+    target_link_libraries(${target} PRIVATE forth_runtime)
+    # the generated code includes the C++20 runtime headers, also in projects using an older standard
+    target_compile_features(${target} PRIVATE cxx_std_20)
+    target_compile_options(${target} PRIVATE -O3)
+endfunction()
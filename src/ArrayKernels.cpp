@@ -0,0 +1,356 @@
+#include "ArrayKernels.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+
+#if defined(__GNUC__)
+// GCC vector extensions; the same code is compiled for every instruction set
+#define FORTH_VECTOR_KERNELS 1
+// vectors are returned only from lambdas inlined into the kernels, so the ABI of returning them does not matter
+#pragma GCC diagnostic ignored "-Wpsabi"
+#else
+#define FORTH_VECTOR_KERNELS 0
+#endif
+
+namespace {
+
+// Accumulators of reductions, independent of the instruction set so that all give the same result.
+constexpr size_t kLanes = 8;
+
+// Elements of one vector, the width of an AVX2 register.
+constexpr size_t kVectorLanes = 4;
+
+// Integer arithmetic is done on unsigned cells, so that overflow wraps around.
+template<typename T>
+using Arithmetic = std::conditional_t<std::is_integral_v<T>, uint64_t, T>;
+
+#if FORTH_VECTOR_KERNELS
+typedef uint64_t UnsignedLanes __attribute__((vector_size(kVectorLanes * sizeof(uint64_t))));
+typedef int64_t IntegerLanes __attribute__((vector_size(kVectorLanes * sizeof(int64_t))));
+typedef double FloatLanes __attribute__((vector_size(kVectorLanes * sizeof(double))));
+
+template<typename T>
+struct LanesOf;
+
+template<>
+struct LanesOf<uint64_t> {
+    using Type = UnsignedLanes;
+};
+
+template<>
+struct LanesOf<int64_t> {
+    using Type = IntegerLanes;
+};
+
+template<>
+struct LanesOf<double> {
+    using Type = FloatLanes;
+};
+
+template<typename T>
+using Lanes = typename LanesOf<T>::Type;
+
+template<typename Vector, typename T>
+inline void Load(Vector& vector, const T* address) {
+    std::memcpy(&vector, address, sizeof(vector));
+}
+
+template<typename Vector, typename T>
+inline void Store(T* address, const Vector& vector) {
+    std::memcpy(address, &vector, sizeof(vector));
+}
+#endif
+
+// out[i] = operation(a[i], b[i])
+template<bool kVector, typename T, typename Operation>
+inline void Map(const T* a, const T* b, T* out, size_t count, Operation operation) {
+    size_t i = 0;
+#if FORTH_VECTOR_KERNELS
+    if constexpr (kVector) {
+        Lanes<T> x, y;
+        for (; i + kVectorLanes <= count; i += kVectorLanes) {
+            Load(x, a + i);
+            Load(y, b + i);
+            Lanes<T> result = operation(x, y);
+            Store(out + i, result);
+        }
+    }
+#endif
+    for (; i < count; ++i) {
+        out[i] = operation(a[i], b[i]);
+    }
+}
+
+// mask[i] = comparison(a[i], b[i]) ? 1 : 0
+template<bool kVector, typename T, typename Comparison>
+inline void Compare(const T* a, const T* b, int64_t* mask, size_t count, Comparison comparison) {
+    size_t i = 0;
+#if FORTH_VECTOR_KERNELS
+    if constexpr (kVector) {
+        Lanes<T> x, y;
+        for (; i + kVectorLanes <= count; i += kVectorLanes) {
+            Load(x, a + i);
+            Load(y, b + i);
+            // vector comparisons yield -1 for true
+            IntegerLanes result = comparison(x, y) & 1;
+            Store(mask + i, result);
+        }
+    }
+#endif
+    for (; i < count; ++i) {
+        mask[i] = comparison(a[i], b[i]) ? 1 : 0;
+    }
+}
+
+// Folds element i of every whole block into lane i % kLanes with step, merges the lanes pairwise
+// and folds the remaining elements into the result one by one. The lanes are a plain array rather
+// than one vector: GCC lowers vectors wider than the registers through memory, while this loop is
+// vectorized to the register width of each instruction set.
+template<bool kVector, typename T, typename Step, typename Merge>
+inline T Reduce(const T* a, const T* b, size_t count, T initial, Step step, Merge merge) {
+    size_t blocks = count / kLanes * kLanes;
+    T lanes[kLanes];
+    for (auto& lane : lanes) {
+        lane = initial;
+    }
+    for (size_t i = 0; i < blocks; i += kLanes) {
+        for (size_t lane = 0; lane < kLanes; ++lane) {
+            lanes[lane] = step(lanes[lane], a[i + lane], b[i + lane]);
+        }
+    }
+    for (size_t width = 1; width < kLanes; width *= 2) {
+        for (size_t lane = 0; lane < kLanes; lane += 2 * width) {
+            lanes[lane] = merge(lanes[lane], lanes[lane + width]);
+        }
+    }
+    T result = lanes[0];
+    for (size_t i = blocks; i < count; ++i) {
+        result = step(result, a[i], b[i]);
+    }
+    return result;
+}
+
+template<typename T>
+T First(const T* a, size_t count) {
+    if (count == 0) {
+        throw std::runtime_error("Reduction of an empty array");
+    }
+    return a[0];
+}
+
+template<typename Kernel>
+auto RunScalar(const Kernel& kernel) {
+    return kernel(std::false_type());
+}
+
+#if FORTH_VECTOR_KERNELS
+template<typename Kernel>
+[[gnu::flatten]] auto RunVector(const Kernel& kernel) {
+    return kernel(std::true_type());
+}
+#endif
+
+#if FORTH_VECTOR_KERNELS && defined(__x86_64__)
+// flatten inlines the kernel, so that all of it is compiled for AVX2
+template<typename Kernel>
+[[gnu::flatten, gnu::target("avx2")]] auto RunAvx2(const Kernel& kernel) {
+    return kernel(std::true_type());
+}
+#endif
+
+// Calls kernel with std::true_type for vector code or std::false_type for scalar code,
+// compiled for the selected instruction set.
+template<typename Kernel>
+auto Run(const Kernel& kernel) {
+    switch (ArrayKernels::Selected()) {
+#if FORTH_VECTOR_KERNELS && defined(__x86_64__)
+        case ArrayKernels::InstructionSet::kAvx2:
+            return RunAvx2(kernel);
+#endif
+#if FORTH_VECTOR_KERNELS
+        case ArrayKernels::InstructionSet::kSse:
+            return RunVector(kernel);
+#endif
+        default:
+            return RunScalar(kernel);
+    }
+}
+
+ArrayKernels::InstructionSet Detect() {
+#if FORTH_VECTOR_KERNELS && defined(__x86_64__)
+    // may run during static initialization, before the CPU model is initialized otherwise
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return ArrayKernels::InstructionSet::kAvx2;
+    }
+    return ArrayKernels::InstructionSet::kSse;
+#else
+    return ArrayKernels::InstructionSet::kScalar;
+#endif
+}
+
+ArrayKernels::InstructionSet selected = Detect();
+
+} // namespace
+
+ArrayKernels::InstructionSet ArrayKernels::Selected() {
+    return selected;
+}
+
+void ArrayKernels::Select(InstructionSet instruction_set) {
+    selected = std::min(instruction_set, Detect());
+}
+
+template<typename T>
+void ArrayKernels::Add(const T* a, const T* b, T* out, size_t count) {
+    using A = Arithmetic<T>;
+    Run([&](auto vector) {
+        Map<decltype(vector)::value>(reinterpret_cast<const A*>(a), reinterpret_cast<const A*>(b),
+                                     reinterpret_cast<A*>(out), count, [](const auto& x, const auto& y) {
+            return x + y;
+        });
+    });
+}
+
+template<typename T>
+void ArrayKernels::Subtract(const T* a, const T* b, T* out, size_t count) {
+    using A = Arithmetic<T>;
+    Run([&](auto vector) {
+        Map<decltype(vector)::value>(reinterpret_cast<const A*>(a), reinterpret_cast<const A*>(b),
+                                     reinterpret_cast<A*>(out), count, [](const auto& x, const auto& y) {
+            return x - y;
+        });
+    });
+}
+
+template<typename T>
+void ArrayKernels::Multiply(const T* a, const T* b, T* out, size_t count) {
+    using A = Arithmetic<T>;
+    Run([&](auto vector) {
+        Map<decltype(vector)::value>(reinterpret_cast<const A*>(a), reinterpret_cast<const A*>(b),
+                                     reinterpret_cast<A*>(out), count, [](const auto& x, const auto& y) {
+            return x * y;
+        });
+    });
+}
+
+template<typename T>
+void ArrayKernels::Scale(const T* a, T factor, T* out, size_t count) {
+    using A = Arithmetic<T>;
+    auto scale = static_cast<A>(factor);
+    Run([&](auto vector) {
+        Map<decltype(vector)::value>(reinterpret_cast<const A*>(a), reinterpret_cast<const A*>(a),
+                                     reinterpret_cast<A*>(out), count, [scale](const auto& x, const auto&) {
+            return x * scale;
+        });
+    });
+}
+
+template<typename T>
+void ArrayKernels::Axpy(T factor, const T* x, T* y, size_t count) {
+    using A = Arithmetic<T>;
+    auto scale = static_cast<A>(factor);
+    Run([&](auto vector) {
+        Map<decltype(vector)::value>(reinterpret_cast<const A*>(x), reinterpret_cast<const A*>(y),
+                                     reinterpret_cast<A*>(y), count, [scale](const auto& x, const auto& y) {
+            return y + scale * x;
+        });
+    });
+}
+
+template<typename T>
+T ArrayKernels::Dot(const T* a, const T* b, size_t count) {
+    using A = Arithmetic<T>;
+    return static_cast<T>(Run([&](auto vector) {
+        return Reduce<decltype(vector)::value>(reinterpret_cast<const A*>(a), reinterpret_cast<const A*>(b), count,
+                                               A(0), [](auto sum, auto x, auto y) {
+            return sum + x * y;
+        }, [](auto x, auto y) {
+            return x + y;
+        });
+    }));
+}
+
+template<typename T>
+T ArrayKernels::Sum(const T* a, size_t count) {
+    using A = Arithmetic<T>;
+    return static_cast<T>(Run([&](auto vector) {
+        return Reduce<decltype(vector)::value>(reinterpret_cast<const A*>(a), reinterpret_cast<const A*>(a), count,
+                                               A(0), [](auto sum, auto x, auto) {
+            return sum + x;
+        }, [](auto x, auto y) {
+            return x + y;
+        });
+    }));
+}
+
+template<typename T>
+T ArrayKernels::Min(const T* a, size_t count) {
+    auto first = First(a, count);
+    return Run([&](auto vector) {
+        return Reduce<decltype(vector)::value>(a, a, count, first, [](auto min, auto x, auto) {
+            return x < min ? x : min;
+        }, [](auto x, auto y) {
+            return y < x ? y : x;
+        });
+    });
+}
+
+template<typename T>
+T ArrayKernels::Max(const T* a, size_t count) {
+    auto first = First(a, count);
+    return Run([&](auto vector) {
+        return Reduce<decltype(vector)::value>(a, a, count, first, [](auto max, auto x, auto) {
+            return x > max ? x : max;
+        }, [](auto x, auto y) {
+            return y > x ? y : x;
+        });
+    });
+}
+
+template<typename T>
+void ArrayKernels::Less(const T* a, const T* b, int64_t* mask, size_t count) {
+    Run([&](auto vector) {
+        Compare<decltype(vector)::value>(a, b, mask, count, [](const auto& x, const auto& y) {
+            return x < y;
+        });
+    });
+}
+
+template<typename T>
+void ArrayKernels::Equal(const T* a, const T* b, int64_t* mask, size_t count) {
+    Run([&](auto vector) {
+        Compare<decltype(vector)::value>(a, b, mask, count, [](const auto& x, const auto& y) {
+            return x == y;
+        });
+    });
+}
+
+template<typename T>
+void ArrayKernels::Greater(const T* a, const T* b, int64_t* mask, size_t count) {
+    Run([&](auto vector) {
+        Compare<decltype(vector)::value>(a, b, mask, count, [](const auto& x, const auto& y) {
+            return x > y;
+        });
+    });
+}
+
+#define FORTH_INSTANTIATE_KERNELS(T) \
+    template void ArrayKernels::Add<T>(const T*, const T*, T*, size_t); \
+    template void ArrayKernels::Subtract<T>(const T*, const T*, T*, size_t); \
+    template void ArrayKernels::Multiply<T>(const T*, const T*, T*, size_t); \
+    template void ArrayKernels::Scale<T>(const T*, T, T*, size_t); \
+    template void ArrayKernels::Axpy<T>(T, const T*, T*, size_t); \
+    template T ArrayKernels::Dot<T>(const T*, const T*, size_t); \
+    template T ArrayKernels::Sum<T>(const T*, size_t); \
+    template T ArrayKernels::Min<T>(const T*, size_t); \
+    template T ArrayKernels::Max<T>(const T*, size_t); \
+    template void ArrayKernels::Less<T>(const T*, const T*, int64_t*, size_t); \
+    template void ArrayKernels::Equal<T>(const T*, const T*, int64_t*, size_t); \
+    template void ArrayKernels::Greater<T>(const T*, const T*, int64_t*, size_t);
+
+FORTH_INSTANTIATE_KERNELS(int64_t)
+FORTH_INSTANTIATE_KERNELS(double)
+
+#undef FORTH_INSTANTIATE_KERNELS
@@ -0,0 +1,119 @@
+/**
+ * @file ArrayKernels.h
+ * @brief Defines the ArrayKernels class processing whole cells and floats arrays at once.
+ */
+
+#ifndef ARRAYKERNELS_H
+#define ARRAYKERNELS_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @class ArrayKernels
+ * @brief Element-wise operations and reductions over arrays of int64_t cells or doubles.
+ *
+ * Every kernel exists as AVX2 code, as code for the baseline vector unit (SSE2 on x86-64) and as
+ * scalar code; the best one the CPU supports is selected at runtime. Reductions accumulate in
+ * eight lanes combined in a fixed order, so all three produce identical results, also for doubles.
+ * Integer arithmetic wraps around. Comparisons store 1 or 0 per element, like `<` and `=`.
+ * All kernels are instantiated for int64_t and double.
+ */
+class ArrayKernels {
+public:
+    /**
+     * @brief The instruction sets kernels are available for.
+     */
+    enum class InstructionSet {
+        kScalar, ///< One element at a time.
+        kSse,    ///< 128 bit vectors of the baseline x86-64 instruction set.
+        kAvx2    ///< 256 bit AVX2 vectors.
+    };
+
+    /**
+     * @brief Returns the instruction set used, detected on first use.
+     */
+    static InstructionSet Selected();
+
+    /**
+     * @brief Uses the given instruction set, or the best supported one if the CPU lacks it.
+     * @param instruction_set The instruction set to use.
+     */
+    static void Select(InstructionSet instruction_set);
+
+    /**
+     * @brief out[i] = a[i] + b[i]
+     */
+    template<typename T>
+    static void Add(const T* a, const T* b, T* out, size_t count);
+
+    /**
+     * @brief out[i] = a[i] - b[i]
+     */
+    template<typename T>
+    static void Subtract(const T* a, const T* b, T* out, size_t count);
+
+    /**
+     * @brief out[i] = a[i] * b[i]
+     */
+    template<typename T>
+    static void Multiply(const T* a, const T* b, T* out, size_t count);
+
+    /**
+     * @brief out[i] = a[i] * factor
+     */
+    template<typename T>
+    static void Scale(const T* a, T factor, T* out, size_t count);
+
+    /**
+     * @brief y[i] = y[i] + factor * x[i]
+     */
+    template<typename T>
+    static void Axpy(T factor, const T* x, T* y, size_t count);
+
+    /**
+     * @brief Returns the sum of a[i] * b[i].
+     */
+    template<typename T>
+    static T Dot(const T* a, const T* b, size_t count);
+
+    /**
+     * @brief Returns the sum of a[i].
+     */
+    template<typename T>
+    static T Sum(const T* a, size_t count);
+
+    /**
+     * @brief Returns the smallest a[i].
+     * @throws std::runtime_error If count is 0.
+     */
+    template<typename T>
+    static T Min(const T* a, size_t count);
+
+    /**
+     * @brief Returns the largest a[i].
+     * @throws std::runtime_error If count is 0.
+     */
+    template<typename T>
+    static T Max(const T* a, size_t count);
+
+    /**
+     * @brief mask[i] = a[i] < b[i]
+     */
+    template<typename T>
+    static void Less(const T* a, const T* b, int64_t* mask, size_t count);
+
+    /**
+     * @brief mask[i] = a[i] == b[i]
+     */
+    template<typename T>
+    static void Equal(const T* a, const T* b, int64_t* mask, size_t count);
+
+    /**
+     * @brief mask[i] = a[i] > b[i]
+     */
+    template<typename T>
+    static void Greater(const T* a, const T* b, int64_t* mask, size_t count);
+};
+
+#endif //ARRAYKERNELS_H
@@ -0,0 +1,212 @@
+/**
+ * @file Builtins.h
+ * @brief Defines the Builtins table of keywords and builtin operators, shared by the Parser and Operator.
+ */
+
+#ifndef BUILTINS_H
+#define BUILTINS_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include "Lexeme.h"
+
+/**
+ * @struct BuiltinWord
+ * @brief A word of the language that programs cannot define themselves.
+ */
+struct BuiltinWord {
+    std::string_view name;   ///< The text of the word.
+    Lexeme::LexemeType type; ///< What the Parser classifies the word as.
+};
+
+/**
+ * @class PerfectHash
+ * @brief A hash table of a fixed set of words in which no two words collide, built at compile time.
+ *
+ * Seeds of an FNV-1a hash are tried until every word lands in a slot of its own, so looking a text
+ * up costs one hash, one slot and one comparison, without allocating.
+ *
+ * @tparam kSlotCount The number of slots, a power of two.
+ */
+template<size_t kSlotCount>
+class PerfectHash {
+public:
+    /**
+     * @brief Finds a seed under which the words do not collide; fails to compile if there is none.
+     * @param words The words, fewer than 255.
+     */
+    template<size_t kCount>
+    consteval explicit PerfectHash(const std::array<BuiltinWord, kCount>& words) {
+        static_assert(kCount < 255 && (kSlotCount & (kSlotCount - 1)) == 0);
+        for (seed_ = 0; seed_ < 1000; ++seed_) {
+            slots_ = {};
+            bool collides = false;
+            for (size_t i = 0; i < kCount && !collides; ++i) {
+                auto& slot = slots_[Slot(words[i].name, seed_)];
+                collides = slot != 0;
+                slot = static_cast<uint8_t>(i + 1);
+            }
+            if (!collides) {
+                return;
+            }
+        }
+        throw "no seed found, use more slots";
+    }
+
+    /**
+     * @brief Returns the index of the only word that may equal the text, or -1; the caller compares them.
+     * @param text The text to look up.
+     */
+    constexpr int Candidate(std::string_view text) const {
+        return static_cast<int>(slots_[Slot(text, seed_)]) - 1;
+    }
+
+private:
+    static constexpr size_t Slot(std::string_view text, uint32_t seed) {
+        uint32_t hash = 2166136261u ^ seed;
+        for (char c : text) {
+            hash = (hash ^ static_cast<uint8_t>(c)) * 16777619u;
+        }
+        return (hash ^ (hash >> 16)) & (kSlotCount - 1);
+    }
+
+    uint32_t seed_ = 0;                      ///< The seed under which the words do not collide.
+    std::array<uint8_t, kSlotCount> slots_{}; ///< One more than the index of the word in each slot, 0 if empty.
+};
+
+/**
+ * @class Builtins
+ * @brief The keywords and builtin operators of the language, the single list the lexer and dispatcher use.
+ *
+ * The table and its hash are constants, so lookups are O(1) and cost nothing at startup.
+ * Operator implements every operator listed here, except those the GrammaticalAnalyzer
+ * turns into other nodes; Operator.cpp checks that at compile time.
+ */
+class Builtins {
+public:
+    using Type = Lexeme::LexemeType;
+
+    /**
+     * @brief The words, by index.
+     */
+    static constexpr auto kWords = std::to_array<BuiltinWord>({
+        {":", Type::kFunctionDefinitionStart},
+        {";", Type::kFunctionDefinitionEnd},
+        {"BEGIN", Type::kKeyword},
+        {"WHILE", Type::kKeyword},
+        {"REPEAT", Type::kKeyword},
+        {"DO", Type::kKeyword},
+        {"LOOP", Type::kKeyword},
+        {"PDO", Type::kKeyword},
+        {"PLOOP", Type::kKeyword},
+        {"REDUCE", Type::kKeyword},
+        {"IF", Type::kKeyword},
+        {"ENDIF", Type::kKeyword},
+        {"ELSE", Type::kKeyword},
+        {"CASE", Type::kKeyword},
+        {"OF", Type::kKeyword},
+        {"ENDOF", Type::kKeyword},
+        {"ENDCASE", Type::kKeyword},
+        {"dup", Type::kOperator},
+        {"2dup", Type::kOperator},
+        {"drop", Type::kOperator},
+        {"swap", Type::kOperator},
+        {"over", Type::kOperator},
+        {"rot", Type::kOperator},
+        {"pick", Type::kOperator},
+        {"nip", Type::kOperator},
+        {"tuck", Type::kOperator},
+        {"roll", Type::kOperator},
+        {"+", Type::kOperator},
+        {"s+", Type::kOperator},
+        {"*", Type::kOperator},
+        {"/", Type::kOperator},
+        {"-", Type::kOperator},
+        {"%", Type::kOperator},
+        {"negate", Type::kOperator},
+        {"invert", Type::kOperator},
+        {"lshift", Type::kOperator},
+        {"rshift", Type::kOperator},
+        {"<", Type::kOperator},
+        {">", Type::kOperator},
+        {"<=", Type::kOperator},
+        {">=", Type::kOperator},
+        {"=", Type::kOperator},
+        {"s=", Type::kOperator},
+        {"and", Type::kOperator},
+        {"or", Type::kOperator},
+        {"xor", Type::kOperator},
+        {"not", Type::kOperator},
+        {"!", Type::kOperator},
+        {"f!", Type::kOperator},
+        {"c!", Type::kOperator},
+        {"@", Type::kOperator},
+        {"c@", Type::kOperator},
+        {"f@", Type::kOperator},
+        {"sinput", Type::kOperator},
+        {"finput", Type::kOperator},
+        {"input", Type::kOperator},
+        {"type", Type::kOperator},
+        {".", Type::kOperator},
+        {".s", Type::kOperator},
+        {"emit", Type::kOperator},
+        {"leave", Type::kOperator},
+        {"continue", Type::kOperator},
+        {"VARIABLE", Type::kOperator},
+        {"CREATE", Type::kOperator},
+        {"allot", Type::kOperator},
+        {"chars", Type::kOperator},
+        {"floats", Type::kOperator},
+        {"cells", Type::kOperator},
+        {"tofloat", Type::kOperator},
+        {"tocell", Type::kOperator},
+        {"here", Type::kOperator},
+        {"SPAWN", Type::kOperator},
+        {"PAUSE", Type::kOperator},
+        {"v+", Type::kOperator},
+        {"v-", Type::kOperator},
+        {"v*", Type::kOperator},
+        {"vscale", Type::kOperator},
+        {"vaxpy", Type::kOperator},
+        {"vdot", Type::kOperator},
+        {"vsum", Type::kOperator},
+        {"vmin", Type::kOperator},
+        {"vmax", Type::kOperator},
+        {"v<", Type::kOperator},
+        {"v=", Type::kOperator},
+        {"v>", Type::kOperator},
+        {"fv+", Type::kOperator},
+        {"fv-", Type::kOperator},
+        {"fv*", Type::kOperator},
+        {"fvscale", Type::kOperator},
+        {"fvaxpy", Type::kOperator},
+        {"fvdot", Type::kOperator},
+        {"fvsum", Type::kOperator},
+        {"fvmin", Type::kOperator},
+        {"fvmax", Type::kOperator},
+        {"fv<", Type::kOperator},
+        {"fv=", Type::kOperator},
+        {"fv>", Type::kOperator},
+        {"I", Type::kOperator},
+        {"J", Type::kOperator},
+        {"K", Type::kOperator},
+        {"return", Type::kOperator},
+    });
+
+    /**
+     * @brief Returns the index of a word in kWords.
+     * @param text The text to look up.
+     * @return The index, or -1 if the text is not a builtin word.
+     */
+    static constexpr int Find(std::string_view text) {
+        int index = kHash.Candidate(text);
+        return index >= 0 && kWords[index].name == text ? index : -1;
+    }
+
+private:
+    static constexpr PerfectHash<1024> kHash{kWords}; ///< Slots of the words, about ten times as many as words.
+};
+
+#endif //BUILTINS_H
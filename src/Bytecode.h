@@ -0,0 +1,171 @@
+/**
+ * @file Bytecode.h
+ * @brief Defines the flat bytecode representation of a program and the compiler lowering the Executable tree into it.
+ */
+
+#ifndef BYTECODE_H
+#define BYTECODE_H
+
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+#include "Executable.h"
+#include "StackElement.h"
+
+/**
+ * @brief Operation codes understood by the VirtualMachine.
+ *
+ * Branch operands are relative to the address of the branching instruction.
+ */
+enum class Opcode : int32_t {
+    kHalt,           ///< Stop execution of the main code.
+    kReturn,         ///< Return from the current word.
+    kBuiltin,        ///< Call builtin number operand.
+    kCall,           ///< Call the word starting at relative address operand.
+    kTailCall,       ///< Call in tail position, jumping to the word without pushing a return frame.
+    kRequire,        ///< Check the stack for a call of a word with known stack effect number operand.
+    kPushConstant,   ///< Push constant number operand.
+    kPushString,     ///< Push address and length of string literal number operand.
+    kPushVariable,   ///< Push address of the variable in Environment::slots number operand.
+    kExecute,        ///< Execute tree node number operand (used for variable creation).
+    kJump,           ///< Unconditional relative jump.
+    kJumpIfFalse,    ///< Pop a flag and jump if it is false.
+    kSwitch,         ///< Pop a selector and jump through switch table number operand.
+    kDoEnter,        ///< Pop from, to and step and enter a DO LOOP, jumping to its exit if the range is empty.
+    kDoLoop,         ///< Advance the innermost DO LOOP index and jump back if it is still in range.
+    kDoExit,         ///< Leave the innermost DO LOOP.
+    kLoopIndex,      ///< Push the index of the DO LOOP operand levels out from the innermost one (I, J, K).
+    kSpawn,          ///< Start a task running the code after this instruction and jump over that code by operand.
+    kPause,          ///< Suspend the running task so that other tasks run; does nothing outside of a task.
+    // superinstructions produced by the PeepholeOptimizer
+    kDupMultiply,           ///< dup *
+    kOverOver,              ///< over over
+    kNip,                   ///< swap drop
+    kAddConstant,           ///< Literal number operand followed by +.
+    kSubtractConstant,      ///< Literal number operand followed by -.
+    kMultiplyConstant,      ///< Literal number operand followed by *.
+    kLessConstant,          ///< Literal number operand followed by <.
+    kGreaterConstant,       ///< Literal number operand followed by >.
+    kEqualsConstant,        ///< Literal number operand followed by =.
+    kFetchVariable,         ///< Variable in Environment::slots number operand followed by @.
+    kJumpIfNotLess,         ///< < followed by IF, jumping by operand if the comparison fails.
+    kJumpIfNotLessEqual,    ///< <= followed by IF.
+    kJumpIfNotGreater,      ///< > followed by IF.
+    kJumpIfNotGreaterEqual, ///< >= followed by IF.
+    kJumpIfNotEqual,        ///< = followed by IF.
+    kOpcodeCount     ///< Number of opcodes, not an instruction.
+};
+
+/**
+ * @brief Checks whether the operand of an instruction is a relative branch target.
+ * @param opcode The operation code.
+ * @return True for jumps, calls, loop instructions and SPAWN.
+ */
+inline bool IsBranch(Opcode opcode) {
+    switch (opcode) {
+        case Opcode::kCall:
+        case Opcode::kTailCall:
+        case Opcode::kJump:
+        case Opcode::kJumpIfFalse:
+        case Opcode::kDoEnter:
+        case Opcode::kDoLoop:
+        case Opcode::kSpawn:
+        case Opcode::kJumpIfNotLess:
+        case Opcode::kJumpIfNotLessEqual:
+        case Opcode::kJumpIfNotGreater:
+        case Opcode::kJumpIfNotGreaterEqual:
+        case Opcode::kJumpIfNotEqual:
+            return true;
+        default:
+            return false;
+    }
+}
+
+/**
+ * @struct Instruction
+ * @brief A single bytecode instruction.
+ */
+struct Instruction {
+    const void* handler = nullptr; ///< Address of the handler in threaded code, filled in by the VirtualMachine.
+    Opcode opcode = Opcode::kHalt; ///< The operation to perform.
+    int32_t operand = 0;           ///< Relative branch offset or index into one of the program tables.
+};
+
+/**
+ * @struct BytecodeProgram
+ * @brief A program lowered to one contiguous array of instructions plus the tables its operands refer to.
+ */
+struct BytecodeProgram {
+    std::vector<Instruction> code; ///< Main code starting at address 0, followed by the bodies of all words.
+    std::vector<Operator::Builtin> builtins;            ///< Builtins used by kBuiltin.
+    std::vector<StackElement> constants;                ///< Numeric literals used by kPushConstant.
+    std::deque<std::string> strings;                    ///< String literals used by kPushString.
+    std::vector<Executable*> nodes;                     ///< Tree nodes used by kExecute.
+    std::vector<StackEffect> effects;                   ///< Stack effects checked by kRequire.
+    std::vector<std::map<int64_t, int32_t>> switches;   ///< Selector to relative target tables used by kSwitch.
+    std::map<std::string, int32_t> entries;             ///< Entry address of every word.
+};
+
+/**
+ * @class BytecodeCompiler
+ * @brief Lowers the Executable tree of an analyzed Environment into a BytecodeProgram.
+ *
+ * Operators are lowered according to what the Linker resolved them to;
+ * operators that have not been linked yet are resolved on the way.
+ */
+class BytecodeCompiler final : public ExecutableVisitor {
+public:
+    /**
+     * @brief Compiles the main code and all words of the environment.
+     * @param environment The environment produced by the GrammaticalAnalyzer.
+     * @return The compiled program.
+     */
+    BytecodeProgram Compile(Environment& environment);
+
+    void Visit(VariableCreation& node) override;
+    void Visit(Codeblock& node) override;
+    void Visit(class While& node) override;
+    void Visit(class For& node) override;
+    void Visit(class If& node) override;
+    void Visit(class Switch& node) override;
+    void Visit(Operator& node) override;
+
+private:
+    /**
+     * @brief Targets of leave and continue inside the innermost loop being compiled.
+     */
+    struct LoopLabels {
+        std::vector<size_t> leave_jumps;    ///< Jumps to be patched to the loop exit.
+        std::vector<size_t> continue_jumps; ///< Jumps to be patched to the next iteration.
+    };
+
+    /**
+     * @brief Turns every call directly followed by a return into a tail call.
+     */
+    void MarkTailCalls();
+
+    /**
+     * @brief Appends an instruction to the program.
+     * @return The address of the appended instruction.
+     */
+    size_t Emit(Opcode opcode, int32_t operand = 0);
+
+    /**
+     * @brief Points the branch at the given address to the target address.
+     */
+    void Patch(size_t address, size_t target);
+
+    /**
+     * @brief Points all given branches to the target address.
+     */
+    void PatchAll(const std::vector<size_t>& addresses, size_t target);
+
+    BytecodeProgram program_; ///< The program being built.
+    std::vector<LoopLabels> loops_; ///< Labels of the loops enclosing the current position.
+    std::vector<std::pair<size_t, std::string>> calls_; ///< Calls to be patched once all words are compiled.
+    Environment* environment_ = nullptr; ///< The environment being compiled.
+};
+
+#endif //BYTECODE_H
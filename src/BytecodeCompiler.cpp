@@ -0,0 +1,189 @@
+#include "Bytecode.h"
+#include <stdexcept>
+
+BytecodeProgram BytecodeCompiler::Compile(Environment& environment) {
+    environment_ = &environment;
+    program_ = BytecodeProgram();
+    calls_.clear();
+    environment.code->Accept(*this);
+    Emit(Opcode::kHalt);
+    for (const auto& [name, body] : environment.functions) {
+        program_.entries[name] = static_cast<int32_t>(program_.code.size());
+        body->Accept(*this);
+        Emit(Opcode::kReturn);
+    }
+    for (const auto& [address, name] : calls_) {
+        Patch(address, program_.entries[name]);
+    }
+    MarkTailCalls();
+    return std::move(program_);
+}
+
+void BytecodeCompiler::Visit(VariableCreation& node) {
+    program_.nodes.push_back(&node);
+    Emit(Opcode::kExecute, static_cast<int32_t>(program_.nodes.size() - 1));
+}
+
+void BytecodeCompiler::Visit(Codeblock& node) {
+    for (const auto& statement : node.statements) {
+        statement->Accept(*this);
+    }
+}
+
+void BytecodeCompiler::Visit(class While& node) {
+    size_t start = program_.code.size();
+    loops_.emplace_back();
+    node.condition->Accept(*this);
+    size_t condition_jump = Emit(Opcode::kJumpIfFalse);
+    node.body->Accept(*this);
+    Patch(Emit(Opcode::kJump), start);
+    size_t exit = program_.code.size();
+    Patch(condition_jump, exit);
+    PatchAll(loops_.back().leave_jumps, exit);
+    PatchAll(loops_.back().continue_jumps, start);
+    loops_.pop_back();
+}
+
+void BytecodeCompiler::Visit(class For& node) {
+    if (node.parallel) {
+        // the chunks run the tree on their own environments, which the return stack of the machine does not reach
+        program_.nodes.push_back(&node);
+        Emit(Opcode::kExecute, static_cast<int32_t>(program_.nodes.size() - 1));
+        return;
+    }
+    size_t enter = Emit(Opcode::kDoEnter);
+    loops_.emplace_back();
+    size_t body_start = program_.code.size();
+    node.body->Accept(*this);
+    size_t next_iteration = program_.code.size();
+    Patch(Emit(Opcode::kDoLoop), body_start);
+    size_t exit = Emit(Opcode::kDoExit);
+    Patch(enter, exit);
+    PatchAll(loops_.back().leave_jumps, exit);
+    PatchAll(loops_.back().continue_jumps, next_iteration);
+    loops_.pop_back();
+}
+
+void BytecodeCompiler::Visit(class If& node) {
+    size_t else_jump = Emit(Opcode::kJumpIfFalse);
+    node.if_part->Accept(*this);
+    if (!node.else_part) {
+        Patch(else_jump, program_.code.size());
+        return;
+    }
+    size_t end_jump = Emit(Opcode::kJump);
+    Patch(else_jump, program_.code.size());
+    node.else_part->Accept(*this);
+    Patch(end_jump, program_.code.size());
+}
+
+void BytecodeCompiler::Visit(class Switch& node) {
+    auto table_index = static_cast<int32_t>(program_.switches.size());
+    program_.switches.emplace_back();
+    size_t dispatch = Emit(Opcode::kSwitch, table_index);
+    std::vector<size_t> end_jumps = {Emit(Opcode::kJump)};
+    std::map<int64_t, int32_t> table;
+    for (const auto& [selector, code] : node.cases) {
+        table[selector] = static_cast<int32_t>(program_.code.size() - dispatch);
+        code->Accept(*this);
+        end_jumps.push_back(Emit(Opcode::kJump));
+    }
+    PatchAll(end_jumps, program_.code.size());
+    program_.switches[table_index] = std::move(table);
+}
+
+void BytecodeCompiler::Visit(Operator& node) {
+    const auto& text = node.text;
+    if (text == "leave" || text == "continue") {
+        if (loops_.empty()) {
+            throw std::runtime_error("Operator '" + text + "' must be in loop");
+        }
+        auto& jumps = text == "leave" ? loops_.back().leave_jumps : loops_.back().continue_jumps;
+        jumps.push_back(Emit(Opcode::kJump));
+        return;
+    }
+    if (text == "return") {
+        Emit(Opcode::kReturn);
+        return;
+    }
+    if (node.kind == Operator::Kind::kUnresolved) {
+        node.Resolve(*environment_);
+    }
+    switch (node.kind) {
+        case Operator::Kind::kBuiltin:
+            if (auto depth = Operator::LoopIndexDepth(text); depth >= 0) {
+                Emit(Opcode::kLoopIndex, depth);
+                break;
+            }
+            if (text == "PAUSE") {
+                Emit(Opcode::kPause);
+                break;
+            }
+            program_.builtins.push_back(node.builtin);
+            Emit(Opcode::kBuiltin, static_cast<int32_t>(program_.builtins.size() - 1));
+            break;
+        case Operator::Kind::kFunctionCall:
+            if (node.entry_check.known) {
+                program_.effects.push_back(node.entry_check);
+                Emit(Opcode::kRequire, static_cast<int32_t>(program_.effects.size() - 1));
+            }
+            calls_.emplace_back(Emit(Opcode::kCall), text);
+            break;
+        case Operator::Kind::kVariableUse:
+            Emit(Opcode::kPushVariable, static_cast<int32_t>(node.variable));
+            break;
+        case Operator::Kind::kLiteral:
+            program_.constants.push_back(node.constant);
+            Emit(Opcode::kPushConstant, static_cast<int32_t>(program_.constants.size() - 1));
+            break;
+        case Operator::Kind::kStringLiteral:
+            program_.strings.push_back(text);
+            Emit(Opcode::kPushString, static_cast<int32_t>(program_.strings.size() - 1));
+            break;
+        case Operator::Kind::kSpawn: {
+            // the task runs a stub of its own, which calls the word and ends the task when it returns
+            size_t spawn = Emit(Opcode::kSpawn);
+            if (node.entry_check.known) {
+                program_.effects.push_back(node.entry_check);
+                Emit(Opcode::kRequire, static_cast<int32_t>(program_.effects.size() - 1));
+            }
+            calls_.emplace_back(Emit(Opcode::kCall), text);
+            Emit(Opcode::kReturn);
+            Patch(spawn, program_.code.size());
+            break;
+        }
+        case Operator::Kind::kNative:
+            // the operator node calls the host function, so the interpreter and the JIT need no opcode of their own
+            program_.nodes.push_back(&node);
+            Emit(Opcode::kExecute, static_cast<int32_t>(program_.nodes.size() - 1));
+            break;
+        case Operator::Kind::kUnresolved:
+            throw std::runtime_error("unknown operator passed");
+    }
+}
+
+void BytecodeCompiler::MarkTailCalls() {
+    for (size_t address = 0; address + 1 < program_.code.size(); ++address) {
+        if (program_.code[address].opcode == Opcode::kCall && program_.code[address + 1].opcode == Opcode::kReturn) {
+            program_.code[address].opcode = Opcode::kTailCall;
+        }
+    }
+}
+
+size_t BytecodeCompiler::Emit(Opcode opcode, int32_t operand) {
+    Instruction instruction;
+    instruction.opcode = opcode;
+    instruction.operand = operand;
+    program_.code.push_back(instruction);
+    return program_.code.size() - 1;
+}
+
+void BytecodeCompiler::Patch(size_t address, size_t target) {
+    program_.code[address].operand = static_cast<int32_t>(target) - static_cast<int32_t>(address);
+}
+
+void BytecodeCompiler::PatchAll(const std::vector<size_t>& addresses, size_t target) {
+    for (auto address : addresses) {
+        Patch(address, target);
+    }
+}
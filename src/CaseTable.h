@@ -0,0 +1,187 @@
+/**
+ * @file CaseTable.h
+ * @brief Defines the CaseTable class mapping the selectors of a CASE to their targets.
+ */
+
+#ifndef CASETABLE_H
+#define CASETABLE_H
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+/**
+ * @class CaseTable
+ * @brief An immutable lookup from CASE selectors to targets, laid out according to the selectors.
+ *
+ * Selectors forming a compact range are looked up in a dense jump table, other sets of selectors
+ * in a perfect hash table with a multiplicative hash, and sets for which no perfect hash is found
+ * with a branchless binary search over the sorted selectors.
+ *
+ * @tparam Target The type of the targets, such as a case body or a branch offset.
+ */
+template<typename Target>
+class CaseTable {
+public:
+    /**
+     * @brief How the selectors are looked up.
+     */
+    enum class Kind {
+        kEmpty,       ///< No selectors.
+        kDense,       ///< Indexed by the selector minus the smallest selector.
+        kPerfectHash, ///< Indexed by a collision-free hash of the selector.
+        kSorted       ///< Binary search over the sorted selectors.
+    };
+
+    /**
+     * @brief Largest dense table, in slots.
+     */
+    static constexpr uint64_t kMaxDenseSlots = 4096;
+
+    /**
+     * @brief Largest perfect hash table, in slots.
+     */
+    static constexpr uint64_t kMaxHashSlots = 4096;
+
+    CaseTable() = default;
+
+    /**
+     * @brief Builds the lookup for the given cases.
+     * @param cases The targets by selector.
+     */
+    explicit CaseTable(const std::map<int64_t, Target>& cases) {
+        for (const auto& [selector, target] : cases) {
+            selectors_.push_back(selector);
+            targets_.push_back(target);
+        }
+        if (cases.empty()) {
+            return;
+        }
+        // computed in unsigned arithmetic, so that the range of far apart selectors does not overflow
+        uint64_t range = static_cast<uint64_t>(selectors_.back()) - static_cast<uint64_t>(selectors_.front());
+        if (range < kMaxDenseSlots && range < 4 * selectors_.size()) {
+            BuildDense(range + 1);
+        } else if (selectors_.size() <= 4 || !BuildPerfectHash()) {
+            kind_ = Kind::kSorted;
+        }
+    }
+
+    /**
+     * @brief Returns the target of a selector.
+     * @param selector The selector to look up.
+     * @return The target, or nullptr if no case matches.
+     */
+    const Target* Find(int64_t selector) const {
+        switch (kind_) {
+            case Kind::kEmpty:
+                return nullptr;
+            case Kind::kDense: {
+                uint64_t offset = static_cast<uint64_t>(selector) - static_cast<uint64_t>(selectors_.front());
+                if (offset >= slots_.size() || slots_[offset] == kMissing) {
+                    return nullptr;
+                }
+                return &targets_[slots_[offset]];
+            }
+            case Kind::kPerfectHash: {
+                auto index = slots_[Hash(selector, multiplier_, shift_)];
+                if (index == kMissing || selectors_[index] != selector) {
+                    return nullptr;
+                }
+                return &targets_[index];
+            }
+            case Kind::kSorted: {
+                const int64_t* base = selectors_.data();
+                size_t size = selectors_.size();
+                while (size > 1) {
+                    size_t half = size / 2;
+                    base = base[half] <= selector ? base + half : base;
+                    size -= half;
+                }
+                if (*base != selector) {
+                    return nullptr;
+                }
+                return &targets_[base - selectors_.data()];
+            }
+        }
+        return nullptr;
+    }
+
+    /**
+     * @brief Returns how the selectors are looked up.
+     */
+    Kind kind() const {
+        return kind_;
+    }
+
+    /**
+     * @brief Returns the selectors in increasing order.
+     */
+    const std::vector<int64_t>& selectors() const {
+        return selectors_;
+    }
+
+    /**
+     * @brief Returns the targets in the order of selectors().
+     */
+    const std::vector<Target>& targets() const {
+        return targets_;
+    }
+
+private:
+    static constexpr uint32_t kMissing = UINT32_MAX; ///< Slot without a case.
+
+    static uint64_t Hash(int64_t selector, uint64_t multiplier, int shift) {
+        return (static_cast<uint64_t>(selector) * multiplier) >> shift;
+    }
+
+    void BuildDense(uint64_t slots) {
+        kind_ = Kind::kDense;
+        slots_.assign(slots, kMissing);
+        auto first = static_cast<uint64_t>(selectors_.front());
+        for (size_t i = 0; i < selectors_.size(); ++i) {
+            slots_[static_cast<uint64_t>(selectors_[i]) - first] = static_cast<uint32_t>(i);
+        }
+    }
+
+    // Searches odd multipliers for one mapping all selectors to different slots.
+    bool BuildPerfectHash() {
+        uint64_t state = 0x9e3779b97f4a7c15;
+        for (uint64_t slots = std::bit_ceil(2 * selectors_.size()); slots <= kMaxHashSlots; slots *= 2) {
+            int shift = 64 - std::countr_zero(slots);
+            for (int attempt = 0; attempt < 64; ++attempt) {
+                // splitmix64
+                state += 0x9e3779b97f4a7c15;
+                uint64_t multiplier = state;
+                multiplier = (multiplier ^ (multiplier >> 30)) * 0xbf58476d1ce4e5b9;
+                multiplier = (multiplier ^ (multiplier >> 27)) * 0x94d049bb133111eb;
+                multiplier = (multiplier ^ (multiplier >> 31)) | 1;
+                slots_.assign(slots, kMissing);
+                bool perfect = true;
+                for (size_t i = 0; i < selectors_.size() && perfect; ++i) {
+                    auto& slot = slots_[Hash(selectors_[i], multiplier, shift)];
+                    perfect = slot == kMissing;
+                    slot = static_cast<uint32_t>(i);
+                }
+                if (perfect) {
+                    kind_ = Kind::kPerfectHash;
+                    multiplier_ = multiplier;
+                    shift_ = shift;
+                    return true;
+                }
+            }
+        }
+        slots_.clear();
+        return false;
+    }
+
+    Kind kind_ = Kind::kEmpty;       ///< How the selectors are looked up.
+    std::vector<int64_t> selectors_; ///< The selectors in increasing order.
+    std::vector<Target> targets_;    ///< The targets in the order of selectors_.
+    std::vector<uint32_t> slots_;    ///< Index into targets_ per dense or hash slot.
+    uint64_t multiplier_ = 0;        ///< Multiplier of the perfect hash.
+    int shift_ = 0;                  ///< Shift of the perfect hash, 64 minus the number of slot bits.
+};
+
+#endif //CASETABLE_H
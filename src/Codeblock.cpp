@@ -9,3 +9,7 @@ Executable::ReturnStatus Codeblock::Execute(Environment& environment) {
     }
     return ReturnStatus::kSuccess;
 }
+
+void Codeblock::Accept(ExecutableVisitor& visitor) {
+    visitor.Visit(*this);
+}
@@ -0,0 +1,56 @@
+#include "CompiledProgram.h"
+#include "ProgramImage.h"
+#include "Scheduler.h"
+#include <stdexcept>
+#include <utility>
+
+CompiledProgram::CompiledProgram(std::shared_ptr<const Environment> definitions,
+                                 std::unique_ptr<VirtualMachine> machine)
+    : definitions_(std::move(definitions)), machine_(std::move(machine)) {
+}
+
+std::unique_ptr<Environment> CompiledProgram::NewContext() const {
+    auto context = std::make_unique<Environment>();
+    context->slots.resize(definitions_->slots.size(), nullptr);
+    context->scheduler = std::make_shared<Scheduler>();
+    // one allotment of the whole layout gives every variable the offset the Linker assigned
+    const auto& layout = definitions_->data_space;
+    context->data_space.UseHugePages(layout.UsesHugePages());
+    context->data_space.LimitTo(layout.Here());
+    if (layout.Here() > 0) {
+        context->data_space.Allot(layout.Here());
+    }
+    return context;
+}
+
+void CompiledProgram::Run(Environment& context) const {
+    if (machine_) {
+        machine_->Run(context);
+    } else {
+        definitions_->code->Execute(context);
+    }
+}
+
+void CompiledProgram::Call(Environment& context, const std::string& word) const {
+    // programs loaded from an image keep their words only as bytecode
+    auto body = definitions_->functions.find(word);
+    if (!machine_ && body == definitions_->functions.end()) {
+        throw std::runtime_error("Unknown word '" + word + "'");
+    }
+    auto effect = definitions_->word_effects.find(word);
+    if (effect != definitions_->word_effects.end()) {
+        context.RequireStack(effect->second.inputs, effect->second.peak);
+    }
+    if (machine_) {
+        machine_->Call(context, word);
+    } else {
+        body->second->Execute(context);
+    }
+}
+
+void CompiledProgram::SaveImage(const std::string& file_path) const {
+    if (!machine_) {
+        throw std::runtime_error("Programs running on the tree cannot be saved as an image");
+    }
+    ProgramImage::Write(*definitions_, machine_->program(), file_path);
+}
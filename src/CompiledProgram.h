@@ -0,0 +1,82 @@
+/**
+ * @file CompiledProgram.h
+ * @brief Defines the CompiledProgram class sharing one analyzed program between concurrent runs.
+ */
+
+#ifndef COMPILEDPROGRAM_H
+#define COMPILEDPROGRAM_H
+
+#include <memory>
+#include <string>
+#include "Environment.h"
+#include "VirtualMachine.h"
+
+/**
+ * @class CompiledProgram
+ * @brief A linked and compiled program that any number of threads can run at once.
+ *
+ * The words, main code, literals, variable slots and data space layout stay in the environment
+ * the front end produced, and the bytecode in the VirtualMachine; neither changes while the
+ * program runs. Everything a run changes lives in a context of its own: the stacks, the DO LOOPs,
+ * the addresses of the variables and the data space holding them.
+ */
+class CompiledProgram {
+public:
+    /**
+     * @brief Wraps a program that has been linked and, unless it runs on the tree, compiled.
+     * @param definitions The environment produced by the front end and the passes.
+     * @param machine The machine running the bytecode, or nullptr to execute the Executable tree.
+     */
+    CompiledProgram(std::shared_ptr<const Environment> definitions, std::unique_ptr<VirtualMachine> machine);
+
+    /**
+     * @brief Creates the state for one run: empty stacks, a scheduler for the tasks it spawns and a data
+     * space laid out for the variables.
+     * @return The context, to be passed to Run.
+     */
+    std::unique_ptr<Environment> NewContext() const;
+
+    /**
+     * @brief Runs the main code of the program; may be called concurrently with different contexts.
+     * @param context A context created by NewContext, used by one run at a time.
+     */
+    void Run(Environment& context) const;
+
+    /**
+     * @brief Runs one word of the program on the stack of the context; may be called concurrently with different contexts.
+     *
+     * Variables exist once the main code that creates them has run on the context.
+     *
+     * @param context A context created by NewContext holding the arguments of the word.
+     * @param word The name of the word.
+     * @throws std::runtime_error If the program defines no such word or the stack holds too few arguments.
+     */
+    void Call(Environment& context, const std::string& word) const;
+
+    /**
+     * @brief Saves the program to an image file, to be loaded with Compiler::LoadImage.
+     * @param file_path The path of the image file.
+     * @throws std::runtime_error If the program runs on the tree, uses PDO loops or native words, or the file cannot be written.
+     */
+    void SaveImage(const std::string& file_path) const;
+
+    /**
+     * @brief Returns the machine running the bytecode, or nullptr if the program runs on the tree.
+     */
+    VirtualMachine* machine() const {
+        return machine_.get();
+    }
+
+    /**
+     * @brief Returns the environment holding the words and the variable layout of the program.
+     */
+    const Environment& definitions() const {
+        return *definitions_;
+    }
+
+private:
+    std::shared_ptr<const Environment> definitions_; ///< Words, main code and variable layout of the program.
+    std::unique_ptr<VirtualMachine> machine_;        ///< The machine running the bytecode, null for the tree walker.
+};
+
+#endif //COMPILEDPROGRAM_H
@@ -0,0 +1,108 @@
+#include "Compiler.h"
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include "Builtins.h"
+#include "Bytecode.h"
+#include "ConstantFolder.h"
+#include "GrammaticalAnalyzer.h"
+#include "Linker.h"
+#include "Parser.h"
+#include "Peephole.h"
+#include "ProgramImage.h"
+#include "StackEffectAnalyzer.h"
+#include "VirtualMachine.h"
+
+const std::vector<std::string> Compiler::kCodeBlockEnders = {";", "REPEAT", "LOOP", "PLOOP", "REDUCE", "ELSE", "ENDOF",
+                                                             ":", "ENDIF", "WHILE"};
+
+Compiler::Compiler(CompilerOptions options) : options_(std::move(options)) {
+}
+
+void Compiler::DefineWord(const std::string& name, StackEffect effect, std::function<void(Environment&)> function) {
+    if (Builtins::Find(name) >= 0) {
+        throw std::runtime_error("Native word '" + name + "' has the name of a builtin");
+    }
+    native_words_[name] = {std::move(function), effect};
+}
+
+std::unique_ptr<CompiledProgram> Compiler::Compile(const std::string& source) const {
+    return CompileAnalyzed(Analyze(Preprocessor::FromText(source)));
+}
+
+std::unique_ptr<CompiledProgram> Compiler::CompileFile(const std::string& file_path) const {
+    return CompileAnalyzed(AnalyzeFile(file_path));
+}
+
+std::shared_ptr<Environment> Compiler::AnalyzeFile(const std::string& file_path) const {
+    return Analyze(Preprocessor(file_path));
+}
+
+Parser Compiler::Lex(std::string_view text) const {
+    std::vector<std::string> native_words;
+    for (const auto& [name, word] : native_words_) {
+        native_words.push_back(name);
+    }
+    return Parser(text, native_words);
+}
+
+std::shared_ptr<Environment> Compiler::Analyze(const Preprocessor& preprocessor) const {
+    auto parser = Lex(preprocessor.GetText());
+    auto analyzer = std::make_shared<GrammaticalAnalyzer>(parser.GetResult(), kCodeBlockEnders);
+    analyzer->Analyze();
+    // the environment lives inside the analyzer, which the returned pointer keeps alive
+    std::shared_ptr<Environment> environment(analyzer, &analyzer->resulting_environment);
+    environment->native_words = native_words_;
+    environment->data_space.UseHugePages(options_.use_huge_pages);
+    Linker().Link(*environment);
+    Inliner inliner(options_.inline_threshold);
+    inliner.Inline(*environment);
+    if (options_.report_inlining && options_.report) {
+        inliner.Report(*options_.report);
+    }
+    if (options_.fold_constants) {
+        ConstantFolder().Fold(*environment);
+    }
+    StackEffectAnalyzer stack_effect_analyzer;
+    stack_effect_analyzer.Analyze(*environment, parser.GetStackComments());
+    if (options_.report_stack_effects && options_.report) {
+        stack_effect_analyzer.Report(*options_.report);
+    }
+    return environment;
+}
+
+std::unique_ptr<CompiledProgram> Compiler::CompileAnalyzed(std::shared_ptr<Environment> environment) const {
+    std::unique_ptr<VirtualMachine> machine;
+    if (!options_.use_tree_walker) {
+        auto program = BytecodeCompiler().Compile(*environment);
+        if (options_.fuse_instructions) {
+            PeepholeOptimizer peephole_optimizer;
+            peephole_optimizer.Optimize(program);
+            if (options_.report_fusions && options_.report) {
+                peephole_optimizer.Report(*options_.report);
+            }
+        }
+        machine = NewMachine(std::move(program));
+    }
+    return std::make_unique<CompiledProgram>(std::move(environment), std::move(machine));
+}
+
+std::unique_ptr<CompiledProgram> Compiler::LoadImage(const std::string& file_path) const {
+    if (options_.use_tree_walker) {
+        throw std::runtime_error("Images hold bytecode and cannot run on the tree");
+    }
+    auto image = ProgramImage::Read(file_path);
+    return std::make_unique<CompiledProgram>(std::move(image.definitions), NewMachine(std::move(image.program)));
+}
+
+std::unique_ptr<VirtualMachine> Compiler::NewMachine(BytecodeProgram program) const {
+    auto machine = std::make_unique<VirtualMachine>(std::move(program));
+    if (options_.cache_top_of_stack) {
+        machine->SetEngine(VirtualMachine::Engine::kTopOfStackCache);
+    }
+    if (options_.use_jit) {
+        machine->EnableJit(options_.jit_threshold);
+    }
+    return machine;
+}
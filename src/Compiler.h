@@ -0,0 +1,160 @@
+/**
+ * @file Compiler.h
+ * @brief Defines the Compiler class turning Forth source into a CompiledProgram, the entry point for embedding the interpreter.
+ */
+
+#ifndef COMPILER_H
+#define COMPILER_H
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "CompiledProgram.h"
+#include "Environment.h"
+#include "Inliner.h"
+#include "Parser.h"
+#include "Preprocessor.h"
+#include "StackEffect.h"
+
+/**
+ * @struct CompilerOptions
+ * @brief Selects the passes and the execution engine of compiled programs.
+ */
+struct CompilerOptions {
+    bool use_tree_walker = false;    ///< Execute the Executable tree instead of compiling to bytecode.
+    int inline_threshold = Inliner::kDefaultThreshold; ///< Inline words of at most this many nodes, 0 disables inlining.
+    bool fold_constants = true;      ///< Fold constants and eliminate dead branches.
+    bool fuse_instructions = true;   ///< Form superinstructions.
+    bool use_jit = true;             ///< Compile words to native code once they are hot.
+    uint32_t jit_threshold = 100;    ///< The number of calls after which a word is compiled to native code.
+    bool cache_top_of_stack = false; ///< Keep the top of stack in a local variable of the dispatch loop.
+    bool use_huge_pages = false;     ///< Back large arrays with huge pages.
+    std::ostream* report = nullptr;  ///< Where the reports selected below are printed.
+    bool report_stack_effects = false; ///< Print the inferred stack effect of every word.
+    bool report_inlining = false;      ///< Print which words were inlined.
+    bool report_fusions = false;       ///< Print how many superinstructions were formed.
+};
+
+/**
+ * @class Compiler
+ * @brief Runs the whole front end and the optimization passes on Forth source.
+ *
+ * A program is compiled once and then run any number of times, on as many threads as needed,
+ * each run on a context of its own:
+ *
+ *     Compiler compiler;
+ *     compiler.DefineWord("clock", StackEffect(0, 1), [](Environment& environment) {
+ *         environment.PushOnStack(StackElement(Now()));
+ *     });
+ *     auto program = compiler.Compile(": elapsed ( t -- d ) clock swap - ;");
+ *     auto context = program->NewContext();
+ *     program->Run(*context);
+ *     context->PushOnStack(StackElement(start));
+ *     program->Call(*context, "elapsed");
+ *     auto result = context->PopStack().Convert<int64_t>();
+ */
+class Compiler {
+public:
+    /**
+     * @brief Constructs a compiler with the given options.
+     * @param options The passes and engine to use.
+     */
+    explicit Compiler(CompilerOptions options = {});
+
+    /**
+     * @brief Makes a word implemented by the host available to the programs compiled from now on.
+     *
+     * The function runs on the environment of the calling context and may be called by several
+     * threads at once when the program runs concurrently.
+     *
+     * @param name The name of the word.
+     * @param effect The effect of the word on the stack, StackEffect::Unknown() if it varies.
+     * @param function Pops the arguments of the word and pushes its results.
+     * @throws std::runtime_error If the name is one of the Builtins.
+     */
+    void DefineWord(const std::string& name, StackEffect effect, std::function<void(Environment&)> function);
+
+    /**
+     * @brief Compiles a program given as text.
+     * @param source The Forth source.
+     * @return The program, ready to run.
+     * @throws std::runtime_error On lexical and syntax errors.
+     */
+    std::unique_ptr<CompiledProgram> Compile(const std::string& source) const;
+
+    /**
+     * @brief Compiles the program in a file.
+     * @param file_path The path of the Forth source.
+     * @return The program, ready to run.
+     */
+    std::unique_ptr<CompiledProgram> CompileFile(const std::string& file_path) const;
+
+    /**
+     * @brief Runs the front end and the passes on the program in a file, without compiling it to bytecode.
+     * @param file_path The path of the Forth source.
+     * @return The linked and analyzed environment, as needed by the CppEmitter.
+     */
+    std::shared_ptr<Environment> AnalyzeFile(const std::string& file_path) const;
+
+    /**
+     * @brief Compiles an environment returned by AnalyzeFile.
+     * @param environment The analyzed environment.
+     * @return The program, ready to run.
+     */
+    std::unique_ptr<CompiledProgram> CompileAnalyzed(std::shared_ptr<Environment> environment) const;
+
+    /**
+     * @brief Loads a program saved with CompiledProgram::SaveImage, running it with the engine and JIT of the options.
+     * @param file_path The path of the image file.
+     * @return The program, ready to run.
+     * @throws std::runtime_error If the file is not a valid image or the options select the tree walker.
+     */
+    std::unique_ptr<CompiledProgram> LoadImage(const std::string& file_path) const;
+
+    /**
+     * @brief Lexes source with the builtins and the native words known to the compiler.
+     * @param text The source, comments included; the lexemes point into it.
+     * @return The parser holding the lexemes and stack comments.
+     */
+    Parser Lex(std::string_view text) const;
+
+    /**
+     * @brief Returns the passes and engine in use.
+     */
+    const CompilerOptions& options() const {
+        return options_;
+    }
+
+    /**
+     * @brief Returns the words defined by the host, by name.
+     */
+    const std::map<std::string, Environment::NativeWord>& native_words() const {
+        return native_words_;
+    }
+
+    /**
+     * @brief The keywords and words that end a code block, as expected by the GrammaticalAnalyzer.
+     */
+    static const std::vector<std::string> kCodeBlockEnders;
+
+private:
+    /**
+     * @brief Creates the machine running the bytecode with the engine and JIT of the options.
+     */
+    std::unique_ptr<VirtualMachine> NewMachine(BytecodeProgram program) const;
+
+    /**
+     * @brief Lexes, parses, links and analyzes the text of the preprocessor.
+     */
+    std::shared_ptr<Environment> Analyze(const Preprocessor& preprocessor) const;
+
+    CompilerOptions options_; ///< The passes and engine to use.
+    std::map<std::string, Environment::NativeWord> native_words_; ///< Words defined by the host.
+};
+
+#endif //COMPILER_H
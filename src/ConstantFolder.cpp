@@ -0,0 +1,140 @@
+#include "ConstantFolder.h"
+#include <sstream>
+#include <iomanip>
+
+const std::set<std::string> ConstantFolder::pure_builtins = {
+    "+", "-", "*", "/", "%", "negate", "invert", "lshift", "rshift",
+    "and", "or", "xor", "not", "=", "<", "<=", ">", ">=", "tocell", "tofloat",
+    "dup", "2dup", "drop", "swap", "over", "rot", "nip", "tuck",
+};
+
+void ConstantFolder::Fold(Environment& environment) {
+    environment.code->Accept(*this);
+    for (const auto& [name, body] : environment.functions) {
+        body->Accept(*this);
+    }
+}
+
+int ConstantFolder::GetFoldCount() const {
+    return fold_count_;
+}
+
+void ConstantFolder::Visit(VariableCreation&) {
+}
+
+void ConstantFolder::Visit(Codeblock& node) {
+    std::vector<std::shared_ptr<Executable>> folded;
+    for (const auto& statement : node.statements) {
+        statement->Accept(*this);
+        Append(folded, statement);
+    }
+    node.statements = std::move(folded);
+}
+
+void ConstantFolder::Visit(class While& node) {
+    node.condition->Accept(*this);
+    node.body->Accept(*this);
+}
+
+void ConstantFolder::Visit(class For& node) {
+    node.body->Accept(*this);
+}
+
+void ConstantFolder::Visit(class If& node) {
+    node.if_part->Accept(*this);
+    if (node.else_part) {
+        node.else_part->Accept(*this);
+    }
+}
+
+void ConstantFolder::Visit(class Switch& node) {
+    for (const auto& [selector, code] : node.cases) {
+        code->Accept(*this);
+    }
+}
+
+void ConstantFolder::Visit(Operator&) {
+}
+
+void ConstantFolder::Append(std::vector<std::shared_ptr<Executable>>& statements,
+                            const std::shared_ptr<Executable>& statement) {
+    if (auto block = std::dynamic_pointer_cast<Codeblock>(statement)) {
+        for (const auto& inner : block->statements) {
+            Append(statements, inner);
+        }
+        return;
+    }
+    auto literals = TrailingLiterals(statements);
+    if (auto if_statement = std::dynamic_pointer_cast<class If>(statement); if_statement && literals > 0) {
+        auto flag = std::static_pointer_cast<Operator>(statements.back())->constant;
+        statements.pop_back();
+        ++fold_count_;
+        auto& taken = flag.Convert<bool>() ? if_statement->if_part : if_statement->else_part;
+        if (taken) {
+            Append(statements, taken);
+        }
+        return;
+    }
+    if (auto switch_statement = std::dynamic_pointer_cast<class Switch>(statement); switch_statement && literals > 0) {
+        auto selector = std::static_pointer_cast<Operator>(statements.back())->constant.Convert<int64_t>();
+        statements.pop_back();
+        ++fold_count_;
+        auto taken = switch_statement->cases.find(selector);
+        if (taken != switch_statement->cases.end()) {
+            Append(statements, taken->second);
+        }
+        return;
+    }
+    auto builtin = std::dynamic_pointer_cast<Operator>(statement);
+    if (!builtin || builtin->kind != Operator::Kind::kBuiltin || !pure_builtins.contains(builtin->text)) {
+        statements.push_back(statement);
+        return;
+    }
+    const auto& descriptor = Operator::GetBuiltin(builtin->text);
+    auto inputs = static_cast<size_t>(descriptor.effect.inputs);
+    if (literals < inputs) {
+        statements.push_back(statement);
+        return;
+    }
+    Environment scratch;
+    for (size_t i = statements.size() - inputs; i < statements.size(); ++i) {
+        scratch.PushOnStack(std::static_pointer_cast<Operator>(statements[i])->constant);
+    }
+    if ((builtin->text == "/" || builtin->text == "%") &&
+        scratch.stack.back().IsInteger() && scratch.stack.back().cell.integer == 0) {
+        // leave the division by zero to run time
+        statements.push_back(statement);
+        return;
+    }
+    descriptor.checked(scratch);
+    statements.resize(statements.size() - inputs);
+    for (size_t i = 0; i < scratch.stack.size(); ++i) {
+        statements.push_back(MakeLiteral(scratch.stack[i]));
+    }
+    ++fold_count_;
+}
+
+size_t ConstantFolder::TrailingLiterals(const std::vector<std::shared_ptr<Executable>>& statements) {
+    size_t count = 0;
+    for (auto it = statements.rbegin(); it != statements.rend(); ++it) {
+        auto literal = std::dynamic_pointer_cast<Operator>(*it);
+        if (!literal || literal->kind != Operator::Kind::kLiteral) {
+            break;
+        }
+        ++count;
+    }
+    return count;
+}
+
+std::shared_ptr<Operator> ConstantFolder::MakeLiteral(const StackElement& value) {
+    std::ostringstream text;
+    if (value.IsInteger()) {
+        text << value.cell.integer;
+    } else {
+        text << std::setprecision(17) << value.cell.floating;
+    }
+    std::shared_ptr<Operator> literal(new Operator(text.str()));
+    literal->kind = Operator::Kind::kLiteral;
+    literal->constant = value;
+    return literal;
+}
@@ -0,0 +1,72 @@
+/**
+ * @file ConstantFolder.h
+ * @brief Defines the ConstantFolder pass evaluating literal arithmetic and constant branches at compile time.
+ */
+
+#ifndef CONSTANTFOLDER_H
+#define CONSTANTFOLDER_H
+
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+#include "Executable.h"
+#include "Environment.h"
+
+/**
+ * @class ConstantFolder
+ * @brief Folds pure builtins applied to literals, removes dead IF and CASE branches and flattens code blocks.
+ *
+ * A builtin from the pure set whose inputs are all pushed by literals directly before it is executed
+ * at compile time and replaced by literals pushing its results. An IF or CASE whose selector is a
+ * literal is replaced by the code of the branch that would run. Nested and empty code blocks are
+ * flattened away. Must run after the Linker.
+ */
+class ConstantFolder final : public ExecutableVisitor {
+public:
+    /**
+     * @brief Folds the main code and all words of the environment.
+     * @param environment The linked environment.
+     */
+    void Fold(Environment& environment);
+
+    /**
+     * @brief Returns the number of builtins and branches folded.
+     */
+    int GetFoldCount() const;
+
+    void Visit(VariableCreation& node) override;
+    void Visit(Codeblock& node) override;
+    void Visit(class While& node) override;
+    void Visit(class For& node) override;
+    void Visit(class If& node) override;
+    void Visit(class Switch& node) override;
+    void Visit(Operator& node) override;
+
+    /**
+     * @brief Builtins without side effects that may be evaluated at compile time.
+     */
+    static const std::set<std::string> pure_builtins;
+
+private:
+    /**
+     * @brief Appends an already folded statement to a statement list, folding it with the preceding literals.
+     * @param statements The statements folded so far.
+     * @param statement The statement to append.
+     */
+    void Append(std::vector<std::shared_ptr<Executable>>& statements, const std::shared_ptr<Executable>& statement);
+
+    /**
+     * @brief Counts how many statements at the end of the list are numeric literals.
+     */
+    static size_t TrailingLiterals(const std::vector<std::shared_ptr<Executable>>& statements);
+
+    /**
+     * @brief Creates a literal operator pushing the given value.
+     */
+    static std::shared_ptr<Operator> MakeLiteral(const StackElement& value);
+
+    int fold_count_ = 0; ///< The number of builtins and branches folded.
+};
+
+#endif //CONSTANTFOLDER_H
@@ -0,0 +1,464 @@
+#include "CppEmitter.h"
+#include <bit>
+#include <cmath>
+#include <iomanip>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+const std::map<std::string, std::string> CppEmitter::fast_paths = {
+    {"+", "Add"}, {"-", "Subtract"}, {"*", "Multiply"}, {"and", "And"}, {"or", "Or"}, {"xor", "Xor"},
+    {"<", "Less"}, {"<=", "LessEqual"}, {">", "Greater"}, {">=", "GreaterEqual"}, {"=", "Equal"},
+    {"dup", "Dup"}, {"over", "Over"}, {"drop", "Drop"}, {"swap", "Swap"}, {"nip", "Nip"},
+};
+
+void CppEmitter::Emit(Environment& environment, const std::string& source_name, std::ostream& out) {
+    int number = 0;
+    for (const auto& [name, body] : environment.functions) {
+        words_[name] = number++;
+    }
+    for (const auto& [name, body] : environment.functions) {
+        body_ << "\n// " << name << "\nvoid word_" << words_[name] << "(Environment& environment) {\n";
+        indent_ = 1;
+        body->Accept(*this);
+        body_ << "}\n";
+    }
+    body_ << "\nvoid Main(Environment& environment) {\n";
+    indent_ = 1;
+    environment.code->Accept(*this);
+    body_ << "}\n";
+
+    out << "// Generated by forth_interpretator --emit-cpp from " << source_name << "\n";
+    out << "#include <bit>\n#include <cstdint>\n#include <iostream>\n#include <stdexcept>\n#include <string>\n";
+    out << "#include <utility>\n#include \"Environment.h\"\n#include \"Executable.h\"\n#include \"ParallelLoop.h\"\n";
+    out << "#include \"Scheduler.h\"\n#include \"StackElement.h\"\n\n";
+    out << "namespace {\n\n";
+    for (const auto& [builtin, index] : builtins_) {
+        out << "Operator::Builtin builtin_" << index << "; // " << builtin.first << "\n";
+    }
+    for (const auto& [text, index] : strings_) {
+        out << "const std::string string_" << index << " = " << Quote(text) << ";\n";
+    }
+    for (size_t i = 0; i < variables_.size(); ++i) {
+        out << "VariableCreation variable_" << i << "; // " << variables_[i]->name << "\n";
+    }
+    out << R"(
+// Keeps a DO LOOP on the loop-control stack while it runs.
+struct LoopScope {
+    LoopScope(Environment& environment, int64_t from, int64_t to, int64_t step)
+        : loops(environment.loops), position(loops.size()) {
+        loops.push_back({from, to, step});
+    }
+
+    ~LoopScope() {
+        loops.pop_back();
+    }
+
+    // Publishes the index to words called from the body.
+    void Set(int64_t index) {
+        loops[position].index = index;
+    }
+
+    std::vector<Environment::LoopControl>& loops;
+    size_t position;
+};
+
+void PushVariable(Environment& environment, size_t slot) {
+    auto address = environment.slots[slot];
+    if (address == nullptr) {
+        throw std::runtime_error("unknown operator passed");
+    }
+    environment.PushOnStack(StackElement(reinterpret_cast<int64_t>(address)));
+}
+
+// Starts a task, which runs once the main code has finished.
+void Spawn(Environment& environment, Scheduler::Step step) {
+    auto task = Scheduler::NewTask(environment);
+    task->step = std::move(step);
+    Scheduler::Shared().Spawn(std::move(task));
+}
+
+void PushString(Environment& environment, const std::string& text) {
+    environment.PushOnStack(StackElement(reinterpret_cast<int64_t>(text.c_str() + 2)));
+    environment.PushOnStack(StackElement(static_cast<int64_t>(text.size() - 3)));
+}
+
+// Inline fast paths for integer operands and stack shuffles, falling back to the builtin otherwise.
+bool PopFlag(Environment& environment) {
+    auto* stack = environment.stack.storage();
+    if (stack->size == 0) {
+        return environment.PopStack().Convert<bool>();
+    }
+    --stack->size;
+    auto cell = stack->cells[stack->size];
+    return stack->tags[stack->size] == StackElement::Type::kInteger ? cell.integer != 0 : cell.floating != 0;
+}
+
+template<typename F>
+void Binary(Environment& environment, Operator::Builtin builtin, F op) {
+    auto* stack = environment.stack.storage();
+    auto size = stack->size;
+    if (size >= 2 && stack->tags[size - 1] == StackElement::Type::kInteger &&
+        stack->tags[size - 2] == StackElement::Type::kInteger) {
+        auto& a = stack->cells[size - 2].integer;
+        a = op(a, stack->cells[size - 1].integer);
+        stack->size = size - 1;
+    } else {
+        builtin(environment);
+    }
+}
+
+void Add(Environment& environment, Operator::Builtin builtin) {
+    Binary(environment, builtin, [](int64_t a, int64_t b) { return int64_t(uint64_t(a) + uint64_t(b)); });
+}
+
+void Subtract(Environment& environment, Operator::Builtin builtin) {
+    Binary(environment, builtin, [](int64_t a, int64_t b) { return int64_t(uint64_t(a) - uint64_t(b)); });
+}
+
+void Multiply(Environment& environment, Operator::Builtin builtin) {
+    Binary(environment, builtin, [](int64_t a, int64_t b) { return int64_t(uint64_t(a) * uint64_t(b)); });
+}
+
+void And(Environment& environment, Operator::Builtin builtin) {
+    Binary(environment, builtin, [](int64_t a, int64_t b) { return a & b; });
+}
+
+void Or(Environment& environment, Operator::Builtin builtin) {
+    Binary(environment, builtin, [](int64_t a, int64_t b) { return a | b; });
+}
+
+void Xor(Environment& environment, Operator::Builtin builtin) {
+    Binary(environment, builtin, [](int64_t a, int64_t b) { return a ^ b; });
+}
+
+void Less(Environment& environment, Operator::Builtin builtin) {
+    Binary(environment, builtin, [](int64_t a, int64_t b) { return int64_t(a < b); });
+}
+
+void LessEqual(Environment& environment, Operator::Builtin builtin) {
+    Binary(environment, builtin, [](int64_t a, int64_t b) { return int64_t(a <= b); });
+}
+
+void Greater(Environment& environment, Operator::Builtin builtin) {
+    Binary(environment, builtin, [](int64_t a, int64_t b) { return int64_t(a > b); });
+}
+
+void GreaterEqual(Environment& environment, Operator::Builtin builtin) {
+    Binary(environment, builtin, [](int64_t a, int64_t b) { return int64_t(a >= b); });
+}
+
+void Equal(Environment& environment, Operator::Builtin builtin) {
+    Binary(environment, builtin, [](int64_t a, int64_t b) { return int64_t(a == b); });
+}
+
+void Copy(Environment& environment, Operator::Builtin builtin, size_t depth) {
+    auto* stack = environment.stack.storage();
+    auto size = stack->size;
+    if (size >= depth && size < stack->capacity) {
+        stack->cells[size] = stack->cells[size - depth];
+        stack->tags[size] = stack->tags[size - depth];
+        stack->size = size + 1;
+    } else {
+        builtin(environment);
+    }
+}
+
+void Dup(Environment& environment, Operator::Builtin builtin) {
+    Copy(environment, builtin, 1);
+}
+
+void Over(Environment& environment, Operator::Builtin builtin) {
+    Copy(environment, builtin, 2);
+}
+
+void Drop(Environment& environment, Operator::Builtin builtin) {
+    auto* stack = environment.stack.storage();
+    if (stack->size >= 1) {
+        --stack->size;
+    } else {
+        builtin(environment);
+    }
+}
+
+void Swap(Environment& environment, Operator::Builtin builtin) {
+    auto* stack = environment.stack.storage();
+    auto size = stack->size;
+    if (size >= 2) {
+        std::swap(stack->cells[size - 1], stack->cells[size - 2]);
+        std::swap(stack->tags[size - 1], stack->tags[size - 2]);
+    } else {
+        builtin(environment);
+    }
+}
+
+void Nip(Environment& environment, Operator::Builtin builtin) {
+    auto* stack = environment.stack.storage();
+    auto size = stack->size;
+    if (size >= 2) {
+        stack->cells[size - 2] = stack->cells[size - 1];
+        stack->tags[size - 2] = stack->tags[size - 1];
+        stack->size = size - 1;
+    } else {
+        builtin(environment);
+    }
+}
+
+)";
+    for (const auto& [name, index] : words_) {
+        out << "void word_" << index << "(Environment& environment); // " << name << "\n";
+    }
+    out << body_.str();
+    out << "\nvoid Bind(Environment& environment) {\n";
+    for (const auto& [builtin, index] : builtins_) {
+        out << "    builtin_" << index << " = Operator::GetBuiltin(" << Quote(builtin.first) << ")."
+            << (builtin.second ? "unchecked" : "checked") << ";\n";
+    }
+    out << "    environment.slots.resize(" << environment.slots.size() << ");\n";
+    for (size_t i = 0; i < variables_.size(); ++i) {
+        out << "    variable_" << i << ".name = " << Quote(variables_[i]->name) << ";\n";
+        out << "    variable_" << i << ".size = " << variables_[i]->size << ";\n";
+        out << "    variable_" << i << ".type = " << Quote(variables_[i]->type) << ";\n";
+        out << "    variable_" << i << ".offset = environment.data_space.Allot(variable_" << i << ".ByteSize());\n";
+        out << "    variable_" << i << ".slot = " << variables_[i]->slot << ";\n";
+    }
+    out << "}\n\n} // namespace\n\n";
+    out << R"(int main() {
+    Environment environment;
+    try {
+        Bind(environment);
+        Main(environment);
+        Scheduler::Shared().Run();
+    } catch (std::exception& e) {
+        std::cout << e.what() << '\n';
+    }
+}
+)";
+}
+
+void CppEmitter::Visit(VariableCreation& node) {
+    Line() << "variable_" << variables_.size() << ".Execute(environment);\n";
+    variables_.push_back(&node);
+}
+
+void CppEmitter::Visit(Codeblock& node) {
+    for (const auto& statement : node.statements) {
+        statement->Accept(*this);
+    }
+}
+
+void CppEmitter::Visit(class While& node) {
+    Line() << "for (;;) {\n";
+    ++indent_;
+    ++loops_;
+    node.condition->Accept(*this);
+    Line() << "if (!PopFlag(environment)) {\n";
+    Line() << "    break;\n";
+    Line() << "}\n";
+    node.body->Accept(*this);
+    --loops_;
+    --indent_;
+    Line() << "}\n";
+}
+
+void CppEmitter::Visit(class For& node) {
+    auto id = std::to_string(labels_++);
+    if (node.parallel) {
+        std::string reduction = "nullptr";
+        if (!node.reduction.empty()) {
+            reduction = "builtin_" + std::to_string(BuiltinNumber(node.reduction, false));
+        }
+        // the body gets the environment of its chunk, shadowing the one of the enclosing code
+        Line() << "ParallelLoop::Run(environment, " << reduction << ", [&](Environment& environment, int64_t index_"
+               << id << ") {\n";
+        ++indent_;
+        auto enclosing_loops = std::exchange(loops_, 0);
+        do_loops_.push_back(id);
+        node.body->Accept(*this);
+        do_loops_.pop_back();
+        loops_ = enclosing_loops;
+        --indent_;
+        Line() << "});\n";
+        return;
+    }
+    Line() << "{\n";
+    ++indent_;
+    Line() << "auto from_" << id << " = environment.PopStack().Convert<int64_t>();\n";
+    Line() << "auto to_" << id << " = environment.PopStack().Convert<int64_t>();\n";
+    Line() << "auto step_" << id << " = environment.PopStack().Convert<int64_t>();\n";
+    Line() << "LoopScope scope_" << id << "(environment, from_" << id << ", to_" << id << ", step_" << id << ");\n";
+    Line() << "for (auto index_" << id << " = from_" << id << "; step_" << id << " > 0 ? index_" << id << " < to_"
+           << id << " : index_" << id << " > to_" << id << "; index_" << id << " += step_" << id << ") {\n";
+    ++indent_;
+    ++loops_;
+    do_loops_.push_back(id);
+    Line() << "scope_" << id << ".Set(index_" << id << ");\n";
+    node.body->Accept(*this);
+    do_loops_.pop_back();
+    --loops_;
+    --indent_;
+    Line() << "}\n";
+    --indent_;
+    Line() << "}\n";
+}
+
+void CppEmitter::Visit(class If& node) {
+    Line() << "if (PopFlag(environment)) {\n";
+    ++indent_;
+    node.if_part->Accept(*this);
+    --indent_;
+    if (node.else_part) {
+        Line() << "} else {\n";
+        ++indent_;
+        node.else_part->Accept(*this);
+        --indent_;
+    }
+    Line() << "}\n";
+}
+
+void CppEmitter::Visit(class Switch& node) {
+    auto id = std::to_string(labels_++);
+    Line() << "{\n";
+    ++indent_;
+    Line() << "auto selector_" << id << " = environment.PopStack().Convert<int64_t>();\n";
+    bool first = true;
+    for (const auto& [selector, code] : node.cases) {
+        Line() << (first ? "" : "} else ") << "if (selector_" << id << " == " << IntegerExpression(selector) << ") {\n";
+        first = false;
+        ++indent_;
+        code->Accept(*this);
+        --indent_;
+    }
+    if (!first) {
+        Line() << "}\n";
+    }
+    --indent_;
+    Line() << "}\n";
+}
+
+void CppEmitter::Visit(Operator& node) {
+    const auto& text = node.text;
+    if (text == "leave" || text == "continue") {
+        if (loops_ == 0) {
+            throw std::runtime_error("Operator '" + text + "' must be in loop");
+        }
+        Line() << (text == "leave" ? "break;\n" : "continue;\n");
+        return;
+    }
+    if (text == "return") {
+        Line() << "return;\n";
+        return;
+    }
+    if (node.kind == Operator::Kind::kUnresolved) {
+        throw std::runtime_error("unknown operator passed");
+    }
+    switch (node.kind) {
+        case Operator::Kind::kBuiltin: {
+            // indices of loops of the current function are C++ locals
+            auto depth = Operator::LoopIndexDepth(text);
+            if (depth >= 0 && depth < static_cast<int32_t>(do_loops_.size())) {
+                Line() << "environment.stack.push_back(StackElement(index_" << do_loops_[do_loops_.size() - 1 - depth]
+                       << "));\n";
+                break;
+            }
+            const auto& descriptor = Operator::GetBuiltin(text);
+            bool unchecked = node.builtin == descriptor.unchecked && node.builtin != descriptor.checked;
+            auto number = BuiltinNumber(text, unchecked);
+            auto fast_path = fast_paths.find(text);
+            if (fast_path != fast_paths.end()) {
+                Line() << fast_path->second << "(environment, builtin_" << number << ");\n";
+            } else {
+                Line() << "builtin_" << number << "(environment);\n";
+            }
+            break;
+        }
+        case Operator::Kind::kFunctionCall:
+            if (node.entry_check.known) {
+                Line() << "environment.RequireStack(" << node.entry_check.inputs << ", " << node.entry_check.peak
+                       << ");\n";
+            }
+            Line() << "word_" << words_[text] << "(environment); // " << text << "\n";
+            break;
+        case Operator::Kind::kVariableUse:
+            Line() << "PushVariable(environment, " << node.variable << "); // " << text << "\n";
+            break;
+        case Operator::Kind::kLiteral:
+            Line() << (node.unchecked ? "environment.stack.push_back_unchecked(" : "environment.stack.push_back(")
+                   << ValueExpression(node.constant) << ");\n";
+            break;
+        case Operator::Kind::kStringLiteral:
+            if (!strings_.contains(text)) {
+                auto index = static_cast<int>(strings_.size());
+                strings_[text] = index;
+            }
+            Line() << "PushString(environment, string_" << strings_[text] << ");\n";
+            break;
+        case Operator::Kind::kSpawn:
+            // generated words cannot be suspended, so every task runs to completion and PAUSE does nothing
+            Line() << "Spawn(environment, [](Environment& environment, size_t&) {\n";
+            if (node.entry_check.known) {
+                Line() << "    environment.RequireStack(" << node.entry_check.inputs << ", " << node.entry_check.peak
+                       << ");\n";
+            }
+            Line() << "    word_" << words_[text] << "(environment); // " << text << "\n";
+            Line() << "    return true;\n";
+            Line() << "});\n";
+            break;
+        case Operator::Kind::kNative:
+            throw std::runtime_error("Native word '" + text + "' cannot be translated to C++");
+        case Operator::Kind::kUnresolved:
+            break;
+    }
+}
+
+int CppEmitter::BuiltinNumber(const std::string& name, bool unchecked) {
+    auto key = std::make_pair(name, unchecked);
+    if (!builtins_.contains(key)) {
+        auto index = static_cast<int>(builtins_.size());
+        builtins_[key] = index;
+    }
+    return builtins_[key];
+}
+
+std::ostream& CppEmitter::Line() {
+    for (int i = 0; i < indent_; ++i) {
+        body_ << "    ";
+    }
+    return body_;
+}
+
+std::string CppEmitter::ValueExpression(const StackElement& value) {
+    std::ostringstream out;
+    if (value.IsInteger()) {
+        out << "StackElement(" << IntegerExpression(value.cell.integer) << ")";
+    } else if (std::isfinite(value.cell.floating)) {
+        out << "StackElement(" << std::hexfloat << value.cell.floating << ")";
+    } else {
+        out << "StackElement(std::bit_cast<double>(uint64_t(" << std::bit_cast<uint64_t>(value.cell.floating)
+            << "u)))";
+    }
+    return out.str();
+}
+
+std::string CppEmitter::IntegerExpression(int64_t value) {
+    if (value == std::numeric_limits<int64_t>::min()) {
+        return "INT64_MIN";
+    }
+    return "int64_t(" + std::to_string(value) + ")";
+}
+
+std::string CppEmitter::Quote(const std::string& text) {
+    std::ostringstream out;
+    out << '"';
+    for (unsigned char c : text) {
+        if (c == '"' || c == '\\') {
+            out << '\\' << c;
+        } else if (c < 0x20 || c >= 0x7F) {
+            out << '\\' << std::oct << std::setw(3) << std::setfill('0') << static_cast<int>(c) << std::dec;
+        } else {
+            out << c;
+        }
+    }
+    out << '"';
+    return out.str();
+}
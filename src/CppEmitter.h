@@ -0,0 +1,90 @@
+/**
+ * @file CppEmitter.h
+ * @brief Defines the CppEmitter translating an analyzed program into a standalone C++ translation unit.
+ */
+
+#ifndef CPPEMITTER_H
+#define CPPEMITTER_H
+
+#include <map>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+#include "Executable.h"
+#include "Environment.h"
+
+/**
+ * @class CppEmitter
+ * @brief Translates the Executable tree into C++ source linking against the interpreter runtime.
+ *
+ * Every word becomes a C++ function and control structures become C++ control flow, so the
+ * generated program can be optimized by a C++ compiler. Integer arithmetic, comparisons and stack
+ * shuffles are inlined; anything else, and any floating point operand, goes through the builtins in
+ * Operator::GetBuiltin, so the translated program behaves like the interpreted one. Must run after the Linker; optimization passes may run before it.
+ */
+class CppEmitter final : public ExecutableVisitor {
+public:
+    /**
+     * @brief Writes the translation unit for the main code and all words of the environment.
+     * @param environment The linked environment.
+     * @param source_name The name of the translated Forth file, mentioned in the header comment.
+     * @param out The stream to write the C++ source to.
+     */
+    void Emit(Environment& environment, const std::string& source_name, std::ostream& out);
+
+    void Visit(VariableCreation& node) override;
+    void Visit(Codeblock& node) override;
+    void Visit(class While& node) override;
+    void Visit(class For& node) override;
+    void Visit(class If& node) override;
+    void Visit(class Switch& node) override;
+    void Visit(Operator& node) override;
+
+    /**
+     * @brief Builtins with an inline integer fast path in the generated code, mapped to the helper implementing it.
+     */
+    static const std::map<std::string, std::string> fast_paths;
+
+private:
+    /**
+     * @brief Returns the number of the builtin_ pointer holding a builtin, allocating it on first use.
+     * @param name The name of the builtin.
+     * @param unchecked Whether the pointer holds the unchecked implementation.
+     */
+    int BuiltinNumber(const std::string& name, bool unchecked);
+
+    /**
+     * @brief Starts a new line of the function body at the current indentation.
+     * @return The stream to write the line to.
+     */
+    std::ostream& Line();
+
+    /**
+     * @brief Returns a C++ expression constructing the given value.
+     */
+    static std::string ValueExpression(const StackElement& value);
+
+    /**
+     * @brief Returns a C++ expression of type int64_t with the given value.
+     */
+    static std::string IntegerExpression(int64_t value);
+
+    /**
+     * @brief Returns a C++ string literal with the given contents.
+     */
+    static std::string Quote(const std::string& text);
+
+    std::ostringstream body_;  ///< Function definitions generated so far.
+    int indent_ = 0;           ///< Indentation depth of the current line.
+    int loops_ = 0;            ///< Number of loops enclosing the current statement in the current function.
+    std::vector<std::string> do_loops_; ///< Names of the DO LOOPs enclosing the current statement, innermost last.
+    int labels_ = 0;           ///< Counter for unique local names.
+    std::map<std::string, int> words_;                      ///< Word names to function numbers.
+    std::map<std::pair<std::string, bool>, int> builtins_;  ///< Builtin name and uncheckedness to pointer numbers.
+    std::map<std::string, int> strings_;                    ///< String literals to constant numbers.
+    std::vector<VariableCreation*> variables_;              ///< Variable creations in order of appearance.
+};
+
+#endif //CPPEMITTER_H
@@ -0,0 +1,94 @@
+#include "DataSpace.h"
+#include <algorithm>
+#include <cstdlib>
+#include <stdexcept>
+#if defined(__unix__)
+#include <sys/mman.h>
+#endif
+
+namespace {
+
+// Memory is committed in steps of this size.
+constexpr size_t kCommitGranularity = size_t(64) << 10;
+
+// Size of the region allocated up front where the address space cannot be reserved.
+constexpr size_t kFallbackBytes = size_t(64) << 20;
+
+size_t AlignUp(size_t value, size_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+} // namespace
+
+DataSpace::~DataSpace() {
+    if (base_ == nullptr) {
+        return;
+    }
+#if defined(__unix__)
+    munmap(mapping_, reserved_ + kHugePageBytes);
+#else
+    std::free(mapping_);
+#endif
+}
+
+size_t DataSpace::Allot(size_t bytes) {
+    bool huge = huge_pages_ && bytes >= kHugePageBytes;
+    size_t offset = AlignUp(here_, huge ? kHugePageBytes : kCellAlignment);
+    if (base_ == nullptr) {
+        Reserve();
+    }
+    if (bytes > reserved_ || offset > reserved_ - bytes) {
+        throw std::runtime_error("Data space is exhausted");
+    }
+    Commit(offset + bytes);
+#if defined(__unix__) && defined(MADV_HUGEPAGE)
+    if (huge) {
+        madvise(base_ + offset, AlignUp(bytes, kHugePageBytes), MADV_HUGEPAGE);
+    }
+#endif
+    here_ = offset + bytes;
+    return offset;
+}
+
+void DataSpace::Reserve() {
+#if defined(__unix__)
+    // one huge page more than needed, so that the start can be aligned to a huge page; under a limit
+    // on the address space smaller ranges are tried, down to kFallbackBytes
+    size_t bytes = AlignUp(limit_, kCommitGranularity);
+    void* memory;
+    while (true) {
+        memory = mmap(nullptr, bytes + kHugePageBytes, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (memory != MAP_FAILED || bytes <= kFallbackBytes) {
+            break;
+        }
+        bytes = std::max(bytes / 2, kFallbackBytes);
+    }
+    if (memory == MAP_FAILED) {
+        throw std::runtime_error("Cannot reserve the data space");
+    }
+    mapping_ = memory;
+    base_ = reinterpret_cast<std::byte*>(AlignUp(reinterpret_cast<size_t>(memory), kHugePageBytes));
+    reserved_ = bytes;
+#else
+    mapping_ = std::calloc(kFallbackBytes, 1);
+    if (mapping_ == nullptr) {
+        throw std::runtime_error("Cannot reserve the data space");
+    }
+    base_ = static_cast<std::byte*>(mapping_);
+    reserved_ = kFallbackBytes;
+    committed_ = kFallbackBytes;
+#endif
+}
+
+void DataSpace::Commit(size_t end) {
+    if (end <= committed_) {
+        return;
+    }
+    size_t new_committed = std::min(AlignUp(end, kCommitGranularity), reserved_);
+#if defined(__unix__)
+    if (mprotect(base_ + committed_, new_committed - committed_, PROT_READ | PROT_WRITE) != 0) {
+        throw std::runtime_error("Cannot commit the data space");
+    }
+#endif
+    committed_ = new_committed;
+}
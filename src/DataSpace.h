@@ -0,0 +1,112 @@
+/**
+ * @file DataSpace.h
+ * @brief Defines the DataSpace class holding the memory of all variables and arrays of a program.
+ */
+
+#ifndef DATASPACE_H
+#define DATASPACE_H
+
+#include <cstddef>
+
+/**
+ * @class DataSpace
+ * @brief A contiguous region of memory handed out in increasing order, like the data space of Forth.
+ *
+ * The whole region is reserved in the address space on first use and committed as it grows,
+ * so addresses of allotted memory never change. Where the address space is limited, smaller
+ * regions are tried. Variables get their offsets when the program is linked; HERE is the offset
+ * of the first free byte.
+ */
+class DataSpace {
+public:
+    /**
+     * @brief Size of the reserved address range unless limited with LimitTo.
+     */
+    static constexpr size_t kReservedBytes = size_t(1) << 34;
+
+    /**
+     * @brief Alignment of every allotment, the size of a cell.
+     */
+    static constexpr size_t kCellAlignment = 8;
+
+    /**
+     * @brief Allotments of at least this size are aligned to and backed by huge pages if enabled.
+     */
+    static constexpr size_t kHugePageBytes = size_t(2) << 20;
+
+    DataSpace() = default;
+    DataSpace(const DataSpace&) = delete;
+    DataSpace& operator=(const DataSpace&) = delete;
+    ~DataSpace();
+
+    /**
+     * @brief Reserves memory at the end of the data space.
+     * @param bytes The number of bytes to reserve.
+     * @return The offset of the reserved memory, aligned to a cell.
+     * @throws std::runtime_error If the data space is exhausted.
+     */
+    size_t Allot(size_t bytes);
+
+    /**
+     * @brief Returns the offset of the first free byte.
+     */
+    size_t Here() const {
+        return here_;
+    }
+
+    /**
+     * @brief Returns the address of the byte at the given offset.
+     * @param offset An offset returned by Allot or Here.
+     */
+    void* Address(size_t offset) {
+        if (base_ == nullptr) {
+            Reserve();
+        }
+        return base_ + offset;
+    }
+
+    /**
+     * @brief Reserves only the given size on first use, for data spaces whose layout is already known.
+     * @param bytes The most bytes that will be allotted.
+     */
+    void LimitTo(size_t bytes) {
+        limit_ = bytes;
+    }
+
+    /**
+     * @brief Backs allotments of at least kHugePageBytes with transparent huge pages where supported.
+     * @param enabled Whether huge pages are used for later allotments.
+     */
+    void UseHugePages(bool enabled) {
+        huge_pages_ = enabled;
+    }
+
+    /**
+     * @brief Returns whether large allotments are backed by huge pages.
+     */
+    bool UsesHugePages() const {
+        return huge_pages_;
+    }
+
+private:
+    /**
+     * @brief Reserves the address range of the data space.
+     */
+    void Reserve();
+
+    /**
+     * @brief Makes the memory up to the given offset usable.
+     * @param end The offset one past the last byte needed.
+     */
+    void Commit(size_t end);
+
+    void* mapping_ = nullptr;       ///< The memory obtained from the system.
+    std::byte* base_ = nullptr;     ///< Start of the reserved range, null until first use.
+    size_t here_ = 0;               ///< Offset of the first free byte.
+    size_t committed_ = 0;          ///< Number of bytes usable from base_.
+    size_t reserved_ = 0;           ///< Number of bytes reserved from base_.
+    size_t limit_ = kReservedBytes; ///< Number of bytes to reserve on first use.
+    bool huge_pages_ = false;       ///< Whether large allotments are backed by huge pages.
+};
+
+#endif //DATASPACE_H
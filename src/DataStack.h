@@ -0,0 +1,164 @@
+/**
+ * @file DataStack.h
+ * @brief Defines the DataStack class storing stack elements as separate cell and tag arrays.
+ */
+
+#ifndef DATASTACK_H
+#define DATASTACK_H
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include "StackElement.h"
+
+/**
+ * @class DataStack
+ * @brief The data stack of the interpreter.
+ *
+ * Values and their type tags are kept in two parallel arrays, so every slot costs
+ * 8 bytes of cell plus one byte of tag instead of the padded 16 bytes of a StackElement.
+ * The interface mirrors the subset of std::vector the interpreter uses, plus
+ * unchecked operations for code whose stack depth was verified in advance.
+ */
+class DataStack {
+public:
+    /**
+     * @struct Storage
+     * @brief The raw state of the stack, with a fixed layout that generated machine code can address.
+     */
+    struct Storage {
+        StackElement::Cell* cells = nullptr; ///< Storage for the values, bottom of the stack first.
+        StackElement::Type* tags = nullptr;  ///< Storage for the type of each value in cells.
+        size_t size = 0;                     ///< The number of elements on the stack.
+        size_t capacity = 0;                 ///< The number of elements cells and tags have room for.
+    };
+
+    DataStack() = default;
+
+    DataStack(const DataStack& other) {
+        *this = other;
+    }
+
+    DataStack& operator=(const DataStack& other) {
+        if (this != &other) {
+            clear();
+            reserve(other.storage_.capacity);
+            std::copy_n(other.storage_.cells, other.storage_.size, storage_.cells);
+            std::copy_n(other.storage_.tags, other.storage_.size, storage_.tags);
+            storage_.size = other.storage_.size;
+        }
+        return *this;
+    }
+
+    ~DataStack() {
+        delete[] storage_.cells;
+        delete[] storage_.tags;
+    }
+
+    /**
+     * @brief Returns the number of elements on the stack.
+     */
+    size_t size() const {
+        return storage_.size;
+    }
+
+    /**
+     * @brief Checks whether the stack is empty.
+     */
+    bool empty() const {
+        return storage_.size == 0;
+    }
+
+    /**
+     * @brief Returns the element at the given position, counting from the bottom of the stack.
+     * @param index The position of the element.
+     */
+    StackElement operator[](size_t index) const {
+        return StackElement(storage_.cells[index], storage_.tags[index]);
+    }
+
+    /**
+     * @brief Returns the top element of the stack.
+     */
+    StackElement back() const {
+        return StackElement(storage_.cells[storage_.size - 1], storage_.tags[storage_.size - 1]);
+    }
+
+    /**
+     * @brief Replaces the top element of the stack.
+     * @param element The new top element.
+     */
+    void set_back(StackElement element) {
+        storage_.cells[storage_.size - 1] = element.cell;
+        storage_.tags[storage_.size - 1] = element.type;
+    }
+
+    /**
+     * @brief Pushes an element on top of the stack, growing the storage if needed.
+     * @param element The element to push.
+     */
+    void push_back(StackElement element) {
+        if (storage_.size == storage_.capacity) {
+            reserve(storage_.size * 2 + 16);
+        }
+        push_back_unchecked(element);
+    }
+
+    /**
+     * @brief Pushes an element without checking the capacity.
+     *
+     * The caller must have reserved enough space beforehand.
+     *
+     * @param element The element to push.
+     */
+    void push_back_unchecked(StackElement element) {
+        storage_.cells[storage_.size] = element.cell;
+        storage_.tags[storage_.size] = element.type;
+        ++storage_.size;
+    }
+
+    /**
+     * @brief Removes the top element of the stack.
+     */
+    void pop_back() {
+        --storage_.size;
+    }
+
+    /**
+     * @brief Preallocates storage for the given number of elements.
+     * @param capacity The number of elements to reserve space for.
+     */
+    void reserve(size_t capacity) {
+        if (capacity <= storage_.capacity) {
+            return;
+        }
+        auto cells = std::make_unique<StackElement::Cell[]>(capacity);
+        auto tags = std::make_unique<StackElement::Type[]>(capacity);
+        std::copy_n(storage_.cells, storage_.size, cells.get());
+        std::copy_n(storage_.tags, storage_.size, tags.get());
+        delete[] storage_.cells;
+        delete[] storage_.tags;
+        storage_.cells = cells.release();
+        storage_.tags = tags.release();
+        storage_.capacity = capacity;
+    }
+
+    /**
+     * @brief Removes all elements from the stack.
+     */
+    void clear() {
+        storage_.size = 0;
+    }
+
+    /**
+     * @brief Returns the raw state of the stack for generated code operating on it directly.
+     */
+    Storage* storage() {
+        return &storage_;
+    }
+
+private:
+    Storage storage_; ///< The cells, tags, size and capacity of the stack.
+};
+
+#endif //DATASTACK_H
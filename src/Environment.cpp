@@ -32,3 +32,20 @@ StackElement Environment::PopStack() {
 void Environment::PushOnStack(StackElement s) {
     stack.push_back(s);
 }
+
+/**
+ * @brief Checks the stack once before running code with a known stack effect.
+ *
+ * Verifies that the code can pop its inputs and reserves room for its highest point,
+ * so the code itself can use the unchecked stack operations.
+ *
+ * @param inputs The number of elements the code consumes.
+ * @param peak The highest stack height the code reaches, relative to the height after consuming its inputs.
+ * @throws std::runtime_error If the stack holds fewer than inputs elements.
+ */
+void Environment::RequireStack(int64_t inputs, int64_t peak) {
+    if (static_cast<int64_t>(stack.size()) < inputs) {
+        throw std::runtime_error("Zero elements on stack when popping it");
+    }
+    stack.reserve(stack.size() - inputs + peak);
+}
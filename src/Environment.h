@@ -10,12 +10,22 @@
 #include <map>
 #include <string>
 #include <memory>
+#include <functional>
+#include <stdexcept>
 #include "StackElement.h"
+#include "StackEffect.h"
+#include "DataStack.h"
+#include "DataSpace.h"
 class Executable;
+class Scheduler;
 
 /**
  * @class Environment
  * @brief Represents an execution environment with stack, variables, and functions.
+ *
+ * The front end fills the words, main code and variable names of one environment; running
+ * the program needs only the stacks, slots and data space, so several environments may run
+ * one compiled program at once (see CompiledProgram).
  */
 class Environment {
 public:
@@ -25,11 +35,57 @@ public:
     std::map<std::string, std::shared_ptr<Executable>> functions;
 
     /**
-     * @brief A map of variable names to their corresponding values.
+     * @struct NativeWord
+     * @brief A word implemented in C++ by the program embedding the interpreter.
+     */
+    struct NativeWord {
+        std::function<void(Environment&)> function; ///< Pops the arguments of the word and pushes its results.
+        StackEffect effect;                          ///< The effect of the word, Unknown() if it varies.
+    };
+
+    /**
+     * @brief Words provided by the host, by name; operators resolve to them before user-defined words.
+     */
+    std::map<std::string, NativeWord> native_words;
+
+    /**
+     * @brief The stack effect of every word the StackEffectAnalyzer could determine it for.
+     *
+     * Such words pop and push without checks, so their callers verify the stack first.
+     */
+    std::map<std::string, StackEffect> word_effects;
+
+    /**
+     * @brief A map of variable names to their slots in slots, assigned when the program is linked.
+     */
+    std::map<std::string, size_t> variables;
+
+    /**
+     * @brief Returns the slot of a variable, assigning the next free one to a new name.
+     * @param name The name of the variable.
+     * @return The index into slots.
+     */
+    size_t VariableSlot(const std::string& name) {
+        auto [slot, inserted] = variables.try_emplace(name, variables.size());
+        if (inserted) {
+            slots.resize(variables.size(), nullptr);
+        }
+        return slot->second;
+    }
+
+    /**
+     * @brief The address of every variable in data_space by slot.
      *
-     * The values are stored as void pointers to allow flexibility in data types.
+     * A null value marks a variable that is referenced by linked code but not created yet.
+     * Compiled code reaches variables only through these slots, so every environment running
+     * a program has variables of its own.
+     */
+    std::vector<void*> slots;
+
+    /**
+     * @brief The memory of all variables and arrays, laid out when the program is linked.
      */
-    std::map<std::string, void*> variables;
+    DataSpace data_space;
 
     /**
      * @brief A shared pointer to the main executable code for the environment.
@@ -56,10 +112,103 @@ public:
      */
     void PushOnStack(StackElement s);
 
+    /**
+     * @brief Removes and returns the top element from the stack without checking for underflow.
+     *
+     * Only valid in code whose stack depth was verified on entry with RequireStack().
+     *
+     * @return The top element of the stack.
+     */
+    StackElement PopStackUnchecked() {
+        auto res = stack.back();
+        stack.pop_back();
+        return res;
+    }
+
+    /**
+     * @brief Pushes a new element onto the stack without checking the capacity.
+     *
+     * Only valid in code whose stack growth was reserved on entry with RequireStack().
+     *
+     * @param s The element to be pushed onto the stack.
+     */
+    void PushOnStackUnchecked(StackElement s) {
+        stack.push_back_unchecked(s);
+    }
+
+    /**
+     * @brief Checks the stack once before running code with a known stack effect.
+     *
+     * Verifies that the code can pop its inputs and reserves room for its highest point.
+     *
+     * @param inputs The number of elements the code consumes.
+     * @param peak The highest stack height the code reaches, relative to the height after consuming its inputs.
+     * @throws std::runtime_error If the stack holds fewer than inputs elements.
+     */
+    void RequireStack(int64_t inputs, int64_t peak);
+
     /**
      * @brief The stack used to manage execution state and data.
      */
-    std::vector<StackElement> stack;
+    DataStack stack;
+
+    /**
+     * @struct ReturnFrame
+     * @brief A call of a word made by the VirtualMachine.
+     */
+    struct ReturnFrame {
+        size_t address; ///< The address of the instruction to continue at after the word returns.
+        size_t loops;   ///< The number of DO LOOPs active when the word was called.
+    };
+
+    /**
+     * @brief The return stack of the VirtualMachine, innermost call last.
+     *
+     * Calls push frames here instead of recursing on the native stack,
+     * so the recursion depth is limited only by memory.
+     */
+    std::vector<ReturnFrame> return_stack;
+
+    /**
+     * @struct LoopControl
+     * @brief State of one active DO LOOP.
+     */
+    struct LoopControl {
+        int64_t index; ///< The current loop index.
+        int64_t to;    ///< The bound the index is compared against.
+        int64_t step;  ///< The increment of the index.
+    };
+
+    /**
+     * @brief The loop-control stack holding the active DO LOOPs, innermost last.
+     */
+    std::vector<LoopControl> loops;
+
+    /**
+     * @brief The scheduler running the tasks the code on this environment spawns.
+     *
+     * Contexts from CompiledProgram::NewContext have one each, so that runs on different threads do
+     * not share task queues; without one, tasks go to Scheduler::Shared().
+     */
+    std::shared_ptr<Scheduler> scheduler;
+
+    /**
+     * @brief The number of words compiled to native code currently running on this environment.
+     */
+    int native_depth = 0;
+
+    /**
+     * @brief Returns the index of an active DO LOOP, as read by I, J and K.
+     * @param depth 0 for the innermost loop, 1 for the loop enclosing it and so on.
+     * @return The current index of the loop.
+     * @throws std::runtime_error If fewer than depth + 1 loops are active.
+     */
+    int64_t LoopIndex(size_t depth) const {
+        if (depth >= loops.size()) {
+            throw std::runtime_error("Loop index used outside of a loop");
+        }
+        return loops[loops.size() - 1 - depth].index;
+    }
 
 private:
 };
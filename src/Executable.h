@@ -9,8 +9,38 @@
 #include <memory>
 #include <vector>
 #include <map>
-#include <functional>
+#include <string_view>
 #include "Environment.h"
+#include "StackEffect.h"
+#include "CaseTable.h"
+
+class VariableCreation;
+class Codeblock;
+class While;
+class For;
+class If;
+class Switch;
+class Operator;
+
+/**
+ * @class ExecutableVisitor
+ * @brief Interface for passes that walk the Executable tree.
+ */
+class ExecutableVisitor {
+public:
+    virtual void Visit(VariableCreation& node) = 0;
+    virtual void Visit(Codeblock& node) = 0;
+    virtual void Visit(While& node) = 0;
+    virtual void Visit(For& node) = 0;
+    virtual void Visit(If& node) = 0;
+    virtual void Visit(Switch& node) = 0;
+    virtual void Visit(Operator& node) = 0;
+
+    /**
+     * @brief Virtual destructor for the ExecutableVisitor class.
+     */
+    virtual ~ExecutableVisitor() = default;
+};
 
 /**
  * @class Executable
@@ -35,6 +65,12 @@ public:
      */
     virtual ReturnStatus Execute(Environment& environment) = 0;
 
+    /**
+     * @brief Dispatches to the matching Visit overload of the visitor.
+     * @param visitor The pass walking the tree.
+     */
+    virtual void Accept(ExecutableVisitor& visitor) = 0;
+
     /**
      * @brief Virtual destructor for the Executable class.
      */
@@ -54,9 +90,18 @@ public:
      */
     ReturnStatus Execute(Environment& environment) override;
 
+    void Accept(ExecutableVisitor& visitor) override;
+
+    /**
+     * @brief Returns the number of bytes the variable occupies in the data space.
+     */
+    size_t ByteSize() const;
+
     std::string name; ///< The name of the variable to be created.
     int64_t size;    ///< The size of the variable.
     std::string type; ///< The type of the variable.
+    size_t offset = 0; ///< The position of the variable in Environment::data_space, assigned by the Linker.
+    size_t slot = 0;   ///< The slot in Environment::slots receiving the address, assigned by the Linker.
 };
 
 /**
@@ -72,6 +117,8 @@ public:
      */
     ReturnStatus Execute(Environment& environment) override;
 
+    void Accept(ExecutableVisitor& visitor) override;
+
     std::vector<std::shared_ptr<Executable>> statements; ///< The statements to execute.
 };
 
@@ -88,6 +135,8 @@ public:
      */
     ReturnStatus Execute(Environment& environment) override;
 
+    void Accept(ExecutableVisitor& visitor) override;
+
     std::shared_ptr<Executable> condition; ///< The condition for the while loop.
     std::shared_ptr<Executable> body;      ///< The body of the while loop.
 };
@@ -95,6 +144,9 @@ public:
 /**
  * @class For
  * @brief Represents a for loop structure.
+ *
+ * A parallel loop (PDO ... PLOOP) splits its range into chunks run by the threads of a
+ * WorkStealingPool, each on its own copy of the data stack.
  */
 class For final : public Executable {
 public:
@@ -105,7 +157,11 @@ public:
      */
     ReturnStatus Execute(Environment& environment) override;
 
+    void Accept(ExecutableVisitor& visitor) override;
+
     std::shared_ptr<Executable> body; ///< The body of the for loop.
+    bool parallel = false;            ///< Whether the loop is a PDO ... PLOOP.
+    std::string reduction;            ///< For a parallel loop, the builtin combining the results of the chunks, or empty.
 };
 
 /**
@@ -121,6 +177,8 @@ public:
      */
     ReturnStatus Execute(Environment& environment) override;
 
+    void Accept(ExecutableVisitor& visitor) override;
+
     std::shared_ptr<Executable> if_part;   ///< The statements to execute if the condition is true.
     std::shared_ptr<Executable> else_part; ///< The statements to execute if the condition is false.
 };
@@ -138,7 +196,15 @@ public:
      */
     ReturnStatus Execute(Environment& environment) override;
 
+    void Accept(ExecutableVisitor& visitor) override;
+
+    /**
+     * @brief Builds the lookup table Execute dispatches through; must be called whenever cases change.
+     */
+    void BuildTable();
+
     std::map<int64_t, std::shared_ptr<Executable>> cases; ///< The cases for the switch statement.
+    CaseTable<Executable*> table; ///< The bodies of cases by selector.
 };
 
 /**
@@ -147,6 +213,34 @@ public:
  */
 class Operator final : public Executable {
 public:
+    /**
+     * @brief Signature of the functions implementing builtin operators.
+     */
+    using Builtin = ReturnStatus (*)(Environment&);
+
+    /**
+     * @brief Implementations and stack effect of a builtin operator.
+     */
+    struct BuiltinDescriptor {
+        Builtin checked;    ///< Implementation checking the stack on every pop and push.
+        Builtin unchecked;  ///< Implementation for code whose stack depth was verified on entry.
+        StackEffect effect; ///< The effect of the builtin on the stack.
+    };
+
+    /**
+     * @brief What the operator text was resolved to.
+     */
+    enum class Kind {
+        kUnresolved,    ///< Not resolved yet.
+        kBuiltin,       ///< A builtin operator found by FindBuiltin.
+        kFunctionCall,  ///< A call of a user-defined word.
+        kVariableUse,   ///< A reference to a variable.
+        kLiteral,       ///< An integer or floating point literal.
+        kStringLiteral, ///< A string literal.
+        kSpawn,         ///< SPAWN of a user-defined word, set by the GrammaticalAnalyzer.
+        kNative         ///< A call of a word provided by the host in Environment::native_words.
+    };
+
     /**
      * @brief Constructs an Operator with the given text.
      * @param text The text representing the operator.
@@ -155,17 +249,56 @@ public:
 
     /**
      * @brief Executes the operator.
+     *
+     * Resolves the operator first if the Linker has not done so.
+     *
      * @param environment The execution environment.
      * @return The return status of the execution.
      */
     ReturnStatus Execute(Environment& environment) override;
 
+    void Accept(ExecutableVisitor& visitor) override;
+
+    /**
+     * @brief Binds the operator text to a builtin, a host word, a word, a variable slot or a parsed literal.
+     * @param environment The environment holding the words and variables of the program.
+     */
+    void Resolve(Environment& environment);
+
+    /**
+     * @brief Returns how many DO LOOPs out from the innermost one a loop index word reads.
+     * @param text The text of an operator.
+     * @return 0 for I, 1 for J, 2 for K and -1 for any other text.
+     */
+    static int32_t LoopIndexDepth(const std::string& text);
+
     std::string text; ///< The text representing the operator.
 
+    Kind kind = Kind::kUnresolved;   ///< What the text was resolved to.
+    Builtin builtin = nullptr;       ///< The builtin to call for kBuiltin.
+    Executable* callee = nullptr;    ///< The body of the word to call for kFunctionCall or to spawn for kSpawn.
+    const Environment::NativeWord* native = nullptr; ///< The host word to call for kNative.
+    size_t variable = 0;             ///< The slot in Environment::slots holding the address of the variable for kVariableUse.
+    StackElement constant = StackElement(int64_t(0)); ///< The parsed value for kLiteral.
+    bool unchecked = false;          ///< Whether pushes may skip the capacity check, set inside words with a known stack effect.
+    StackEffect entry_check = StackEffect::Unknown(); ///< For kFunctionCall and kSpawn, the effect to verify before the word runs if known.
+
+    /**
+     * @brief Looks a builtin operator up in the constant table indexed like Builtins::kWords.
+     *
+     * Never allocates and the table never changes, so any number of threads may look builtins up at once.
+     *
+     * @param name The name of the operator.
+     * @return Its implementations, or nullptr if the name is not an operator the dispatcher implements.
+     */
+    static const BuiltinDescriptor* FindBuiltin(std::string_view name);
+
     /**
-     * @brief A map of operator names to their corresponding functions.
+     * @brief Returns the implementations of a builtin operator.
+     * @param name The name of the operator.
+     * @throws std::out_of_range If the name is not an operator the dispatcher implements.
      */
-    static std::map<std::string, std::function<ReturnStatus (Environment&)>> operators_pointers;
+    static const BuiltinDescriptor& GetBuiltin(std::string_view name);
 
 private:
     /**
@@ -175,6 +308,13 @@ private:
      */
     ReturnStatus FunctionCall(Environment& environment);
 
+    /**
+     * @brief Moves the arguments of SPAWN into a new task running the word and hands it to the Scheduler.
+     * @param environment The execution environment.
+     * @return The return status of the execution.
+     */
+    ReturnStatus Spawn(Environment& environment);
+
     /**
      * @brief Handles variable use during execution.
      * @param environment The execution environment.
@@ -1,23 +1,34 @@
 #include "Executable.h"
+#include "ParallelLoop.h"
 
 Executable::ReturnStatus For::Execute(Environment &environment) {
+    if (parallel) {
+        auto combine = reduction.empty() ? nullptr : Operator::GetBuiltin(reduction).checked;
+        ParallelLoop::Run(environment, combine, [this](Environment& worker, int64_t) {
+            body->Execute(worker);
+        });
+        return ReturnStatus::kSuccess;
+    }
     auto from = environment.PopStack().Convert<int64_t>();
     auto to = environment.PopStack().Convert<int64_t>();
     auto step = environment.PopStack().Convert<int64_t>();
-    auto old_ptr = environment.variables["I"];
-    std::shared_ptr<int64_t> iptr(new int64_t);
-    environment.variables["I"] = iptr.get();
+    environment.loops.push_back({from, to, step});
+    auto result = ReturnStatus::kSuccess;
     for (auto i = from; (step > 0 ? i < to : i > to); i += step) {
-        *iptr = i;
+        environment.loops.back().index = i;
         auto status = body->Execute(environment);
         if (status == ReturnStatus::kLeaveLoop) {
             break;
         }
         if (status == ReturnStatus::kLeaveFunction) {
-            return status;
+            result = status;
+            break;
         }
     }
-    environment.variables["I"] = old_ptr;
-    return ReturnStatus::kSuccess;
+    environment.loops.pop_back();
+    return result;
 }
 
+void For::Accept(ExecutableVisitor& visitor) {
+    visitor.Visit(*this);
+}
@@ -2,49 +2,216 @@
 #include "Executable.h"
 #include "Environment.h"
 #include "Literals.h"
+#include "WorkStealingPool.h"
 #include <stdexcept>
-#include <iostream>
 #include <utility>
-#include <regex>
+
+namespace {
+
+// Builtins that do I/O, whose order the chunks of a PDO loop would mix up.
+const std::set<std::string, std::less<>> kSequentialOperators = {".", ".s", "emit", "type", "input", "finput", "sinput"};
+
+// Definitions and builtins using the data space of the main environment, which PDO chunks and tasks do not share.
+const std::set<std::string, std::less<>> kMemoryOperators = {"VARIABLE", "CREATE", "here"};
+
+// Programs are parsed in ranges of at least this many lexemes on the WorkStealingPool.
+constexpr size_t kRangeLexemes = 1 << 14;
+
+} // namespace
 
 // public
 
 void GrammaticalAnalyzer::Analyze() {
-    try {
-        defined_identifiers.insert("I"); //special variable for index of most inner for loop
-        Program();
-        for (auto l: lexemes_) {
-            if (l.type == Lexeme::LexemeType::kIdentifier &&
-                !defined_identifiers.contains(l.text)) {
-                ThrowUndefinedException(l);
+    // loop index words, accepted even where they are not configured as operators
+    defined_identifiers.insert({"I", "J", "K"});
+    // before a definition and after its ';' a single pass is at the top level, unless it fails on
+    // that lexeme, which the range ending there then fails on in the same way
+    std::vector<size_t> bounds = {0};
+    bool in_definition = false;
+    for (size_t i = 0; i < lexemes_->size(); ++i) {
+        const auto& l = (*lexemes_)[i];
+        if (l.type == Lexeme::LexemeType::kFunctionDefinitionStart && !in_definition) {
+            in_definition = true;
+            if (i - bounds.back() >= kRangeLexemes) {
+                bounds.push_back(i);
+            }
+        } else if (l.type == Lexeme::LexemeType::kFunctionDefinitionEnd && in_definition) {
+            in_definition = false;
+            if (i + 1 - bounds.back() >= kRangeLexemes) {
+                bounds.push_back(i + 1);
             }
         }
-    } catch (std::exception &e) {
-        std::cout << "Syntax error:\n" << e.what();
-        exit(0);
+    }
+    if (bounds.back() != lexemes_->size() || bounds.size() == 1) {
+        bounds.push_back(lexemes_->size());
+    }
+    std::vector<std::unique_ptr<GrammaticalAnalyzer>> ranges;
+    for (size_t i = 0; i + 1 < bounds.size(); ++i) {
+        ranges.push_back(std::unique_ptr<GrammaticalAnalyzer>(new GrammaticalAnalyzer(*this, bounds[i], bounds[i + 1])));
+    }
+    WorkStealingPool::Shared().Run(ranges.size(), [&](size_t i) {
+        ranges[i]->ParseRange();
+    });
+    std::shared_ptr<Codeblock> code(new Codeblock);
+    for (const auto& range : ranges) {
+        Replay(*range);
+        if (range->error_) {
+            std::rethrow_exception(range->error_);
+        }
+        auto& statements = range->code_->statements;
+        code->statements.insert(code->statements.end(), statements.begin(), statements.end());
+    }
+    resulting_environment.code = code;
+    std::vector<const Lexeme*> undefined(ranges.size());
+    WorkStealingPool::Shared().Run(ranges.size(), [&](size_t i) {
+        undefined[i] = FindUndefined(bounds[i], bounds[i + 1]);
+    });
+    for (auto l : undefined) {
+        if (l != nullptr) {
+            ThrowUndefinedException(*l);
+        }
     }
 }
 
+std::shared_ptr<Executable> GrammaticalAnalyzer::AnalyzeMore(const std::vector<Lexeme>& lexemes,
+                                                             std::vector<std::string>& words) {
+    lexemes_ = &lexemes;
+    current_lexeme_index_ = 0;
+    end_ = lexemes.size();
+    new_identifiers_.clear();
+    defined_identifiers.insert({"I", "J", "K"});
+    ParseRange();
+    bool incomplete = false;
+    try {
+        Replay(*this);
+        if (error_) {
+            // the input stopped in the middle of a construct, which the next lexemes may complete
+            incomplete = IsFished();
+            std::rethrow_exception(error_);
+        }
+        if (auto l = FindUndefined(0, end_)) {
+            ThrowUndefinedException(*l);
+        }
+    } catch (std::exception&) {
+        for (const auto& name : new_identifiers_) {
+            defined_identifiers.erase(name);
+            resulting_environment.functions.erase(name);
+            sequential_words_.erase(name);
+            memory_words_.erase(name);
+        }
+        replay_sequential_ = false;
+        replay_memory_ = false;
+        if (incomplete) {
+            return nullptr;
+        }
+        throw;
+    }
+    for (const auto& name : new_identifiers_) {
+        if (resulting_environment.functions.contains(name)) {
+            words.push_back(name);
+        }
+    }
+    return code_;
+}
+
 GrammaticalAnalyzer::GrammaticalAnalyzer(const std::vector<Lexeme> &_lexemes,
                                          const std::vector<std::string> &_code_block_enders)
-    : lexemes_(_lexemes) {
+    : lexemes_(&_lexemes) {
     for (const auto &s: _code_block_enders) {
         code_block_enders_.insert(s);
     }
 }
 
+GrammaticalAnalyzer::GrammaticalAnalyzer(const std::vector<std::string> &_code_block_enders)
+    : code_block_enders_(_code_block_enders.begin(), _code_block_enders.end()) {
+}
+
 // private
 
-Lexeme GrammaticalAnalyzer::GetCurrentLexeme() {
-    if (current_lexeme_index_ >= lexemes_.size()) {
-        Lexeme lex;
-        lex.text = "END OF FILE";
-        lex.type = Lexeme::LexemeType::kError;
-        lex.row = lexemes_.back().row;
-        lex.column = lexemes_.back().column;
-        return lex;
+GrammaticalAnalyzer::GrammaticalAnalyzer(const GrammaticalAnalyzer& parent, size_t begin, size_t end)
+    : lexemes_(parent.lexemes_), current_lexeme_index_(begin), end_(end),
+      code_block_enders_(parent.code_block_enders_) {
+}
+
+void GrammaticalAnalyzer::ParseRange() {
+    checks_.clear();
+    code_ = nullptr;
+    error_ = nullptr;
+    loop_counter = 0;
+    function_counter = 0;
+    parallel_loop_level_ = 0;
+    try {
+        code_ = TopLevel();
+    } catch (std::exception&) {
+        error_ = std::current_exception();
+    }
+}
+
+void GrammaticalAnalyzer::Replay(const GrammaticalAnalyzer& range) {
+    for (const auto& check : range.checks_) {
+        const auto& l = *check.lexeme;
+        switch (check.kind) {
+            case Check::Kind::kDefinition:
+                if (defined_identifiers.contains(l.text)) {
+                    ThrowRedefinitionException(l);
+                }
+                defined_identifiers.emplace(l.text);
+                new_identifiers_.emplace_back(l.text);
+                break;
+            case Check::Kind::kWordEnd:
+                if (check.sequential || replay_sequential_) {
+                    sequential_words_.emplace(l.text);
+                }
+                if (check.memory || replay_memory_) {
+                    memory_words_.emplace(l.text);
+                }
+                resulting_environment.functions[std::string(l.text)] = check.body;
+                replay_sequential_ = false;
+                replay_memory_ = false;
+                break;
+            case Check::Kind::kCall:
+                // memory words are sequential words too
+                if (sequential_words_.contains(l.text)) {
+                    if (check.in_parallel_loop) {
+                        ThrowNotInParallelLoopException(l);
+                    }
+                    if (check.in_function) {
+                        replay_sequential_ = true;
+                        replay_memory_ = replay_memory_ || memory_words_.contains(l.text);
+                    }
+                }
+                break;
+            case Check::Kind::kSpawn:
+                if (!resulting_environment.functions.contains(std::string(l.text))) {
+                    ThrowSyntaxException(l, "word");
+                }
+                if (memory_words_.contains(l.text)) {
+                    ThrowGenericException(l, "Word ", " uses the data space and cannot be spawned");
+                }
+                break;
+        }
+    }
+}
+
+const Lexeme* GrammaticalAnalyzer::FindUndefined(size_t begin, size_t end) const {
+    for (size_t i = begin; i < end; ++i) {
+        const auto& l = (*lexemes_)[i];
+        if (l.type == Lexeme::LexemeType::kIdentifier && !defined_identifiers.contains(l.text)) {
+            return &l;
+        }
     }
-    return lexemes_[current_lexeme_index_];
+    return nullptr;
+}
+
+const Lexeme& GrammaticalAnalyzer::GetCurrentLexeme() {
+    if (current_lexeme_index_ >= lexemes_->size()) {
+        end_of_file_.text = "END OF FILE";
+        end_of_file_.type = Lexeme::LexemeType::kError;
+        end_of_file_.row = lexemes_->empty() ? 1 : lexemes_->back().row;
+        end_of_file_.column = lexemes_->empty() ? 0 : lexemes_->back().column;
+        return end_of_file_;
+    }
+    return (*lexemes_)[current_lexeme_index_];
 }
 
 void GrammaticalAnalyzer::NextLexeme() {
@@ -52,22 +219,25 @@ void GrammaticalAnalyzer::NextLexeme() {
 }
 
 bool GrammaticalAnalyzer::IsFished() {
-    return current_lexeme_index_ >= lexemes_.size();
+    return current_lexeme_index_ >= end_;
 }
 
 void GrammaticalAnalyzer::ThrowSyntaxException(const std::string &expected) {
-    auto l = GetCurrentLexeme();
+    ThrowSyntaxException(GetCurrentLexeme(), expected);
+}
+
+void GrammaticalAnalyzer::ThrowSyntaxException(const Lexeme& l, const std::string& expected) {
     std::string exception_text = std::to_string(l.row) + ":"
                                  + std::to_string(l.column) + ": " +
                                  "Expected: " + "'" + expected + "'"
-                                 + "\nGot: " + "'" + l.text + "'" + "\n";
+                                 + "\nGot: " + "'" + std::string(l.text) + "'" + "\n";
     throw std::runtime_error(exception_text);
 }
 
 void GrammaticalAnalyzer::ThrowGenericException(const Lexeme &l, const std::string &prefix_text, const std::string &suffix_text) {
     std::string exception_text = std::to_string(l.row) + ":" +
                                  std::to_string(l.column) + ": "
-                                 + prefix_text + "'" + l.text + "'" + suffix_text + "\n";
+                                 + prefix_text + "'" + std::string(l.text) + "'" + suffix_text + "\n";
     throw std::runtime_error(exception_text);
 }
 
@@ -87,11 +257,19 @@ void GrammaticalAnalyzer::ThrowNotInFunctionException(const Lexeme &l) {
     ThrowGenericException(l, "Operator ", " must be in function");
 }
 
+void GrammaticalAnalyzer::ThrowNotInParallelLoopException(const Lexeme &l) {
+    ThrowGenericException(l, "Operator ", " cannot be used in a PDO loop");
+}
+
+void GrammaticalAnalyzer::DefineIdentifier(const Lexeme& l) {
+    checks_.push_back({Check::Kind::kDefinition, &l});
+}
+
 void GrammaticalAnalyzer::ThrowRedefinitionException(const Lexeme &l) {
     ThrowGenericException(l, "Redefinition of identifier ", "");
 }
 
-void GrammaticalAnalyzer::Program() {
+std::shared_ptr<Codeblock> GrammaticalAnalyzer::TopLevel() {
     std::shared_ptr<Codeblock> result(new Codeblock);
     while (!IsFished()) {
         if (GetCurrentLexeme().text == ":") {
@@ -99,11 +277,16 @@ void GrammaticalAnalyzer::Program() {
             FunctionDefinition();
             function_counter--;
         } else {
+            auto start = current_lexeme_index_;
             auto block = CodeBlock();
+            if (current_lexeme_index_ == start) {
+                // a word ending a code block that was never opened
+                ThrowGenericException(GetCurrentLexeme(), "Unexpected ", "");
+            }
             result->statements.push_back(block);
         }
     }
-    resulting_environment.code = result;
+    return result;
 }
 
 std::shared_ptr<Executable> GrammaticalAnalyzer::FunctionDefinition() {
@@ -114,14 +297,13 @@ std::shared_ptr<Executable> GrammaticalAnalyzer::FunctionDefinition() {
     if (GetCurrentLexeme().type != Lexeme::LexemeType::kIdentifier) {
         ThrowSyntaxException("identifier");
     }
-    std::string function_name = GetCurrentLexeme().text;
-    if (defined_identifiers.contains(function_name)) {
-        ThrowRedefinitionException(GetCurrentLexeme());
-    }
-    defined_identifiers.insert(function_name);
+    const auto& function_name = GetCurrentLexeme();
+    DefineIdentifier(function_name);
     NextLexeme();
+    sequential_function_ = false;
+    memory_function_ = false;
     auto function_body = CodeBlock();
-    resulting_environment.functions[function_name] = function_body;
+    checks_.push_back({Check::Kind::kWordEnd, &function_name, function_body, sequential_function_, memory_function_});
     if (GetCurrentLexeme().text != ";") {
         ThrowSyntaxException(";");
     }
@@ -155,6 +337,21 @@ std::shared_ptr<Executable> GrammaticalAnalyzer::Statements() {
 }
 
 std::shared_ptr<Executable> GrammaticalAnalyzer::Statement() {
+    if (GetCurrentLexeme().type == Lexeme::LexemeType::kIdentifier) {
+        // whether the word does I/O is known once the words before it are replayed
+        Check call{Check::Kind::kCall, &GetCurrentLexeme()};
+        call.in_parallel_loop = parallel_loop_level_ > 0;
+        call.in_function = function_counter > 0;
+        checks_.push_back(call);
+    } else {
+        bool memory = kMemoryOperators.contains(GetCurrentLexeme().text);
+        if (memory || kSequentialOperators.contains(GetCurrentLexeme().text)) {
+            CheckSequential(GetCurrentLexeme(), memory);
+        }
+    }
+    if (GetCurrentLexeme().text == "SPAWN") {
+        return Spawn();
+    }
     if (GetCurrentLexeme().text == "VARIABLE") {
         return VariableDefinition();
     }
@@ -167,19 +364,26 @@ std::shared_ptr<Executable> GrammaticalAnalyzer::Statement() {
             if (loop_counter == 0) {
                 ThrowNotInLoopException(GetCurrentLexeme());
             }
+            // leaving a loop nested in the body is fine, leaving the PDO loop itself is not
+            if (loop_counter == parallel_loop_level_) {
+                ThrowNotInParallelLoopException(GetCurrentLexeme());
+            }
         }
         if (GetCurrentLexeme().text == "return") {
             if (function_counter == 0) {
                 ThrowNotInFunctionException(GetCurrentLexeme());
             }
+            if (parallel_loop_level_ > 0) {
+                ThrowNotInParallelLoopException(GetCurrentLexeme());
+            }
         }
-        std::shared_ptr<Operator> result(new Operator(GetCurrentLexeme().text));
+        std::shared_ptr<Operator> result(new Operator(std::string(GetCurrentLexeme().text)));
         NextLexeme();
         return result;
     }
     if (GetCurrentLexeme().type == Lexeme::LexemeType::kLiteral ||
         GetCurrentLexeme().type == Lexeme::LexemeType::kIdentifier) {
-        std::shared_ptr<Operator> result(new Operator(GetCurrentLexeme().text));
+        std::shared_ptr<Operator> result(new Operator(std::string(GetCurrentLexeme().text)));
         NextLexeme();
         return result;
     }
@@ -197,6 +401,11 @@ std::shared_ptr<Executable> GrammaticalAnalyzer::ControlFlowConstruct() {
         auto result = For();
         loop_counter--;
         return result;
+    } else if (GetCurrentLexeme().text == "PDO") {
+        loop_counter++;
+        auto result = ParallelFor();
+        loop_counter--;
+        return result;
     } else if (GetCurrentLexeme().text == "IF") {
         return If();
     } else if (GetCurrentLexeme().text == "CASE") {
@@ -239,6 +448,58 @@ std::shared_ptr<Executable> GrammaticalAnalyzer::For() {
     return loop;
 }
 
+std::shared_ptr<Executable> GrammaticalAnalyzer::ParallelFor() {
+    std::shared_ptr<class For> loop(new class For);
+    if (GetCurrentLexeme().text != "PDO") {
+        ThrowSyntaxException("PDO");
+    }
+    NextLexeme();
+    loop->parallel = true;
+    auto enclosing_level = std::exchange(parallel_loop_level_, loop_counter);
+    loop->body = CodeBlock();
+    parallel_loop_level_ = enclosing_level;
+    if (GetCurrentLexeme().text == "REDUCE") {
+        NextLexeme();
+        auto builtin = Operator::FindBuiltin(GetCurrentLexeme().text);
+        if (GetCurrentLexeme().type != Lexeme::LexemeType::kOperator || builtin == nullptr ||
+            builtin->effect.inputs != 2 || builtin->effect.outputs != 1) {
+            ThrowSyntaxException("binary operator");
+        }
+        loop->reduction = GetCurrentLexeme().text;
+        NextLexeme();
+    }
+    if (GetCurrentLexeme().text != "PLOOP") {
+        ThrowSyntaxException("PLOOP");
+    }
+    NextLexeme();
+    return loop;
+}
+
+void GrammaticalAnalyzer::CheckSequential(const Lexeme& l, bool memory) {
+    if (parallel_loop_level_ > 0) {
+        ThrowNotInParallelLoopException(l);
+    }
+    if (function_counter > 0) {
+        sequential_function_ = true;
+        memory_function_ = memory_function_ || memory;
+    }
+}
+
+std::shared_ptr<Executable> GrammaticalAnalyzer::Spawn() {
+    if (GetCurrentLexeme().text != "SPAWN") {
+        ThrowSyntaxException("SPAWN");
+    }
+    NextLexeme();
+    if (GetCurrentLexeme().type != Lexeme::LexemeType::kIdentifier) {
+        ThrowSyntaxException("word");
+    }
+    checks_.push_back({Check::Kind::kSpawn, &GetCurrentLexeme()});
+    std::shared_ptr<Operator> result(new Operator(std::string(GetCurrentLexeme().text)));
+    result->kind = Operator::Kind::kSpawn;
+    NextLexeme();
+    return result;
+}
+
 std::shared_ptr<Executable> GrammaticalAnalyzer::While() {
     std::shared_ptr<class While> loop(new class While);
     if (GetCurrentLexeme().text != "BEGIN") {
@@ -271,7 +532,7 @@ std::shared_ptr<Executable> GrammaticalAnalyzer::Switch() {
         if (!IsInteger(GetCurrentLexeme().text)) {
             ThrowNotIntegerException(GetCurrentLexeme());
         }
-        int64_t literal = std::stoll(GetCurrentLexeme().text);
+        int64_t literal = std::stoll(std::string(GetCurrentLexeme().text));
         NextLexeme();
         if (GetCurrentLexeme().text != "OF") {
             ThrowSyntaxException("OF");
@@ -288,6 +549,7 @@ std::shared_ptr<Executable> GrammaticalAnalyzer::Switch() {
         ThrowSyntaxException("ENDCASE");
     }
     NextLexeme();
+    switch_executable->BuildTable();
     return switch_executable;
 }
 
@@ -301,10 +563,7 @@ std::shared_ptr<Executable> GrammaticalAnalyzer::VariableDefinition() {
         ThrowSyntaxException("identifier");
     }
     result->name = GetCurrentLexeme().text;
-    if (defined_identifiers.find(GetCurrentLexeme().text) != defined_identifiers.end()) {
-        ThrowRedefinitionException(GetCurrentLexeme());
-    }
-    defined_identifiers.insert(GetCurrentLexeme().text);
+    DefineIdentifier(GetCurrentLexeme());
     NextLexeme();
     result->size = 1;
     result->type = "cells";
@@ -320,11 +579,8 @@ std::shared_ptr<Executable> GrammaticalAnalyzer::ArrayDefinition() {
     if (GetCurrentLexeme().type != Lexeme::LexemeType::kIdentifier) {
         ThrowSyntaxException("identifier");
     }
-    if (defined_identifiers.contains(GetCurrentLexeme().text)) {
-        ThrowRedefinitionException(GetCurrentLexeme());
-    }
     result->name = GetCurrentLexeme().text;
-    defined_identifiers.insert(GetCurrentLexeme().text);
+    DefineIdentifier(GetCurrentLexeme());
     NextLexeme();
     if (GetCurrentLexeme().type != Lexeme::LexemeType::kLiteral) {
         ThrowSyntaxException("literal");
@@ -332,7 +588,7 @@ std::shared_ptr<Executable> GrammaticalAnalyzer::ArrayDefinition() {
     if (!IsInteger(GetCurrentLexeme().text)) {
         ThrowNotIntegerException(GetCurrentLexeme());
     }
-    result->size = std::stoll(GetCurrentLexeme().text);
+    result->size = std::stoll(std::string(GetCurrentLexeme().text));
     NextLexeme();
     result->type = GetCurrentLexeme().text;
     SizeOperators();
@@ -11,37 +11,108 @@
 #include <vector>
 #include <set>
 #include <string>
+#include <functional>
 #include <memory>
+#include <cstddef>
+#include <exception>
+
+class Codeblock;
 
 /**
  * @class GrammaticalAnalyzer
  * @brief Performs syntactic analysis and generates the resulting environment.
+ *
+ * The lexemes are cut into ranges between top-level definitions, which are parsed on the
+ * WorkStealingPool. What a range cannot know about the words of the others, such as whether an
+ * identifier is already defined or a word does I/O, is recorded as checks and replayed in the
+ * order of the source, so errors are reported as if the lexemes were analyzed in one pass.
  */
 class GrammaticalAnalyzer {
 public:
     /**
      * @brief Constructs a GrammaticalAnalyzer.
-     * @param lexemes A vector of lexemes to analyze.
+     * @param lexemes A vector of lexemes to analyze, which must outlive the analysis.
      * @param code_block_enders A set of keywords that signify the end of a code block.
      */
     GrammaticalAnalyzer(const std::vector<Lexeme>& lexemes, const std::vector<std::string>& code_block_enders);
 
+    /**
+     * @brief Constructs a GrammaticalAnalyzer without lexemes, which are then given to AnalyzeMore.
+     * @param code_block_enders A set of keywords that signify the end of a code block.
+     */
+    explicit GrammaticalAnalyzer(const std::vector<std::string>& code_block_enders);
+
     /**
      * @brief Performs grammatical analysis on the provided lexemes.
+     * @throws std::runtime_error On syntax errors and undefined identifiers.
      */
     void Analyze();
 
+    /**
+     * @brief Analyzes more lexemes on top of everything analyzed so far, as typed into the REPL.
+     *
+     * Words and variables they define are added to resulting_environment. On an error the
+     * definitions of these lexemes are dropped again and the error is thrown instead of ending the program.
+     *
+     * @param lexemes The lexemes to analyze, which must outlive the call.
+     * @param words Receives the names of the words these lexemes define.
+     * @return Their main code, or nullptr if the lexemes end inside a definition or control structure.
+     */
+    std::shared_ptr<Executable> AnalyzeMore(const std::vector<Lexeme>& lexemes, std::vector<std::string>& words);
+
     /**
      * @brief The resulting environment after analysis.
      */
     Environment resulting_environment;
 
 private:
+    /**
+     * @struct Check
+     * @brief A check that depends on the words defined so far, replayed once the range is parsed.
+     */
+    struct Check {
+        enum class Kind {
+            kDefinition, ///< A word or variable is defined, which must not be defined yet.
+            kWordEnd,    ///< The body of the word defined last is parsed.
+            kCall,       ///< An identifier is used as a statement.
+            kSpawn       ///< A word is spawned, which must be defined before.
+        };
+        Kind kind;
+        const Lexeme* lexeme; ///< The identifier, or for kWordEnd the name of the word.
+        std::shared_ptr<Executable> body = nullptr; ///< For kWordEnd, the body of the word.
+        bool sequential = false; ///< For kWordEnd, whether the word itself does I/O or defines memory.
+        bool memory = false; ///< For kWordEnd, whether the word itself defines memory or reads the data space.
+        bool in_parallel_loop = false; ///< For kCall, whether it is inside a PDO loop.
+        bool in_function = false; ///< For kCall, whether it is inside a word definition.
+    };
+
+    /**
+     * @brief Constructs an analyzer of the lexemes of a parent from begin up to end.
+     */
+    GrammaticalAnalyzer(const GrammaticalAnalyzer& parent, size_t begin, size_t end);
+
+    /**
+     * @brief Parses the lexemes up to end_, keeping the main code in code_ and the first error in error_.
+     */
+    void ParseRange();
+
+    /**
+     * @brief Replays the checks of a parsed range on the words defined so far and adds its words.
+     * @param range The range, which may be this analyzer.
+     */
+    void Replay(const GrammaticalAnalyzer& range);
+
+    /**
+     * @brief Finds the first identifier from begin up to end that is not defined.
+     * @return The identifier, or nullptr if all are defined.
+     */
+    const Lexeme* FindUndefined(size_t begin, size_t end) const;
+
     /**
      * @brief Retrieves the current lexeme being analyzed.
      * @return The current lexeme.
      */
-    Lexeme GetCurrentLexeme();
+    const Lexeme& GetCurrentLexeme();
 
     /**
      * @brief Advances to the next lexeme in the analysis.
@@ -54,6 +125,13 @@ private:
      */
     void ThrowSyntaxException(const std::string& message);
 
+    /**
+     * @brief Throws a syntax error exception for a given lexeme.
+     * @param l The lexeme where the error occurred.
+     * @param expected What was expected instead.
+     */
+    void ThrowSyntaxException(const Lexeme& l, const std::string& expected);
+
     /**
      * @brief Throws a generic exception for a given lexeme.
      * @param l The lexeme where the error occurred.
@@ -86,6 +164,18 @@ private:
      */
     void ThrowNotInFunctionException(const Lexeme& l);
 
+    /**
+     * @brief Throws an exception for an operation a PDO loop cannot run in parallel.
+     * @param l The lexeme causing the error.
+     */
+    void ThrowNotInParallelLoopException(const Lexeme& l);
+
+    /**
+     * @brief Records the identifier of a new word or variable, whose redefinition is rejected by Replay.
+     * @param l The lexeme of the identifier.
+     */
+    void DefineIdentifier(const Lexeme& l);
+
     /**
      * @brief Throws an exception for redefinition of an identifier.
      * @param l The lexeme representing the redefined identifier.
@@ -99,9 +189,10 @@ private:
     bool IsFished();
 
     /**
-     * @brief Parses the program grammar.
+     * @brief Parses word definitions and main code up to the end of the lexemes.
+     * @return The main code, without the word definitions.
      */
-    void Program();
+    std::shared_ptr<Codeblock> TopLevel();
 
     /**
      * @brief Parses a function definition.
@@ -133,6 +224,25 @@ private:
      */
     std::shared_ptr<Executable> For();
 
+    /**
+     * @brief Parses a parallel for loop (PDO ... PLOOP), optionally with REDUCE and a binary operator before PLOOP.
+     * @return A shared pointer to the parsed Executable.
+     */
+    std::shared_ptr<Executable> ParallelFor();
+
+    /**
+     * @brief Records an operator that does I/O or defines memory, rejecting it inside a PDO loop.
+     * @param l The lexeme of the operator.
+     * @param memory Whether it defines memory or reads the data space, which tasks do not share either.
+     */
+    void CheckSequential(const Lexeme& l, bool memory);
+
+    /**
+     * @brief Parses SPAWN followed by the word the new task runs.
+     * @return A shared pointer to the parsed Executable.
+     */
+    std::shared_ptr<Executable> Spawn();
+
     /**
      * @brief Parses an if-else construct.
      * @return A shared pointer to the parsed Executable.
@@ -174,12 +284,25 @@ private:
      */
     void SizeOperators();
 
-    std::vector<Lexeme> lexemes_; ///< The list of lexemes to analyze.
-    int current_lexeme_index_ = 0; ///< The current index in the lexemes vector.
-    std::set<std::string> code_block_enders_; ///< The set of keywords that signify the end of a code block.
-    std::set<std::string> defined_identifiers; ///< The set of currently defined identifiers.
+    const std::vector<Lexeme>* lexemes_ = nullptr; ///< The list of lexemes to analyze.
+    Lexeme end_of_file_; ///< Returned as the current lexeme once all lexemes are consumed.
+    size_t current_lexeme_index_ = 0; ///< The current index in the lexemes vector.
+    size_t end_ = 0; ///< The index after the last lexeme of the range being parsed.
+    std::set<std::string, std::less<>> code_block_enders_; ///< The set of keywords that signify the end of a code block.
+    std::set<std::string, std::less<>> defined_identifiers; ///< The set of currently defined identifiers.
     int loop_counter = 0; ///< Tracks the current nesting level of loops.
     int function_counter = 0; ///< Tracks the current nesting level of functions.
+    int parallel_loop_level_ = 0; ///< The loop_counter of the innermost PDO loop body, 0 outside of PDO loops.
+    bool sequential_function_ = false; ///< Whether the word being defined must not run inside a PDO loop.
+    std::set<std::string, std::less<>> sequential_words_; ///< Words doing I/O or defining memory, directly or through calls.
+    bool memory_function_ = false; ///< Whether the word being defined must not run as a task.
+    std::set<std::string, std::less<>> memory_words_; ///< Words defining memory or reading the data space, directly or through calls.
+    std::vector<std::string> new_identifiers_; ///< Identifiers defined by the lexemes of the current AnalyzeMore.
+    std::vector<Check> checks_; ///< The checks of the range being parsed, in the order of the source.
+    std::shared_ptr<Codeblock> code_; ///< The main code of the range, nullptr if parsing it failed.
+    std::exception_ptr error_; ///< What parsing the range threw, after its checks.
+    bool replay_sequential_ = false; ///< Whether the word being replayed calls a word doing I/O or defining memory.
+    bool replay_memory_ = false; ///< Whether the word being replayed calls a word defining memory or reading the data space.
 };
 
 #endif // GRAMMATICALANALYZER_H
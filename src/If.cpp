@@ -11,3 +11,6 @@ Executable::ReturnStatus If::Execute(Environment& environment) {
     return ReturnStatus::kSuccess;
 }
 
+void If::Accept(ExecutableVisitor& visitor) {
+    visitor.Visit(*this);
+}
@@ -0,0 +1,200 @@
+#include "Inliner.h"
+
+Inliner::Inliner(int threshold) : threshold_(threshold) {
+}
+
+void Inliner::Inline(Environment& environment) {
+    if (threshold_ <= 0) {
+        return;
+    }
+    environment_ = &environment;
+    for (const auto& [name, body] : environment.functions) {
+        if (!done_.contains(name)) {
+            InlineWord(name);
+        }
+    }
+    environment.code->Accept(*this);
+}
+
+void Inliner::Report(std::ostream& out) const {
+    int total = 0;
+    for (const auto& [name, count] : inlined_) {
+        out << name << ": " << count << "\n";
+        total += count;
+    }
+    out << "inlined calls: " << total << "\n";
+}
+
+void Inliner::Visit(VariableCreation&) {
+}
+
+void Inliner::Visit(Codeblock& node) {
+    for (auto& statement : node.statements) {
+        auto call = std::dynamic_pointer_cast<Operator>(statement);
+        if (!call || call->kind != Operator::Kind::kFunctionCall) {
+            statement->Accept(*this);
+            continue;
+        }
+        const auto& name = call->text;
+        if (!done_.contains(name) && !in_progress_.contains(name)) {
+            InlineWord(name);
+        }
+        if (in_progress_.contains(name) || !IsInlinable(name)) {
+            continue;
+        }
+        auto body = std::static_pointer_cast<Codeblock>(Clone(environment_->functions[name]));
+        if (!body->statements.empty()) {
+            auto last = std::dynamic_pointer_cast<Operator>(body->statements.back());
+            if (last && last->text == "return") {
+                body->statements.pop_back();
+            }
+        }
+        ++inlined_[name];
+        statement = body;
+    }
+}
+
+void Inliner::Visit(class While& node) {
+    node.condition->Accept(*this);
+    node.body->Accept(*this);
+}
+
+void Inliner::Visit(class For& node) {
+    node.body->Accept(*this);
+}
+
+void Inliner::Visit(class If& node) {
+    node.if_part->Accept(*this);
+    if (node.else_part) {
+        node.else_part->Accept(*this);
+    }
+}
+
+void Inliner::Visit(class Switch& node) {
+    for (const auto& [selector, code] : node.cases) {
+        code->Accept(*this);
+    }
+}
+
+void Inliner::Visit(Operator&) {
+}
+
+void Inliner::InlineWord(const std::string& name) {
+    in_progress_.insert(name);
+    environment_->functions[name]->Accept(*this);
+    in_progress_.erase(name);
+    done_.insert(name);
+}
+
+bool Inliner::IsInlinable(const std::string& name) {
+    const auto& body = *environment_->functions[name];
+    return Size(body) <= threshold_ && HasLocalControl(body, 0, true);
+}
+
+int Inliner::Size(const Executable& node) {
+    if (auto block = dynamic_cast<const Codeblock*>(&node)) {
+        int size = 0;
+        for (const auto& statement : block->statements) {
+            size += Size(*statement);
+        }
+        return size;
+    }
+    if (auto loop = dynamic_cast<const class While*>(&node)) {
+        return 1 + Size(*loop->condition) + Size(*loop->body);
+    }
+    if (auto loop = dynamic_cast<const class For*>(&node)) {
+        return 1 + Size(*loop->body);
+    }
+    if (auto branch = dynamic_cast<const class If*>(&node)) {
+        return 1 + Size(*branch->if_part) + (branch->else_part ? Size(*branch->else_part) : 0);
+    }
+    if (auto switch_statement = dynamic_cast<const class Switch*>(&node)) {
+        int size = 1;
+        for (const auto& [selector, code] : switch_statement->cases) {
+            size += Size(*code);
+        }
+        return size;
+    }
+    return 1;
+}
+
+bool Inliner::HasLocalControl(const Executable& node, int loops, bool tail) {
+    if (auto block = dynamic_cast<const Codeblock*>(&node)) {
+        for (size_t i = 0; i < block->statements.size(); ++i) {
+            if (!HasLocalControl(*block->statements[i], loops, tail && i + 1 == block->statements.size())) {
+                return false;
+            }
+        }
+        return true;
+    }
+    if (auto loop = dynamic_cast<const class While*>(&node)) {
+        return HasLocalControl(*loop->condition, loops + 1, false) && HasLocalControl(*loop->body, loops + 1, false);
+    }
+    if (auto loop = dynamic_cast<const class For*>(&node)) {
+        return HasLocalControl(*loop->body, loops + 1, false);
+    }
+    if (auto branch = dynamic_cast<const class If*>(&node)) {
+        return HasLocalControl(*branch->if_part, loops, false) &&
+               (!branch->else_part || HasLocalControl(*branch->else_part, loops, false));
+    }
+    if (auto switch_statement = dynamic_cast<const class Switch*>(&node)) {
+        for (const auto& [selector, code] : switch_statement->cases) {
+            if (!HasLocalControl(*code, loops, false)) {
+                return false;
+            }
+        }
+        return true;
+    }
+    if (auto op = dynamic_cast<const Operator*>(&node)) {
+        if (op->text == "return") {
+            return tail;
+        }
+        if (op->text == "leave" || op->text == "continue") {
+            return loops > 0;
+        }
+    }
+    return true;
+}
+
+std::shared_ptr<Executable> Inliner::Clone(const std::shared_ptr<Executable>& node) {
+    if (auto block = std::dynamic_pointer_cast<Codeblock>(node)) {
+        std::shared_ptr<Codeblock> result(new Codeblock);
+        for (const auto& statement : block->statements) {
+            result->statements.push_back(Clone(statement));
+        }
+        return result;
+    }
+    if (auto loop = std::dynamic_pointer_cast<class While>(node)) {
+        std::shared_ptr<class While> result(new class While);
+        result->condition = Clone(loop->condition);
+        result->body = Clone(loop->body);
+        return result;
+    }
+    if (auto loop = std::dynamic_pointer_cast<class For>(node)) {
+        std::shared_ptr<class For> result(new class For);
+        result->body = Clone(loop->body);
+        result->parallel = loop->parallel;
+        result->reduction = loop->reduction;
+        return result;
+    }
+    if (auto branch = std::dynamic_pointer_cast<class If>(node)) {
+        std::shared_ptr<class If> result(new class If);
+        result->if_part = Clone(branch->if_part);
+        if (branch->else_part) {
+            result->else_part = Clone(branch->else_part);
+        }
+        return result;
+    }
+    if (auto switch_statement = std::dynamic_pointer_cast<class Switch>(node)) {
+        std::shared_ptr<class Switch> result(new class Switch);
+        for (const auto& [selector, code] : switch_statement->cases) {
+            result->cases[selector] = Clone(code);
+        }
+        result->BuildTable();
+        return result;
+    }
+    if (auto creation = std::dynamic_pointer_cast<VariableCreation>(node)) {
+        return std::shared_ptr<VariableCreation>(new VariableCreation(*creation));
+    }
+    return std::shared_ptr<Operator>(new Operator(*std::static_pointer_cast<Operator>(node)));
+}
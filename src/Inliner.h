@@ -0,0 +1,97 @@
+/**
+ * @file Inliner.h
+ * @brief Defines the Inliner pass splicing the bodies of small words into their callers.
+ */
+
+#ifndef INLINER_H
+#define INLINER_H
+
+#include <map>
+#include <memory>
+#include <ostream>
+#include <set>
+#include <string>
+#include "Executable.h"
+#include "Environment.h"
+
+/**
+ * @class Inliner
+ * @brief Replaces calls of small non-recursive words by a copy of their body.
+ *
+ * A word is inlined if its body has at most threshold nodes, its only `return` is the last statement
+ * of the body and it does not use `leave` or `continue` outside of its own loops. Words are processed
+ * callees first, so inlined bodies already have their own calls inlined. Calls closing a recursion
+ * cycle are kept. Must run after the Linker.
+ */
+class Inliner final : public ExecutableVisitor {
+public:
+    /**
+     * @brief Default maximal number of nodes in the body of an inlined word.
+     */
+    static constexpr int kDefaultThreshold = 8;
+
+    /**
+     * @brief Constructs an Inliner.
+     * @param threshold The maximal number of nodes in the body of an inlined word, 0 disables inlining.
+     */
+    explicit Inliner(int threshold = kDefaultThreshold);
+
+    /**
+     * @brief Inlines calls in the main code and in all words of the environment.
+     * @param environment The linked environment.
+     */
+    void Inline(Environment& environment);
+
+    /**
+     * @brief Prints the inlined words and the number of call sites replaced.
+     * @param out The stream to print to.
+     */
+    void Report(std::ostream& out) const;
+
+    void Visit(VariableCreation& node) override;
+    void Visit(Codeblock& node) override;
+    void Visit(class While& node) override;
+    void Visit(class For& node) override;
+    void Visit(class If& node) override;
+    void Visit(class Switch& node) override;
+    void Visit(Operator& node) override;
+
+private:
+    /**
+     * @brief Inlines calls in the body of a word after doing so for the words it calls.
+     * @param name The name of the word.
+     */
+    void InlineWord(const std::string& name);
+
+    /**
+     * @brief Checks whether calls of a word may be replaced by its body.
+     * @param name The name of the word.
+     */
+    bool IsInlinable(const std::string& name);
+
+    /**
+     * @brief Returns the number of nodes of a subtree, not counting code blocks.
+     */
+    static int Size(const Executable& node);
+
+    /**
+     * @brief Checks that `return`, `leave` and `continue` keep their meaning when the code is spliced into a caller.
+     * @param node The subtree to check.
+     * @param loops The number of enclosing loops inside the word.
+     * @param tail Whether the node is the last statement of the word body.
+     */
+    static bool HasLocalControl(const Executable& node, int loops, bool tail);
+
+    /**
+     * @brief Deep copies a subtree so that later passes can rebind its operators independently.
+     */
+    static std::shared_ptr<Executable> Clone(const std::shared_ptr<Executable>& node);
+
+    Environment* environment_ = nullptr; ///< The environment being optimized.
+    int threshold_; ///< The maximal number of nodes in the body of an inlined word.
+    std::set<std::string> done_;        ///< Words whose bodies are processed.
+    std::set<std::string> in_progress_; ///< Words being processed, calls of them close a recursion cycle.
+    std::map<std::string, int> inlined_; ///< Number of call sites replaced per word.
+};
+
+#endif //INLINER_H
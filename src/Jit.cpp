@@ -0,0 +1,1001 @@
+#include "Jit.h"
+#include "Builtins.h"
+#include "Peephole.h"
+#include "VirtualMachine.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+#if FORTH_JIT
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+constexpr int kJitBranch = 2; ///< Returned by helpers when the instruction branches.
+
+} // namespace
+
+#if FORTH_JIT
+namespace {
+
+/**
+ * @brief General purpose x86-64 registers in encoding order.
+ */
+enum Register : uint8_t {
+    kRax, kRcx, kRdx, kRbx, kRsp, kRbp, kRsi, kRdi,
+    kR8, kR9, kR10, kR11, kR12, kR13, kR14, kR15,
+    kNoRegister = 0xFF
+};
+
+/**
+ * @brief Condition codes of jcc and setcc.
+ */
+enum Condition : uint8_t {
+    kBelow = 0x2,
+    kAboveEqual = 0x3,
+    kEqual = 0x4,
+    kNotEqual = 0x5,
+    kLess = 0xC,
+    kGreaterEqual = 0xD,
+    kLessEqual = 0xE,
+    kGreater = 0xF
+};
+
+/**
+ * @brief A memory operand [base + index * 2^scale + displacement].
+ */
+struct Memory {
+    Register base;
+    int32_t displacement = 0;
+    Register index = kNoRegister;
+    uint8_t scale = 0;
+};
+
+/**
+ * @brief Emits the handful of x86-64 instructions the JitCompiler needs.
+ */
+class Assembler {
+public:
+    size_t Here() const {
+        return code_.size();
+    }
+
+    const std::vector<uint8_t>& code() const {
+        return code_;
+    }
+
+    void Push(Register r) {
+        if (r >= kR8) {
+            Byte(0x41);
+        }
+        Byte(0x50 + (r & 7));
+    }
+
+    void Pop(Register r) {
+        if (r >= kR8) {
+            Byte(0x41);
+        }
+        Byte(0x58 + (r & 7));
+    }
+
+    void Mov(Register destination, Register source) {
+        RegisterOp(true, {0x89}, source, destination);
+    }
+
+    void Mov(Register destination, Memory source) {
+        MemoryOp(true, {0x8B}, destination, source);
+    }
+
+    void Mov(Memory destination, Register source) {
+        MemoryOp(true, {0x89}, source, destination);
+    }
+
+    void MovImmediate(Register destination, int64_t value) {
+        Byte(0x48 | (destination >> 3));
+        Byte(0xB8 + (destination & 7));
+        Int64(value);
+    }
+
+    /**
+     * @brief Loads a 32-bit value, clearing the upper half of the register.
+     */
+    void MovImmediate32(Register destination, int32_t value) {
+        if (destination >= kR8) {
+            Byte(0x41);
+        }
+        Byte(0xB8 + (destination & 7));
+        Int32(value);
+    }
+
+    void MovzxByte(Register destination, Memory source) {
+        MemoryOp(false, {0x0F, 0xB6}, destination, source);
+    }
+
+    void MovByte(Memory destination, Register source) {
+        MemoryOp(false, {0x88}, source, destination);
+    }
+
+    /**
+     * @brief Emits `op destination, source` for add (0x01), or (0x09), and (0x21), sub (0x29) or xor (0x31).
+     */
+    void Arithmetic(uint8_t opcode, Register destination, Register source) {
+        RegisterOp(true, {opcode}, source, destination);
+    }
+
+    void Imul(Register destination, Memory source) {
+        MemoryOp(true, {0x0F, 0xAF}, destination, source);
+    }
+
+    void Add(Register destination, Register source) {
+        RegisterOp(true, {0x01}, source, destination);
+    }
+
+    void Sub(Register destination, Register source) {
+        RegisterOp(true, {0x29}, source, destination);
+    }
+
+    void Add(Register destination, int32_t value) {
+        RegisterOp(true, {0x81}, 0, destination);
+        Int32(value);
+    }
+
+    void Sub(Register destination, int32_t value) {
+        RegisterOp(true, {0x81}, 5, destination);
+        Int32(value);
+    }
+
+    void Inc(Register r) {
+        RegisterOp(true, {0xFF}, 0, r);
+    }
+
+    void Dec(Register r) {
+        RegisterOp(true, {0xFF}, 1, r);
+    }
+
+    void Cmp(Register left, Register right) {
+        RegisterOp(true, {0x39}, right, left);
+    }
+
+    void Cmp(Register left, Memory right) {
+        MemoryOp(true, {0x3B}, left, right);
+    }
+
+    void Cmp(Register left, int32_t right) {
+        RegisterOp(true, {0x81}, 7, left);
+        Int32(right);
+    }
+
+    void Cmp32(Register left, int32_t right) {
+        RegisterOp(false, {0x81}, 7, left);
+        Int32(right);
+    }
+
+    void CmpByte(Memory left, uint8_t right) {
+        MemoryOp(false, {0x80}, 7, left);
+        Byte(right);
+    }
+
+    void Test(Register left, Register right) {
+        RegisterOp(true, {0x85}, right, left);
+    }
+
+    void Test32(Register left, Register right) {
+        RegisterOp(false, {0x85}, right, left);
+    }
+
+    /**
+     * @brief Sets rax to 1 if the condition holds and to 0 otherwise.
+     */
+    void SetRax(Condition condition) {
+        Byte(0x0F);
+        Byte(0x90 + condition);
+        Byte(0xC0);
+        Byte(0x0F);
+        Byte(0xB6);
+        Byte(0xC0);
+    }
+
+    /**
+     * @brief Truncates the double whose bits are in rax to an integer in rax.
+     */
+    void TruncateRax() {
+        for (uint8_t byte : {0x66, 0x48, 0x0F, 0x6E, 0xC0, 0xF2, 0x48, 0x0F, 0x2C, 0xC0}) {
+            Byte(byte);
+        }
+    }
+
+    void MovEax(int32_t value) {
+        Byte(0xB8);
+        Int32(value);
+    }
+
+    void XorEax() {
+        Byte(0x31);
+        Byte(0xC0);
+    }
+
+    void CallRax() {
+        Byte(0xFF);
+        Byte(0xD0);
+    }
+
+    void Ret() {
+        Byte(0xC3);
+    }
+
+    /**
+     * @brief Jumps to entry index of the table of count 32-bit offsets emitted right after the jump.
+     *
+     * The index must be below count; it and rcx are overwritten.
+     * @return The position of the table, to be passed to BindEntry.
+     */
+    size_t JumpTable(Register index, size_t count) {
+        Byte(0x48);
+        Byte(0x8D);
+        Byte(0x0D); // lea rcx, [rip + table]
+        Int32(0);
+        size_t displacement = Here() - 4;
+        MemoryOp(true, {0x63}, index, Memory{kRcx, 0, index, 2});
+        Add(index, kRcx);
+        RegisterOp(false, {0xFF}, 4, index);
+        Bind(displacement);
+        size_t table = Here();
+        for (size_t i = 0; i < count; ++i) {
+            Int32(0);
+        }
+        return table;
+    }
+
+    /**
+     * @brief Points the given entry of the table at the given position to the target.
+     */
+    void BindEntry(size_t table, size_t entry, size_t target) {
+        auto offset = static_cast<int32_t>(static_cast<int64_t>(target) - static_cast<int64_t>(table));
+        std::memcpy(&code_[table + 4 * entry], &offset, sizeof(offset));
+    }
+
+    /**
+     * @brief Emits a conditional jump with an unresolved target.
+     * @return The position of the displacement, to be passed to Bind.
+     */
+    size_t Jump(Condition condition) {
+        Byte(0x0F);
+        Byte(0x80 + condition);
+        Int32(0);
+        return Here() - 4;
+    }
+
+    /**
+     * @brief Emits an unconditional jump with an unresolved target.
+     * @return The position of the displacement, to be passed to Bind.
+     */
+    size_t Jump() {
+        Byte(0xE9);
+        Int32(0);
+        return Here() - 4;
+    }
+
+    /**
+     * @brief Points the jump whose displacement is at the given position to the target.
+     */
+    void Bind(size_t displacement, size_t target) {
+        auto offset = static_cast<int32_t>(static_cast<int64_t>(target) - static_cast<int64_t>(displacement + 4));
+        std::memcpy(&code_[displacement], &offset, sizeof(offset));
+    }
+
+    /**
+     * @brief Points the jump whose displacement is at the given position to the current position.
+     */
+    void Bind(size_t displacement) {
+        Bind(displacement, Here());
+    }
+
+private:
+    void Byte(uint8_t value) {
+        code_.push_back(value);
+    }
+
+    void Int32(int32_t value) {
+        for (int i = 0; i < 4; ++i) {
+            Byte(static_cast<uint8_t>(value >> (8 * i)));
+        }
+    }
+
+    void Int64(int64_t value) {
+        for (int i = 0; i < 8; ++i) {
+            Byte(static_cast<uint8_t>(value >> (8 * i)));
+        }
+    }
+
+    void RegisterOp(bool wide, std::initializer_list<uint8_t> opcode, int reg, int rm) {
+        uint8_t rex = 0x40 | (wide << 3) | ((reg >> 3) << 2) | (rm >> 3);
+        if (rex != 0x40) {
+            Byte(rex);
+        }
+        for (auto byte : opcode) {
+            Byte(byte);
+        }
+        Byte(0xC0 | ((reg & 7) << 3) | (rm & 7));
+    }
+
+    void MemoryOp(bool wide, std::initializer_list<uint8_t> opcode, int reg, Memory memory) {
+        bool has_index = memory.index != kNoRegister;
+        uint8_t rex = 0x40 | (wide << 3) | ((reg >> 3) << 2) | ((has_index ? memory.index >> 3 : 0) << 1) |
+                      (memory.base >> 3);
+        if (rex != 0x40) {
+            Byte(rex);
+        }
+        for (auto byte : opcode) {
+            Byte(byte);
+        }
+        bool sib = has_index || (memory.base & 7) == kRsp;
+        int mod;
+        if (memory.displacement == 0 && (memory.base & 7) != kRbp) {
+            mod = 0;
+        } else if (memory.displacement >= -128 && memory.displacement <= 127) {
+            mod = 1;
+        } else {
+            mod = 2;
+        }
+        Byte((mod << 6) | ((reg & 7) << 3) | (sib ? 4 : memory.base & 7));
+        if (sib) {
+            Byte((memory.scale << 6) | ((has_index ? memory.index & 7 : 4) << 3) | (memory.base & 7));
+        }
+        if (mod == 1) {
+            Byte(static_cast<uint8_t>(memory.displacement));
+        } else if (mod == 2) {
+            Int32(memory.displacement);
+        }
+    }
+
+    std::vector<uint8_t> code_;
+};
+
+/**
+ * @brief One instruction of a word after superinstructions are expanded, with branch targets made absolute.
+ */
+struct JitInstruction {
+    Opcode opcode;
+    int32_t operand = 0;               ///< The original operand for table lookups.
+    size_t target = 0;                 ///< Absolute target address for branches.
+    Operator::Builtin builtin = nullptr;
+    std::string name;                  ///< The name of the builtin for kBuiltin.
+    size_t address;                    ///< The address of the instruction it was expanded from.
+};
+
+// Registers holding the stack state while a compiled word runs; all are callee saved. The top of
+// stack is held in kTop and kTopTag instead of at Cell(0) while the compiler knows it is cached.
+constexpr Register kTopTag = kRbx;
+constexpr Register kTop = kRbp;
+constexpr Register kStack = kR12;
+constexpr Register kCells = kR13;
+constexpr Register kTags = kR14;
+constexpr Register kSize = kR15;
+
+// The JitContext is kept in the slot at the bottom of the frame.
+constexpr Memory kContext{kRsp};
+
+Memory Cell(int offset) {
+    return {kCells, offset * 8, kSize, 3};
+}
+
+Memory Tag(int offset) {
+    return {kTags, offset, kSize, 0};
+}
+
+Memory StackField(size_t offset) {
+    return {kStack, static_cast<int32_t>(offset)};
+}
+
+} // namespace
+#endif
+
+/**
+ * @brief Functions called back from compiled words, converting exceptions into kJitError.
+ */
+struct JitCompiler::Runtime {
+    template<typename F>
+    static int Guard(JitContext* context, F body) {
+        try {
+            return body();
+        } catch (...) {
+            context->error = std::current_exception();
+            return kJitError;
+        }
+    }
+
+    static int Builtin(JitContext* context, int64_t builtin) {
+        return Guard(context, [&] {
+            reinterpret_cast<Operator::Builtin>(builtin)(*context->environment);
+            return kJitSuccess;
+        });
+    }
+
+    static int Underflow(JitContext* context, int64_t inputs) {
+        return Guard(context, [&] {
+            context->environment->RequireStack(inputs, inputs);
+            return kJitSuccess;
+        });
+    }
+
+    static int Grow(JitContext* context, int64_t) {
+        return Guard(context, [&] {
+            auto& stack = context->environment->stack;
+            stack.reserve(stack.size() * 2 + 16);
+            return kJitSuccess;
+        });
+    }
+
+    static int Require(JitContext* context, int64_t effect) {
+        return Guard(context, [&] {
+            auto required = reinterpret_cast<const StackEffect*>(effect);
+            context->environment->RequireStack(required->inputs, required->peak);
+            return kJitSuccess;
+        });
+    }
+
+    static int PushString(JitContext* context, int64_t string) {
+        return Guard(context, [&] {
+            auto text = reinterpret_cast<const std::string*>(string);
+            context->environment->PushOnStack(StackElement(reinterpret_cast<int64_t>(text->c_str() + 2)));
+            context->environment->PushOnStack(StackElement(static_cast<int64_t>(text->size() - 3)));
+            return kJitSuccess;
+        });
+    }
+
+    static int PushVariable(JitContext* context, int64_t slot) {
+        return Guard(context, [&] {
+            auto address = context->environment->slots[slot];
+            if (address == nullptr) {
+                throw std::runtime_error("unknown operator passed");
+            }
+            context->environment->PushOnStack(StackElement(reinterpret_cast<int64_t>(address)));
+            return kJitSuccess;
+        });
+    }
+
+    static int LoopIndex(JitContext* context, int64_t depth) {
+        return Guard(context, [&] {
+            context->environment->PushOnStack(context->environment->LoopIndex(depth));
+            return kJitSuccess;
+        });
+    }
+
+    static int Execute(JitContext* context, int64_t node) {
+        return Guard(context, [&] {
+            reinterpret_cast<Executable*>(node)->Execute(*context->environment);
+            return kJitSuccess;
+        });
+    }
+
+    static int Call(JitContext* context, int64_t entry) {
+        return Guard(context, [&] {
+            context->machine->CallWord(*context->environment, entry);
+            return kJitSuccess;
+        });
+    }
+
+    static int DoEnter(JitContext* context, int64_t) {
+        return Guard(context, [&] {
+            return context->machine->EnterLoop(*context->environment) ? kJitSuccess : kJitBranch;
+        });
+    }
+
+    static int DoLoop(JitContext* context, int64_t) {
+        return context->machine->NextIteration(*context->environment) ? kJitBranch : kJitSuccess;
+    }
+
+    static int DoExit(JitContext* context, int64_t) {
+        context->machine->LeaveLoop(*context->environment);
+        return kJitSuccess;
+    }
+
+    // The index of the case matching the selector in the targets of the table, or their count if none does.
+    static int64_t Case(const CaseTable<int32_t>* table, int64_t selector) {
+        auto target = table->Find(selector);
+        return target != nullptr ? target - table->targets().data() : static_cast<int64_t>(table->targets().size());
+    }
+};
+
+JitCompiler::~JitCompiler() {
+#if FORTH_JIT
+    for (auto [memory, size] : regions_) {
+        munmap(memory, size);
+    }
+#endif
+}
+
+void JitCompiler::Report(std::ostream& out) const {
+    size_t total = 0;
+    for (const auto& [name, size] : compiled_) {
+        out << name << ": " << size << " bytes\n";
+        total += size;
+    }
+    out << "compiled words: " << compiled_.size() << ", " << total << " bytes\n";
+}
+
+JitFunction JitCompiler::Compile(const BytecodeProgram& program, size_t entry) {
+#if !FORTH_JIT
+    return nullptr;
+#else
+    std::string word;
+    size_t end = program.code.size();
+    for (const auto& [name, address] : program.entries) {
+        if (static_cast<size_t>(address) == entry) {
+            word = name;
+        } else if (static_cast<size_t>(address) > entry) {
+            end = std::min(end, static_cast<size_t>(address));
+        }
+    }
+
+    std::map<Operator::Builtin, std::string> builtin_names;
+    for (const auto& word : Builtins::kWords) {
+        if (auto descriptor = Operator::FindBuiltin(word.name)) {
+            builtin_names[descriptor->checked] = word.name;
+            builtin_names[descriptor->unchecked] = word.name;
+        }
+    }
+    std::map<Opcode, const FusionRule*> expansions;
+    for (const auto& rule : PeepholeOptimizer::rules) {
+        expansions[rule.fused] = &rule;
+    }
+
+    std::vector<JitInstruction> instructions;
+    std::vector<bool> is_target(program.code.size() + 1, false);
+    for (size_t address = entry; address < end; ++address) {
+        const auto& instruction = program.code[address];
+        if (IsBranch(instruction.opcode)) {
+            is_target[address + instruction.operand] = true;
+        }
+        if (instruction.opcode == Opcode::kSwitch) {
+            for (const auto& [selector, offset] : program.switches[instruction.operand]) {
+                is_target[address + offset] = true;
+            }
+        }
+        auto expansion = expansions.find(instruction.opcode);
+        if (expansion == expansions.end()) {
+            JitInstruction lowered{instruction.opcode, instruction.operand,
+                                   address + instruction.operand, nullptr, "", address};
+            if (instruction.opcode == Opcode::kBuiltin) {
+                lowered.builtin = program.builtins[instruction.operand];
+                lowered.name = builtin_names[lowered.builtin];
+            }
+            instructions.push_back(lowered);
+            continue;
+        }
+        const auto& rule = *expansion->second;
+        for (size_t i = 0; i < rule.pattern.size(); ++i) {
+            const auto& step = rule.pattern[i];
+            JitInstruction lowered{step.opcode, 0, 0, nullptr, step.builtin, address};
+            if (i == rule.operand_from) {
+                lowered.operand = instruction.operand;
+                lowered.target = address + instruction.operand;
+            }
+            if (step.opcode == Opcode::kBuiltin) {
+                lowered.builtin = Operator::GetBuiltin(step.builtin).checked;
+            }
+            instructions.push_back(lowered);
+        }
+    }
+
+    const auto cells = offsetof(DataStack::Storage, cells);
+    const auto tags = offsetof(DataStack::Storage, tags);
+    const auto size = offsetof(DataStack::Storage, size);
+    const auto capacity = offsetof(DataStack::Storage, capacity);
+
+    Assembler a;
+    std::vector<std::pair<size_t, size_t>> branches; // displacement position and target bytecode address
+    std::vector<size_t> error_jumps;
+    std::vector<size_t> return_jumps;
+    std::vector<std::tuple<size_t, size_t, size_t>> entries; // jump table, entry and target bytecode address
+    std::map<size_t, size_t> labels; // bytecode address to native offset
+
+    bool cached = false; // whether the top of stack is in kTop and kTopTag rather than in memory
+
+    auto reload = [&] {
+        a.Mov(kCells, StackField(cells));
+        a.Mov(kTags, StackField(tags));
+        a.Mov(kSize, StackField(size));
+    };
+    // writes a cached top of stack back to memory
+    auto flush = [&] {
+        if (cached) {
+            a.Mov(Cell(0), kTop);
+            a.MovByte(Tag(0), kTopTag);
+            a.Inc(kSize);
+            cached = false;
+        }
+    };
+    // moves the top of stack from memory into the registers, which must not hold it already
+    auto fill = [&] {
+        a.Dec(kSize);
+        a.Mov(kTop, Cell(0));
+        a.MovzxByte(kTopTag, Tag(0));
+        cached = true;
+    };
+    // loads the element at the given offset into the top of stack registers
+    auto load = [&](int offset) {
+        a.Mov(kTop, Cell(offset));
+        a.MovzxByte(kTopTag, Tag(offset));
+    };
+    // calls a Runtime helper with the stack state written back, leaving its status in eax
+    auto call = [&](int (*helper)(JitContext*, int64_t), int64_t operand) {
+        flush();
+        a.Mov(StackField(size), kSize);
+        a.Mov(kRdi, kContext);
+        a.MovImmediate(kRsi, operand);
+        a.MovImmediate(kRax, reinterpret_cast<int64_t>(helper));
+        a.CallRax();
+        reload();
+    };
+    auto call_checked = [&](int (*helper)(JitContext*, int64_t), int64_t operand) {
+        call(helper, operand);
+        a.Test32(kRax, kRax);
+        error_jumps.push_back(a.Jump(kNotEqual));
+    };
+    auto call_builtin = [&](const JitInstruction& instruction) {
+        call_checked(Runtime::Builtin, reinterpret_cast<int64_t>(instruction.builtin));
+    };
+    // jumps to the slow path and whether the top of stack was cached when they were taken
+    using SlowPaths = std::vector<std::pair<size_t, bool>>;
+    // checks that the stack holds at least count elements, going to the slow path otherwise
+    auto require = [&](int count, SlowPaths& slow) {
+        int in_memory = count - (cached ? 1 : 0);
+        if (in_memory > 0) {
+            a.Cmp(kSize, in_memory);
+            slow.emplace_back(a.Jump(kBelow), cached);
+        }
+    };
+    // brings the top of stack into the registers, going to the slow path if the stack is empty
+    auto take = [&](SlowPaths& slow) {
+        if (!cached) {
+            require(1, slow);
+            fill();
+        }
+    };
+    // checks that the cached top of stack and the element below it are integers
+    auto require_integers = [&](SlowPaths& slow) {
+        a.MovzxByte(kRax, Tag(-1));
+        a.Arithmetic(0x09, kRax, kTopTag);
+        slow.emplace_back(a.Jump(kNotEqual), cached);
+    };
+    // spills the top of stack to make room for a new one, which the caller then loads into the registers
+    auto push = [&] {
+        flush();
+        a.Cmp(kSize, StackField(capacity));
+        size_t room = a.Jump(kBelow);
+        call_checked(Runtime::Grow, 0);
+        a.Bind(room);
+        cached = true;
+    };
+    // pops the top of stack into rax and compares its tag with the integer tag
+    auto pop = [&] {
+        if (cached) {
+            a.Mov(kRax, kTop);
+            a.Cmp32(kTopTag, 0);
+            cached = false;
+            return;
+        }
+        a.Cmp(kSize, 1);
+        size_t present = a.Jump(kAboveEqual);
+        call_checked(Runtime::Underflow, 1);
+        a.Bind(present);
+        a.Dec(kSize);
+        a.Mov(kRax, Cell(0));
+        a.CmpByte(Tag(0), 0);
+    };
+    // pops a flag and jumps to target if it is zero
+    auto jump_if_false = [&](size_t target) {
+        pop();
+        size_t integer = a.Jump(kEqual);
+        a.Add(kRax, kRax); // a double is false only as +0.0 or -0.0
+        a.Bind(integer);
+        a.Test(kRax, kRax);
+        branches.emplace_back(a.Jump(kEqual), target);
+    };
+    // binds the slow jumps, writing back the top of stack where it was cached, and calls the builtin
+    auto fallback = [&](const JitInstruction& instruction, const SlowPaths& slow) {
+        bool spilled = false;
+        for (auto [jump, in_registers] : slow) {
+            if (in_registers) {
+                a.Bind(jump);
+                spilled = true;
+            }
+        }
+        cached = spilled;
+        flush();
+        for (auto [jump, in_registers] : slow) {
+            if (!in_registers) {
+                a.Bind(jump);
+            }
+        }
+        call_builtin(instruction);
+    };
+    // emits the slow path of the fast path just emitted, leaving the stack state the same after both
+    auto with_fallback = [&](const JitInstruction& instruction, const SlowPaths& slow) {
+        if (slow.empty()) {
+            return;
+        }
+        bool after = cached;
+        size_t done = a.Jump();
+        fallback(instruction, slow);
+        if (after) {
+            fill();
+        }
+        a.Bind(done);
+    };
+
+    const std::map<std::string, uint8_t> arithmetic = {{"+", 0x01}, {"-", 0x29}, {"and", 0x21},
+                                                        {"or", 0x09}, {"xor", 0x31}};
+    const std::map<std::string, Condition> comparisons = {{"<", kLess}, {"<=", kLessEqual}, {">", kGreater},
+                                                          {">=", kGreaterEqual}, {"=", kEqual}};
+
+    for (auto r : {kRbx, kRbp, kR12, kR13, kR14, kR15}) {
+        a.Push(r);
+    }
+    a.Sub(kRsp, 8);
+    a.Mov(kContext, kRdi);
+    a.Mov(kStack, Memory{kRdi, static_cast<int32_t>(offsetof(JitContext, stack))});
+    reload();
+
+    for (size_t i = 0; i < instructions.size(); ++i) {
+        const auto& instruction = instructions[i];
+        if (!labels.contains(instruction.address)) {
+            if (is_target[instruction.address]) {
+                // branches arrive with the whole stack in memory
+                flush();
+            }
+            labels[instruction.address] = a.Here();
+        }
+        SlowPaths slow;
+        switch (instruction.opcode) {
+            case Opcode::kHalt:
+            case Opcode::kReturn:
+                flush();
+                return_jumps.push_back(a.Jump());
+                break;
+            case Opcode::kCall:
+            case Opcode::kTailCall:
+                call_checked(Runtime::Call, static_cast<int64_t>(instruction.target));
+                if (instruction.opcode == Opcode::kTailCall) {
+                    return_jumps.push_back(a.Jump());
+                }
+                break;
+            case Opcode::kRequire:
+                call_checked(Runtime::Require, reinterpret_cast<int64_t>(&program.effects[instruction.operand]));
+                break;
+            case Opcode::kPushConstant: {
+                const auto& constant = program.constants[instruction.operand];
+                push();
+                a.MovImmediate(kTop, constant.cell.integer);
+                a.MovImmediate32(kTopTag, static_cast<int32_t>(constant.type));
+                break;
+            }
+            case Opcode::kPushString:
+                call_checked(Runtime::PushString, reinterpret_cast<int64_t>(&program.strings[instruction.operand]));
+                break;
+            case Opcode::kPushVariable:
+                call_checked(Runtime::PushVariable, instruction.operand);
+                break;
+            case Opcode::kExecute:
+                call_checked(Runtime::Execute, reinterpret_cast<int64_t>(program.nodes[instruction.operand]));
+                break;
+            case Opcode::kJump:
+                flush();
+                branches.emplace_back(a.Jump(), instruction.target);
+                break;
+            case Opcode::kJumpIfFalse:
+                jump_if_false(instruction.target);
+                break;
+            case Opcode::kSwitch: {
+                pop();
+                size_t integer = a.Jump(kEqual);
+                a.TruncateRax();
+                a.Bind(integer);
+                const auto& table = *case_tables_.emplace_back(
+                    std::make_unique<CaseTable<int32_t>>(program.switches[instruction.operand]));
+                if (table.kind() == CaseTable<int32_t>::Kind::kEmpty) {
+                    break;
+                }
+                // dense selectors index the jump table directly, the others through the index of their case
+                bool dense = table.kind() == CaseTable<int32_t>::Kind::kDense;
+                const auto& selectors = table.selectors();
+                size_t count = dense ? static_cast<size_t>(selectors.back() - selectors.front()) + 1 : selectors.size();
+                if (dense) {
+                    a.MovImmediate(kRcx, selectors.front());
+                    a.Sub(kRax, kRcx);
+                } else {
+                    a.MovImmediate(kRdi, reinterpret_cast<int64_t>(&table));
+                    a.Mov(kRsi, kRax);
+                    a.MovImmediate(kRax, reinterpret_cast<int64_t>(&Runtime::Case));
+                    a.CallRax();
+                }
+                a.Cmp(kRax, static_cast<int32_t>(count));
+                size_t missing = a.Jump(kAboveEqual);
+                size_t jump_table = a.JumpTable(kRax, count);
+                for (size_t entry = 0; entry < count; ++entry) {
+                    a.BindEntry(jump_table, entry, a.Here());
+                }
+                for (size_t j = 0; j < selectors.size(); ++j) {
+                    size_t entry = dense ? static_cast<size_t>(selectors[j] - selectors.front()) : j;
+                    entries.emplace_back(jump_table, entry, instruction.address + table.targets()[j]);
+                }
+                a.Bind(missing);
+                break;
+            }
+            case Opcode::kDoEnter: {
+                call(Runtime::DoEnter, 0);
+                a.Cmp32(kRax, kJitError);
+                error_jumps.push_back(a.Jump(kEqual));
+                a.Cmp32(kRax, kJitBranch);
+                branches.emplace_back(a.Jump(kEqual), instruction.target);
+                break;
+            }
+            case Opcode::kDoLoop:
+                call(Runtime::DoLoop, 0);
+                a.Cmp32(kRax, kJitBranch);
+                branches.emplace_back(a.Jump(kEqual), instruction.target);
+                break;
+            case Opcode::kDoExit:
+                call(Runtime::DoExit, 0);
+                break;
+            case Opcode::kLoopIndex:
+                call_checked(Runtime::LoopIndex, instruction.operand);
+                break;
+            case Opcode::kBuiltin: {
+                const auto& name = instruction.name;
+                if (auto op = arithmetic.find(name); op != arithmetic.end()) {
+                    take(slow);
+                    require(2, slow);
+                    require_integers(slow);
+                    a.Mov(kRax, Cell(-1));
+                    a.Arithmetic(op->second, kRax, kTop);
+                    a.Mov(kTop, kRax);
+                    a.Dec(kSize);
+                    with_fallback(instruction, slow);
+                } else if (name == "*") {
+                    take(slow);
+                    require(2, slow);
+                    require_integers(slow);
+                    a.Imul(kTop, Cell(-1));
+                    a.Dec(kSize);
+                    with_fallback(instruction, slow);
+                } else if (auto comparison = comparisons.find(name); comparison != comparisons.end()) {
+                    const JitInstruction* next = i + 1 < instructions.size() ? &instructions[i + 1] : nullptr;
+                    bool branch = next && next->opcode == Opcode::kJumpIfFalse &&
+                                  (next->address == instruction.address || !is_target[next->address]);
+                    take(slow);
+                    require(2, slow);
+                    require_integers(slow);
+                    if (branch) {
+                        a.Dec(kSize);
+                        a.Mov(kRax, Cell(0));
+                        a.Cmp(kRax, kTop);
+                        cached = false;
+                        branches.emplace_back(a.Jump(static_cast<Condition>(comparison->second ^ 1)), next->target);
+                        size_t done = a.Jump();
+                        fallback(instruction, slow);
+                        jump_if_false(next->target);
+                        a.Bind(done);
+                        ++i;
+                    } else {
+                        a.Mov(kRax, Cell(-1));
+                        a.Cmp(kRax, kTop);
+                        a.SetRax(comparison->second);
+                        a.Mov(kTop, kRax);
+                        a.Dec(kSize);
+                        with_fallback(instruction, slow);
+                    }
+                } else if (name == "dup") {
+                    bool in_registers = cached;
+                    require(1, slow);
+                    push();
+                    if (!in_registers) {
+                        load(-1);
+                    }
+                    with_fallback(instruction, slow);
+                } else if (name == "over") {
+                    require(2, slow);
+                    push();
+                    load(-2);
+                    with_fallback(instruction, slow);
+                } else if (name == "drop") {
+                    if (cached) {
+                        cached = false;
+                    } else {
+                        require(1, slow);
+                        a.Dec(kSize);
+                        with_fallback(instruction, slow);
+                    }
+                } else if (name == "swap") {
+                    take(slow);
+                    require(2, slow);
+                    a.Mov(kRax, Cell(-1));
+                    a.Mov(Cell(-1), kTop);
+                    a.Mov(kTop, kRax);
+                    a.MovzxByte(kRax, Tag(-1));
+                    a.MovByte(Tag(-1), kTopTag);
+                    a.Mov(kTopTag, kRax);
+                    with_fallback(instruction, slow);
+                } else if (name == "nip") {
+                    take(slow);
+                    require(2, slow);
+                    a.Dec(kSize);
+                    with_fallback(instruction, slow);
+                } else if (name == "@") {
+                    take(slow);
+                    a.Mov(kTop, Memory{kTop});
+                    a.MovImmediate32(kTopTag, static_cast<int32_t>(StackElement::Type::kInteger));
+                    with_fallback(instruction, slow);
+                } else if (name == "!") {
+                    take(slow);
+                    require(2, slow);
+                    a.CmpByte(Tag(-1), static_cast<uint8_t>(StackElement::Type::kInteger));
+                    slow.emplace_back(a.Jump(kNotEqual), cached);
+                    a.Mov(kRcx, Cell(-1));
+                    a.Mov(Memory{kTop}, kRcx);
+                    a.Dec(kSize);
+                    cached = false;
+                    with_fallback(instruction, slow);
+                } else {
+                    call_builtin(instruction);
+                }
+                break;
+            }
+            default:
+                // superinstructions without an expansion rule are not supported natively
+                return nullptr;
+        }
+    }
+
+    flush();
+    size_t epilogue = a.Here();
+    a.Mov(StackField(size), kSize);
+    a.XorEax();
+    size_t restore = a.Jump();
+    size_t error = a.Here();
+    a.MovEax(kJitError);
+    a.Bind(restore);
+    a.Add(kRsp, 8);
+    for (auto r : {kR15, kR14, kR13, kR12, kRbp, kRbx}) {
+        a.Pop(r);
+    }
+    a.Ret();
+
+    for (auto jump : return_jumps) {
+        a.Bind(jump, epilogue);
+    }
+    for (auto jump : error_jumps) {
+        a.Bind(jump, error);
+    }
+    for (auto [jump, target] : branches) {
+        auto label = labels.find(target);
+        // branches leaving the word only happen at its end, which returns
+        a.Bind(jump, label != labels.end() ? label->second : epilogue);
+    }
+    for (auto [jump_table, entry, target] : entries) {
+        auto label = labels.find(target);
+        a.BindEntry(jump_table, entry, label != labels.end() ? label->second : epilogue);
+    }
+
+    const auto& machine_code = a.code();
+    auto page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    size_t length = (machine_code.size() + page - 1) / page * page;
+    void* memory = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+        return nullptr;
+    }
+    std::memcpy(memory, machine_code.data(), machine_code.size());
+    if (mprotect(memory, length, PROT_READ | PROT_EXEC) != 0) {
+        munmap(memory, length);
+        return nullptr;
+    }
+    regions_.emplace_back(memory, length);
+    compiled_[word] = machine_code.size();
+    return reinterpret_cast<JitFunction>(memory);
+#endif
+}
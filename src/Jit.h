@@ -0,0 +1,99 @@
+/**
+ * @file Jit.h
+ * @brief Defines the JitCompiler translating hot words from bytecode into x86-64 machine code.
+ */
+
+#ifndef JIT_H
+#define JIT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <map>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "Bytecode.h"
+#include "CaseTable.h"
+#include "DataStack.h"
+#include "Environment.h"
+
+#if defined(__x86_64__) && defined(__unix__)
+/**
+ * @brief Whether native code can be generated for this platform; otherwise every word stays interpreted.
+ */
+#define FORTH_JIT 1
+#else
+#define FORTH_JIT 0
+#endif
+
+class VirtualMachine;
+
+/**
+ * @struct JitContext
+ * @brief State passed to a compiled word in its only argument.
+ */
+struct JitContext {
+    DataStack::Storage* stack; ///< The data stack, addressed directly by the generated code.
+    Environment* environment;  ///< The execution environment passed on to builtins.
+    VirtualMachine* machine;   ///< The virtual machine running the word, used for calls and loops.
+    std::exception_ptr error;  ///< The exception thrown by a builtin, rethrown once the word has returned.
+};
+
+/**
+ * @brief A compiled word, returning kJitSuccess or kJitError.
+ */
+using JitFunction = int (*)(JitContext*);
+
+constexpr int kJitSuccess = 0; ///< The word returned normally.
+constexpr int kJitError = 1;   ///< A builtin threw, JitContext::error holds the exception.
+
+/**
+ * @class JitCompiler
+ * @brief Compiles words of a BytecodeProgram into native code in executable memory.
+ *
+ * The stack pointer and the cell and tag arrays of the data stack are kept in registers, and so is the
+ * top of stack, value and tag, between native instructions; it is written back to memory only before
+ * calls back into C++, branches to join points and returns. Integer arithmetic, comparisons, stack
+ * shuffles, literals, branches and CASE dispatch run natively, with a tag check falling back to the
+ * builtin for floating point operands. CASE jumps through a table of native addresses, indexed by the
+ * selector when the selectors are dense and otherwise by the case its CaseTable finds. Everything
+ * else, including calls of other words and DO LOOPs, calls back into the C++ implementations.
+ * Superinstructions are expanded back into the instructions they were fused from and comparisons
+ * followed by IF become native compare-and-branch sequences.
+ */
+class JitCompiler {
+public:
+    JitCompiler() = default;
+    JitCompiler(const JitCompiler&) = delete;
+    JitCompiler& operator=(const JitCompiler&) = delete;
+
+    /**
+     * @brief Releases the executable memory of all compiled words.
+     */
+    ~JitCompiler();
+
+    /**
+     * @brief Compiles the word starting at the given address.
+     * @param program The program holding the word; it must outlive the compiled code.
+     * @param entry The entry address of the word.
+     * @return The compiled word, or nullptr if native code cannot be generated.
+     */
+    JitFunction Compile(const BytecodeProgram& program, size_t entry);
+
+    /**
+     * @brief Prints the compiled words and the size of their machine code.
+     * @param out The stream to print to.
+     */
+    void Report(std::ostream& out) const;
+
+private:
+    struct Runtime;
+
+    std::vector<std::pair<void*, size_t>> regions_; ///< Executable memory mappings and their sizes.
+    std::map<std::string, size_t> compiled_;        ///< Machine code size of every compiled word.
+    std::vector<std::unique_ptr<CaseTable<int32_t>>> case_tables_; ///< Lookups of the CASEs in compiled words.
+};
+
+#endif //JIT_H
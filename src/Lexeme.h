@@ -1,6 +1,6 @@
 #ifndef LEXEME_H
 #define LEXEME_H
-#include <string>
+#include <string_view>
 
 class Lexeme {
 public:
@@ -17,7 +17,7 @@ public:
     };
     int row, column;
     LexemeType type;
-    std::string text;
+    std::string_view text; // points into the source text, which must outlive the lexeme
 private:
 
 };
@@ -0,0 +1,61 @@
+#include "Linker.h"
+#include <cstddef>
+
+void Linker::Link(Environment& environment) {
+    environment_ = &environment;
+    environment.code->Accept(*this);
+    for (const auto& [name, body] : environment.functions) {
+        body->Accept(*this);
+    }
+}
+
+void Linker::Link(Environment& environment, Executable& code) {
+    environment_ = &environment;
+    code.Accept(*this);
+}
+
+void Linker::Visit(VariableCreation& node) {
+    node.offset = environment_->data_space.Allot(node.ByteSize());
+    node.slot = environment_->VariableSlot(node.name);
+}
+
+void Linker::Visit(Codeblock& node) {
+    auto& statements = node.statements;
+    for (size_t i = 0; i < statements.size(); ++i) {
+        statements[i]->Accept(*this);
+        // I, J and K used to be variables holding the index, so older programs read them with @
+        auto index = std::dynamic_pointer_cast<Operator>(statements[i]);
+        if (index && Operator::LoopIndexDepth(index->text) >= 0 && i + 1 < statements.size()) {
+            auto fetch = std::dynamic_pointer_cast<Operator>(statements[i + 1]);
+            if (fetch && fetch->text == "@") {
+                statements.erase(statements.begin() + static_cast<std::ptrdiff_t>(i) + 1);
+            }
+        }
+    }
+}
+
+void Linker::Visit(class While& node) {
+    node.condition->Accept(*this);
+    node.body->Accept(*this);
+}
+
+void Linker::Visit(class For& node) {
+    node.body->Accept(*this);
+}
+
+void Linker::Visit(class If& node) {
+    node.if_part->Accept(*this);
+    if (node.else_part) {
+        node.else_part->Accept(*this);
+    }
+}
+
+void Linker::Visit(class Switch& node) {
+    for (const auto& [selector, code] : node.cases) {
+        code->Accept(*this);
+    }
+}
+
+void Linker::Visit(Operator& node) {
+    node.Resolve(*environment_);
+}
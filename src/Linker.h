@@ -0,0 +1,48 @@
+/**
+ * @file Linker.h
+ * @brief Defines the Linker pass binding every Operator to what its text refers to.
+ */
+
+#ifndef LINKER_H
+#define LINKER_H
+
+#include "Executable.h"
+#include "Environment.h"
+
+/**
+ * @class Linker
+ * @brief Resolves all operators of an analyzed program so that execution does no name lookups.
+ *
+ * Builtins become function pointers, words become pointers to their bodies,
+ * variables become slots in Environment::slots and literals are parsed once.
+ * Every variable and array gets its place in Environment::data_space, and the `@` of the
+ * `I @` idiom from when loop indices were variables is dropped.
+ */
+class Linker final : public ExecutableVisitor {
+public:
+    /**
+     * @brief Resolves the main code and all words of the environment.
+     * @param environment The environment produced by the GrammaticalAnalyzer.
+     */
+    void Link(Environment& environment);
+
+    /**
+     * @brief Resolves one more piece of code, such as a new word or a line typed into the REPL.
+     * @param environment The environment holding the words and variables defined so far.
+     * @param code The code to resolve.
+     */
+    void Link(Environment& environment, Executable& code);
+
+    void Visit(VariableCreation& node) override;
+    void Visit(Codeblock& node) override;
+    void Visit(class While& node) override;
+    void Visit(class For& node) override;
+    void Visit(class If& node) override;
+    void Visit(class Switch& node) override;
+    void Visit(Operator& node) override;
+
+private:
+    Environment* environment_ = nullptr; ///< The environment being linked.
+};
+
+#endif //LINKER_H
@@ -1,20 +1,48 @@
-#include <string>
-#include <regex>
+#include <cstddef>
 #include "Literals.h"
 
-bool IsInteger(const std::string& str) {
-    return std::regex_match(str, std::regex("-?[0-9]+"));
+namespace {
+
+// Returns the number of decimal digits starting at position.
+size_t CountDigits(std::string_view str, size_t position) {
+    size_t count = 0;
+    while (position + count < str.size() && str[position + count] >= '0' && str[position + count] <= '9') {
+        ++count;
+    }
+    return count;
 }
 
-bool IsDouble(const std::string& str) {
-    return std::regex_match(str, std::regex("-?[0-9]+([\\.][0-9]+)?"));
+} // namespace
+
+// -?[0-9]+
+bool IsInteger(std::string_view str) {
+    size_t sign = !str.empty() && str[0] == '-' ? 1 : 0;
+    size_t digits = CountDigits(str, sign);
+    return digits > 0 && sign + digits == str.size();
 }
 
-bool IsString(const std::string& str) {
+// -?[0-9]+(\.[0-9]+)?
+bool IsDouble(std::string_view str) {
+    size_t position = !str.empty() && str[0] == '-' ? 1 : 0;
+    size_t digits = CountDigits(str, position);
+    if (digits == 0) {
+        return false;
+    }
+    position += digits;
+    if (position == str.size()) {
+        return true;
+    }
+    if (str[position] != '.') {
+        return false;
+    }
+    digits = CountDigits(str, position + 1);
+    return digits > 0 && position + 1 + digits == str.size();
+}
+
+bool IsString(std::string_view str) {
     return str.size() >= 3 && str[0] == 's' && str[1] == '"' && str.back() == '"';
 }
 
-bool IsLiteral(const std::string& str) {
+bool IsLiteral(std::string_view str) {
     return IsInteger(str) || IsDouble(str) || IsString(str);
 }
-
@@ -1,11 +1,13 @@
 #ifndef LITERALS_H
 #define LITERALS_H
-bool IsInteger(const std::string& str);
+#include <string_view>
 
-bool IsDouble(const std::string& str);
+bool IsInteger(std::string_view str);
 
-bool IsString(const std::string& str);
+bool IsDouble(std::string_view str);
 
-bool IsLiteral(const std::string& str);
+bool IsString(std::string_view str);
+
+bool IsLiteral(std::string_view str);
 
 #endif //LITERALS_H
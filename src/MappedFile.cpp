@@ -0,0 +1,50 @@
+#include "MappedFile.h"
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#if defined(__unix__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(const std::string& file_path) {
+#if defined(__unix__)
+    int descriptor = open(file_path.c_str(), O_RDONLY);
+    if (descriptor < 0) {
+        throw std::runtime_error("failed to open " + file_path);
+    }
+    struct stat status {};
+    bool mapped = fstat(descriptor, &status) == 0;
+    if (mapped && status.st_size > 0) {
+        void* mapping = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, descriptor, 0);
+        mapped = mapping != MAP_FAILED;
+        if (mapped) {
+            data_ = static_cast<const char*>(mapping);
+            size_ = static_cast<size_t>(status.st_size);
+            madvise(mapping, size_, MADV_SEQUENTIAL);
+        }
+    }
+    close(descriptor);
+    if (!mapped) {
+        throw std::runtime_error("failed to map " + file_path);
+    }
+#else
+    std::ifstream in(file_path, std::ios::binary);
+    if (!in.is_open()) {
+        throw std::runtime_error("failed to open " + file_path);
+    }
+    buffer_.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    data_ = buffer_.data();
+    size_ = buffer_.size();
+#endif
+}
+
+MappedFile::~MappedFile() {
+#if defined(__unix__)
+    if (size_ > 0) {
+        munmap(const_cast<char*>(data_), size_);
+    }
+#endif
+}
@@ -0,0 +1,56 @@
+/**
+ * @file MappedFile.h
+ * @brief Defines the MappedFile class giving read-only access to the bytes of a file without copying them.
+ */
+
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+/**
+ * @class MappedFile
+ * @brief A file mapped into memory for reading, unmapped on destruction.
+ *
+ * On systems without mmap the file is read into a buffer instead.
+ */
+class MappedFile {
+public:
+    /**
+     * @brief Maps a whole file.
+     * @param file_path The path of the file.
+     * @throws std::runtime_error If the file cannot be opened or mapped.
+     */
+    explicit MappedFile(const std::string& file_path);
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    ~MappedFile();
+
+    const char* begin() const {
+        return data_;
+    }
+
+    const char* end() const {
+        return data_ + size_;
+    }
+
+    /**
+     * @brief Returns the contents of the file, valid while the file stays mapped.
+     */
+    std::string_view text() const {
+        return {data_, size_};
+    }
+
+private:
+    const char* data_ = ""; ///< The first byte of the file; an empty string for empty files, which are not mapped.
+    size_t size_ = 0;       ///< The size of the file in bytes.
+#if !defined(__unix__)
+    std::string buffer_;    ///< The contents of the file where mmap is not available.
+#endif
+};
+
+#endif //MAPPEDFILE_H
@@ -1,47 +1,128 @@
 #include "Executable.h"
+#include "Builtins.h"
 #include "Literals.h"
+#include "ArrayKernels.h"
+#include "Scheduler.h"
 #include <iostream>
 #include "StackElement.h"
 #include <cstring>
+#include <algorithm>
+#include <array>
+#include <iterator>
+#include <stdexcept>
+#include <string_view>
 Operator::Operator(std::string text) : text(text) {
 }
 
 Executable::ReturnStatus Operator::Execute(Environment& environment) {
-    if (operators_pointers.contains(text)) {
-        return operators_pointers[text](environment);
+    switch (kind) {
+        case Kind::kBuiltin:
+            return builtin(environment);
+        case Kind::kFunctionCall:
+            return FunctionCall(environment);
+        case Kind::kVariableUse:
+            return VariableUse(environment);
+        case Kind::kLiteral:
+        case Kind::kStringLiteral:
+            return Literal(environment);
+        case Kind::kSpawn:
+            return Spawn(environment);
+        case Kind::kNative:
+            native->function(environment);
+            return ReturnStatus::kSuccess;
+        case Kind::kUnresolved:
+            Resolve(environment);
+            return Execute(environment);
     }
-    if (environment.functions.contains(text)) {
-        return FunctionCall(environment);
+    throw std::runtime_error("unknown operator passed");
+}
+
+void Operator::Resolve(Environment& environment) {
+    if (kind == Kind::kSpawn) {
+        callee = environment.functions.at(text).get();
+        return;
     }
-    if (environment.variables.contains(text)) {
-        return VariableUse(environment);
+    if (auto descriptor = FindBuiltin(text)) {
+        kind = Kind::kBuiltin;
+        builtin = descriptor->checked;
+    } else if (environment.native_words.contains(text)) {
+        kind = Kind::kNative;
+        native = &environment.native_words.at(text);
+    } else if (environment.functions.contains(text)) {
+        kind = Kind::kFunctionCall;
+        callee = environment.functions[text].get();
+    } else if (IsInteger(text)) {
+        kind = Kind::kLiteral;
+        constant = StackElement(static_cast<int64_t>(std::stoll(text)));
+    } else if (IsDouble(text)) {
+        kind = Kind::kLiteral;
+        constant = StackElement(std::stod(text));
+    } else if (IsString(text)) {
+        kind = Kind::kStringLiteral;
+    } else {
+        kind = Kind::kVariableUse;
+        variable = environment.VariableSlot(text);
     }
-    if (IsLiteral(text)) {
-        return Literal(environment);
+}
+
+int32_t Operator::LoopIndexDepth(const std::string& text) {
+    if (text == "I") {
+        return 0;
     }
-    throw std::runtime_error("unknown operator passed");
+    if (text == "J") {
+        return 1;
+    }
+    if (text == "K") {
+        return 2;
+    }
+    return -1;
 }
 
 Executable::ReturnStatus Operator::FunctionCall(Environment& environment) {
-    auto status = environment.functions[text]->Execute(environment);
+    if (entry_check.known) {
+        environment.RequireStack(entry_check.inputs, entry_check.peak);
+    }
+    auto status = callee->Execute(environment);
     if (status == ReturnStatus::kLeaveFunction) {
         status = ReturnStatus::kSuccess;
     }
     return status;
 }
 
+Executable::ReturnStatus Operator::Spawn(Environment& environment) {
+    auto task = Scheduler::NewTask(environment);
+    // the tree walker cannot suspend a word, so the task runs to completion and PAUSE does nothing
+    task->step = [word = callee, check = entry_check](Environment& environment, size_t&) {
+        if (check.known) {
+            environment.RequireStack(check.inputs, check.peak);
+        }
+        word->Execute(environment);
+        return true;
+    };
+    Scheduler::Of(environment).Spawn(std::move(task));
+    return ReturnStatus::kSuccess;
+}
+
 Executable::ReturnStatus Operator::VariableUse(Environment &environment) {
-    environment.PushOnStack(StackElement(reinterpret_cast<int64_t>(environment.variables[text])));
+    auto address = environment.slots[variable];
+    if (address == nullptr) {
+        throw std::runtime_error("unknown operator passed");
+    }
+    if (unchecked) {
+        environment.PushOnStackUnchecked(StackElement(reinterpret_cast<int64_t>(address)));
+    } else {
+        environment.PushOnStack(StackElement(reinterpret_cast<int64_t>(address)));
+    }
     return ReturnStatus::kSuccess;
 }
 
 Executable::ReturnStatus Operator::Literal(Environment &environment) {
-    if (IsInteger(text)) {
-        environment.PushOnStack(StackElement(std::stoll(text)));
-        return ReturnStatus::kSuccess;
-    }
-    if (IsDouble(text)) {
-        environment.PushOnStack(StackElement(std::stod(text)));
+    if (kind == Kind::kLiteral) {
+        if (unchecked) {
+            environment.PushOnStackUnchecked(constant);
+        } else {
+            environment.PushOnStack(constant);
+        }
         return ReturnStatus::kSuccess;
     }
     environment.PushOnStack(StackElement(reinterpret_cast<int64_t>(text.c_str() + 2)));
@@ -49,292 +130,447 @@ Executable::ReturnStatus Operator::Literal(Environment &environment) {
     return ReturnStatus::kSuccess;
 }
 
+void Operator::Accept(ExecutableVisitor& visitor) {
+    visitor.Visit(*this);
+}
+
+template<bool kChecked>
+StackElement Pop(Environment& environment) {
+    if constexpr (kChecked) {
+        return environment.PopStack();
+    } else {
+        return environment.PopStackUnchecked();
+    }
+}
+
+template<bool kChecked>
+void Push(Environment& environment, StackElement element) {
+    if constexpr (kChecked) {
+        environment.PushOnStack(element);
+    } else {
+        environment.PushOnStackUnchecked(element);
+    }
+}
+
+template<bool kChecked>
 Executable::ReturnStatus AdditionOperator(Environment& environment) {
-    StackElement a = environment.PopStack();
-    StackElement b = environment.PopStack();
-    environment.PushOnStack(a + b);
+    StackElement a = Pop<kChecked>(environment);
+    StackElement b = Pop<kChecked>(environment);
+    Push<kChecked>(environment, a + b);
     return Executable::ReturnStatus::kSuccess;
 }
 
+template<bool kChecked>
 Executable::ReturnStatus SubtractionOperator(Environment& environment) {
-    StackElement a = environment.PopStack();
-    StackElement b = environment.PopStack();
-    environment.PushOnStack(b - a);
+    StackElement a = Pop<kChecked>(environment);
+    StackElement b = Pop<kChecked>(environment);
+    Push<kChecked>(environment, b - a);
     return Executable::ReturnStatus::kSuccess;
 }
 
+template<bool kChecked>
 Executable::ReturnStatus MultiplicationOperator(Environment& environment) {
-    StackElement a = environment.PopStack();
-    StackElement b = environment.PopStack();
-    environment.PushOnStack(a * b);
+    StackElement a = Pop<kChecked>(environment);
+    StackElement b = Pop<kChecked>(environment);
+    Push<kChecked>(environment, a * b);
     return Executable::ReturnStatus::kSuccess;
 }
 
+template<bool kChecked>
 Executable::ReturnStatus DivisionOperator(Environment& environment) {
-    StackElement a = environment.PopStack();
-    StackElement b = environment.PopStack();
-    environment.PushOnStack(b / a);
+    StackElement a = Pop<kChecked>(environment);
+    StackElement b = Pop<kChecked>(environment);
+    Push<kChecked>(environment, b / a);
     return Executable::ReturnStatus::kSuccess;
 }
 
+template<bool kChecked>
 Executable::ReturnStatus ModulusOperator(Environment& environment) {
-    StackElement a = environment.PopStack();
-    StackElement b = environment.PopStack();
-    environment.PushOnStack(b % a);
+    StackElement a = Pop<kChecked>(environment);
+    StackElement b = Pop<kChecked>(environment);
+    Push<kChecked>(environment, b % a);
     return Executable::ReturnStatus::kSuccess;
 }
 
+template<bool kChecked>
 Executable::ReturnStatus ConcatenationOperator(Environment& environment) {
-    auto sz2 = environment.PopStack().Convert<int64_t>();
-    auto address2 = environment.PopStack().Convert<char*>();
-    auto sz1 = environment.PopStack().Convert<int64_t >();
-    auto address1 = environment.PopStack().Convert<char*>();
+    auto sz2 = Pop<kChecked>(environment).template Convert<int64_t>();
+    auto address2 = Pop<kChecked>(environment).template Convert<char*>();
+    auto sz1 = Pop<kChecked>(environment).template Convert<int64_t >();
+    auto address1 = Pop<kChecked>(environment).template Convert<char*>();
     auto res_sz = sz1 + sz2;
     char* res = new char[res_sz];
     memcpy(res, address1, sz1);
     memcpy(res + sz1, address2, sz2);
-    environment.PushOnStack((int64_t)res);
-    environment.PushOnStack(res_sz);
+    Push<kChecked>(environment, (int64_t)res);
+    Push<kChecked>(environment, res_sz);
     return Executable::ReturnStatus::kSuccess;
 }
 
+template<bool kChecked>
 Executable::ReturnStatus NegationOperator(Environment& environment) {
-    StackElement a = environment.PopStack();
-    environment.PushOnStack(-a);
+    StackElement a = Pop<kChecked>(environment);
+    Push<kChecked>(environment, -a);
     return Executable::ReturnStatus::kSuccess;
 }
 
+template<bool kChecked>
 Executable::ReturnStatus InversionOperator(Environment& environment) {
-    StackElement a = environment.PopStack();
-    environment.PushOnStack(~a);
+    StackElement a = Pop<kChecked>(environment);
+    Push<kChecked>(environment, ~a);
     return Executable::ReturnStatus::kSuccess;
 }
 
+template<bool kChecked>
 Executable::ReturnStatus LshiftOperator(Environment& environment) {
-    auto k = environment.PopStack();
-    auto a = environment.PopStack();
-    a.value = (a.Convert<int64_t>() << k.Convert<int64_t>());
-    environment.PushOnStack(a);
+    StackElement k = Pop<kChecked>(environment);
+    StackElement a = Pop<kChecked>(environment);
+    Push<kChecked>(environment, a.Convert<int64_t>() << k.Convert<int64_t>());
     return Executable::ReturnStatus::kSuccess;
 }
 
+template<bool kChecked>
 Executable::ReturnStatus RshiftOperator(Environment& environment) {
-    auto k = environment.PopStack();
-    auto a = environment.PopStack();
-    a.value = (a.Convert<int64_t>() >> k.Convert<int64_t>());
-    environment.PushOnStack(a);
+    StackElement k = Pop<kChecked>(environment);
+    StackElement a = Pop<kChecked>(environment);
+    Push<kChecked>(environment, a.Convert<int64_t>() >> k.Convert<int64_t>());
     return Executable::ReturnStatus::kSuccess;
 }
 
+template<bool kChecked>
 Executable::ReturnStatus AndOperator(Environment& environment) {
-    auto a = environment.PopStack();
-    auto b = environment.PopStack();
-    environment.PushOnStack(a & b);
+    auto a = Pop<kChecked>(environment);
+    auto b = Pop<kChecked>(environment);
+    Push<kChecked>(environment, a & b);
     return Executable::ReturnStatus::kSuccess;
 }
 
+template<bool kChecked>
 Executable::ReturnStatus XorOperator(Environment& environment) {
-    auto a = environment.PopStack();
-    auto b = environment.PopStack();
-    environment.PushOnStack(a ^ b);
+    auto a = Pop<kChecked>(environment);
+    auto b = Pop<kChecked>(environment);
+    Push<kChecked>(environment, a ^ b);
     return Executable::ReturnStatus::kSuccess;
 }
 
+template<bool kChecked>
 Executable::ReturnStatus OrOperator(Environment& environment) {
-    auto a = environment.PopStack();
-    auto b = environment.PopStack();
-    environment.PushOnStack(a | b);
+    auto a = Pop<kChecked>(environment);
+    auto b = Pop<kChecked>(environment);
+    Push<kChecked>(environment, a | b);
     return Executable::ReturnStatus::kSuccess;
 }
 
+template<bool kChecked>
 Executable::ReturnStatus NotOperator(Environment& environment) {
-    auto a = environment.PopStack();
-    environment.PushOnStack(!a);
+    auto a = Pop<kChecked>(environment);
+    Push<kChecked>(environment, !a);
     return Executable::ReturnStatus::kSuccess;
 }
 
+template<bool kChecked>
 Executable::ReturnStatus DupOperator(Environment& environment) {
-    auto a = environment.PopStack();
-    environment.PushOnStack(a);
-    environment.PushOnStack(a);
+    auto a = Pop<kChecked>(environment);
+    Push<kChecked>(environment, a);
+    Push<kChecked>(environment, a);
     return Executable::ReturnStatus::kSuccess;
 }
 
+template<bool kChecked>
 Executable::ReturnStatus TwoDupOperator(Environment& environment) {
-    auto w2 = environment.PopStack();
-    auto w1 = environment.PopStack();
-    environment.PushOnStack(w1);
-    environment.PushOnStack(w2);
-    environment.PushOnStack(w1);
-    environment.PushOnStack(w2);
+    auto w2 = Pop<kChecked>(environment);
+    auto w1 = Pop<kChecked>(environment);
+    Push<kChecked>(environment, w1);
+    Push<kChecked>(environment, w2);
+    Push<kChecked>(environment, w1);
+    Push<kChecked>(environment, w2);
     return Executable::ReturnStatus::kSuccess;
 }
 
+template<bool kChecked>
 Executable::ReturnStatus DropOperator(Environment& environment) {
-    environment.PopStack();
+    Pop<kChecked>(environment);
     return Executable::ReturnStatus::kSuccess;
 }
 
+template<bool kChecked>
 Executable::ReturnStatus SwapOperator(Environment& environment) {
-    auto w2 = environment.PopStack();
-    auto w1 = environment.PopStack();
-    environment.PushOnStack(w2);
-    environment.PushOnStack(w1);
+    auto w2 = Pop<kChecked>(environment);
+    auto w1 = Pop<kChecked>(environment);
+    Push<kChecked>(environment, w2);
+    Push<kChecked>(environment, w1);
     return Executable::ReturnStatus::kSuccess;
 }
 
+template<bool kChecked>
 Executable::ReturnStatus OverOperator(Environment& environment) {
-    auto w2 = environment.PopStack();
-    auto w1 = environment.PopStack();
-    environment.PushOnStack(w1);
-    environment.PushOnStack(w2);
-    environment.PushOnStack(w1);
+    auto w2 = Pop<kChecked>(environment);
+    auto w1 = Pop<kChecked>(environment);
+    Push<kChecked>(environment, w1);
+    Push<kChecked>(environment, w2);
+    Push<kChecked>(environment, w1);
     return Executable::ReturnStatus::kSuccess;
 }
 
+template<bool kChecked>
 Executable::ReturnStatus RotOperator(Environment& environment) {
-    auto w3 = environment.PopStack();
-    auto w2 = environment.PopStack();
-    auto w1 = environment.PopStack();
-    environment.PushOnStack(w2);
-    environment.PushOnStack(w3);
-    environment.PushOnStack(w1);
+    auto w3 = Pop<kChecked>(environment);
+    auto w2 = Pop<kChecked>(environment);
+    auto w1 = Pop<kChecked>(environment);
+    Push<kChecked>(environment, w2);
+    Push<kChecked>(environment, w3);
+    Push<kChecked>(environment, w1);
     return Executable::ReturnStatus::kSuccess;
 }
 
+template<bool kChecked>
 Executable::ReturnStatus PickOperator(Environment& environment) {
-    auto a = environment.PopStack().Convert<int64_t>();
+    auto a = Pop<kChecked>(environment).template Convert<int64_t>();
     if (a >= 0 && a < (int64_t)environment.stack.size()) {
-        environment.PushOnStack(
+        Push<kChecked>(environment,
                 environment.stack[environment.stack.size() - a - 1]);
         return Executable::ReturnStatus::kSuccess;
     }
     throw std::runtime_error("Incorrect argument");
 }
 
+template<bool kChecked>
+Executable::ReturnStatus RollOperator(Environment& environment) {
+    auto a = Pop<kChecked>(environment).template Convert<int64_t>();
+    if (a >= 0 && a < (int64_t)environment.stack.size()) {
+        auto storage = environment.stack.storage();
+        size_t first = storage->size - a - 1;
+        std::rotate(storage->cells + first, storage->cells + first + 1, storage->cells + storage->size);
+        std::rotate(storage->tags + first, storage->tags + first + 1, storage->tags + storage->size);
+        return Executable::ReturnStatus::kSuccess;
+    }
+    throw std::runtime_error("Incorrect argument");
+}
+
+template<bool kChecked>
 Executable::ReturnStatus NipOperator(Environment& environment) {
-    auto w2 = environment.PopStack();
-    auto w1 = environment.PopStack();
-    environment.PushOnStack(w2);
+    auto w2 = Pop<kChecked>(environment);
+    auto w1 = Pop<kChecked>(environment);
+    Push<kChecked>(environment, w2);
     return Executable::ReturnStatus::kSuccess;
 }
 
+template<bool kChecked>
 Executable::ReturnStatus TuckOperator(Environment& environment) {
-    auto w2 = environment.PopStack();
-    auto w1 = environment.PopStack();
-    environment.PushOnStack(w2);
-    environment.PushOnStack(w1);
-    environment.PushOnStack(w2);
+    auto w2 = Pop<kChecked>(environment);
+    auto w1 = Pop<kChecked>(environment);
+    Push<kChecked>(environment, w2);
+    Push<kChecked>(environment, w1);
+    Push<kChecked>(environment, w2);
     return Executable::ReturnStatus::kSuccess;
 }
 
+template<bool kChecked>
 Executable::ReturnStatus EqualsOperator(Environment& environment) {
-    auto a = environment.PopStack();
-    auto b = environment.PopStack();
-    environment.PushOnStack(a == b);
+    auto a = Pop<kChecked>(environment);
+    auto b = Pop<kChecked>(environment);
+    Push<kChecked>(environment, a == b);
     return Executable::ReturnStatus::kSuccess;
 }
 
+template<bool kChecked>
 Executable::ReturnStatus EqualsStringOperator(Environment& environment) {
-    auto len1 = environment.PopStack().Convert<int64_t>();
-    auto cdata1 = environment.PopStack().Convert<char*>();
-    auto len2 = environment.PopStack().Convert<int64_t>();
-    auto cdata2 = environment.PopStack().Convert<char*>();
-    environment.PushOnStack(std::string(cdata1, len1) == std::string(cdata2, len2));
+    auto len1 = Pop<kChecked>(environment).template Convert<int64_t>();
+    auto cdata1 = Pop<kChecked>(environment).template Convert<char*>();
+    auto len2 = Pop<kChecked>(environment).template Convert<int64_t>();
+    auto cdata2 = Pop<kChecked>(environment).template Convert<char*>();
+    Push<kChecked>(environment, std::string(cdata1, len1) == std::string(cdata2, len2));
     return Executable::ReturnStatus::kSuccess;
 }
 
+template<bool kChecked>
 Executable::ReturnStatus LessOperator(Environment& environment) {
-    auto b = environment.PopStack();
-    auto a = environment.PopStack();
-    environment.PushOnStack(a < b);
+    auto b = Pop<kChecked>(environment);
+    auto a = Pop<kChecked>(environment);
+    Push<kChecked>(environment, a < b);
     return Executable::ReturnStatus::kSuccess;
 }
 
+template<bool kChecked>
 Executable::ReturnStatus LessEqOperator(Environment& environment) {
-    auto b = environment.PopStack();
-    auto a = environment.PopStack();
-    environment.PushOnStack(a <= b);
+    auto b = Pop<kChecked>(environment);
+    auto a = Pop<kChecked>(environment);
+    Push<kChecked>(environment, a <= b);
     return Executable::ReturnStatus::kSuccess;
 }
 
+template<bool kChecked>
 Executable::ReturnStatus GreaterOperator(Environment& environment) {
-    auto b = environment.PopStack();
-    auto a = environment.PopStack();
-    environment.PushOnStack(a > b);
+    auto b = Pop<kChecked>(environment);
+    auto a = Pop<kChecked>(environment);
+    Push<kChecked>(environment, a > b);
     return Executable::ReturnStatus::kSuccess;
 }
 
+template<bool kChecked>
 Executable::ReturnStatus GreaterEqOperator(Environment& environment)  {
-    auto b = environment.PopStack();
-    auto a = environment.PopStack();
-    environment.PushOnStack(a >= b);
+    auto b = Pop<kChecked>(environment);
+    auto a = Pop<kChecked>(environment);
+    Push<kChecked>(environment, a >= b);
     return Executable::ReturnStatus::kSuccess;
 }
 
-template<typename T>
+template<typename T, bool kChecked>
 Executable::ReturnStatus AssignmentOperator(Environment& environment) {
-    auto ptr = environment.PopStack().Convert<T*>();
-    auto val = environment.PopStack().Convert<T>();
+    auto ptr = Pop<kChecked>(environment).template Convert<T*>();
+    auto val = Pop<kChecked>(environment).template Convert<T>();
     *ptr = val;
     return Executable::ReturnStatus::kSuccess;
 }
 
-template<typename T>
+template<typename T, bool kChecked>
 Executable::ReturnStatus DereferenceOperator(Environment& environment) {
-    auto ptr = environment.PopStack().Convert<T*>();
-    environment.PushOnStack(*ptr);
+    auto ptr = Pop<kChecked>(environment).template Convert<T*>();
+    Push<kChecked>(environment, *ptr);
     return Executable::ReturnStatus::kSuccess;
 }
 
-template<typename T>
+template<typename T, bool kChecked>
 Executable::ReturnStatus InputOperator(Environment& environment) {
     T x;
     std::cin >> x;
-    environment.PushOnStack(x);
+    Push<kChecked>(environment, x);
     return Executable::ReturnStatus::kSuccess;
 }
 
-template<>
-Executable::ReturnStatus InputOperator<std::string>(Environment& environment) {
+template<bool kChecked>
+Executable::ReturnStatus StringInputOperator(Environment& environment) {
     std::string s;
     std::cin >> s;
     char* cs = new char[s.size()];
     for (int i = 0; i < s.size(); ++i) {
         cs[i] = s[i];
     }
-    environment.PushOnStack((int64_t)cs);
-    environment.PushOnStack((int64_t)s.size());
+    Push<kChecked>(environment, (int64_t)cs);
+    Push<kChecked>(environment, (int64_t)s.size());
     return Executable::ReturnStatus::kSuccess;
 }
 
+template<bool kChecked>
 Executable::ReturnStatus StringOutputOperator(Environment& environment) {
-    auto sz = environment.PopStack().Convert<size_t>();
-    auto address = environment.PopStack().Convert<char*>();
+    auto sz = Pop<kChecked>(environment).template Convert<size_t>();
+    auto address = Pop<kChecked>(environment).template Convert<char*>();
     std::cout << std::string(address, address + sz);
     return Executable::ReturnStatus::kSuccess;
 }
 
+template<bool kChecked>
 Executable::ReturnStatus CharOutputOperator(Environment& environment) {
-    char e = environment.PopStack().Convert<char>();
+    char e = Pop<kChecked>(environment).template Convert<char>();
     std::cout << e;
     return Executable::ReturnStatus::kSuccess;
 }
 
+template<bool kChecked>
 Executable::ReturnStatus StackBackOutputOperator(Environment& environment) {
-    StackElement a = environment.PopStack();
+    StackElement a = Pop<kChecked>(environment);
     std::cout << a << ' ';
     return Executable::ReturnStatus::kSuccess;
 }
 
+template<int32_t kDepth, bool kChecked>
+Executable::ReturnStatus LoopIndexOperator(Environment& environment) {
+    Push<kChecked>(environment, environment.LoopIndex(kDepth));
+    return Executable::ReturnStatus::kSuccess;
+}
+
+template<bool kChecked>
+Executable::ReturnStatus HereOperator(Environment& environment) {
+    auto& data_space = environment.data_space;
+    Push<kChecked>(environment, reinterpret_cast<int64_t>(data_space.Address(data_space.Here())));
+    return Executable::ReturnStatus::kSuccess;
+}
+
+template<bool kChecked>
+size_t PopArrayLength(Environment& environment) {
+    auto length = Pop<kChecked>(environment).template Convert<int64_t>();
+    if (length < 0) {
+        throw std::runtime_error("Negative array length");
+    }
+    return static_cast<size_t>(length);
+}
+
+// ( a b out n -- ) out[i] = a[i] op b[i]
+template<typename T, void (*kKernel)(const T*, const T*, T*, size_t), bool kChecked>
+Executable::ReturnStatus ArrayMapOperator(Environment& environment) {
+    auto length = PopArrayLength<kChecked>(environment);
+    auto out = Pop<kChecked>(environment).template Convert<T*>();
+    auto b = Pop<kChecked>(environment).template Convert<const T*>();
+    auto a = Pop<kChecked>(environment).template Convert<const T*>();
+    kKernel(a, b, out, length);
+    return Executable::ReturnStatus::kSuccess;
+}
+
+// ( a b mask n -- ) mask[i] = a[i] op b[i], stored as cells
+template<typename T, void (*kKernel)(const T*, const T*, int64_t*, size_t), bool kChecked>
+Executable::ReturnStatus ArrayCompareOperator(Environment& environment) {
+    auto length = PopArrayLength<kChecked>(environment);
+    auto mask = Pop<kChecked>(environment).template Convert<int64_t*>();
+    auto b = Pop<kChecked>(environment).template Convert<const T*>();
+    auto a = Pop<kChecked>(environment).template Convert<const T*>();
+    kKernel(a, b, mask, length);
+    return Executable::ReturnStatus::kSuccess;
+}
+
+// ( a k out n -- ) out[i] = a[i] * k
+template<typename T, bool kChecked>
+Executable::ReturnStatus ArrayScaleOperator(Environment& environment) {
+    auto length = PopArrayLength<kChecked>(environment);
+    auto out = Pop<kChecked>(environment).template Convert<T*>();
+    auto factor = Pop<kChecked>(environment).template Convert<T>();
+    auto a = Pop<kChecked>(environment).template Convert<const T*>();
+    ArrayKernels::Scale(a, factor, out, length);
+    return Executable::ReturnStatus::kSuccess;
+}
+
+// ( k x y n -- ) y[i] = y[i] + k * x[i]
+template<typename T, bool kChecked>
+Executable::ReturnStatus ArrayAxpyOperator(Environment& environment) {
+    auto length = PopArrayLength<kChecked>(environment);
+    auto y = Pop<kChecked>(environment).template Convert<T*>();
+    auto x = Pop<kChecked>(environment).template Convert<const T*>();
+    auto factor = Pop<kChecked>(environment).template Convert<T>();
+    ArrayKernels::Axpy(factor, x, y, length);
+    return Executable::ReturnStatus::kSuccess;
+}
+
+// ( a b n -- x ) x = sum of a[i] * b[i]
+template<typename T, bool kChecked>
+Executable::ReturnStatus ArrayDotOperator(Environment& environment) {
+    auto length = PopArrayLength<kChecked>(environment);
+    auto b = Pop<kChecked>(environment).template Convert<const T*>();
+    auto a = Pop<kChecked>(environment).template Convert<const T*>();
+    Push<kChecked>(environment, ArrayKernels::Dot(a, b, length));
+    return Executable::ReturnStatus::kSuccess;
+}
+
+// ( a n -- x ) x = reduction of all a[i]
+template<typename T, T (*kKernel)(const T*, size_t), bool kChecked>
+Executable::ReturnStatus ArrayReduceOperator(Environment& environment) {
+    auto length = PopArrayLength<kChecked>(environment);
+    auto a = Pop<kChecked>(environment).template Convert<const T*>();
+    Push<kChecked>(environment, kKernel(a, length));
+    return Executable::ReturnStatus::kSuccess;
+}
+
 Executable::ReturnStatus AllStackOutputOperator(Environment& environment) {
-    for (auto el : environment.stack) {
-        std::cout << el << ' ';
+    for (size_t i = 0; i < environment.stack.size(); ++i) {
+        std::cout << environment.stack[i] << ' ';
     }
     std::cout << "<" << environment.stack.size() << ">\n";
     return Executable::ReturnStatus::kSuccess;
 }
 
+// Yields to other tasks; the VirtualMachine handles it itself, everywhere else it does nothing.
+Executable::ReturnStatus PauseOperator(Environment& environment) {
+    return Executable::ReturnStatus::kSuccess;
+}
+
 Executable::ReturnStatus BreakOperator(Environment& environment) {
     return Executable::ReturnStatus::kLeaveLoop;
 }
@@ -347,65 +583,153 @@ Executable::ReturnStatus ReturnOperator(Environment& environment) {
     return Executable::ReturnStatus::kLeaveFunction;
 }
 
+template<bool kChecked>
 Executable::ReturnStatus ToCellOperator(Environment& environment) {
-    environment.PushOnStack(environment.PopStack().Convert<int64_t>());
+    Push<kChecked>(environment, Pop<kChecked>(environment).template Convert<int64_t>());
     return Executable::ReturnStatus::kSuccess;
 }
 
+template<bool kChecked>
 Executable::ReturnStatus ToFloatOperator(Environment& environment) {
-    environment.PushOnStack(environment.PopStack().Convert<double>());
-    return Executable::ReturnStatus::kSuccess;
-}
-
-std::map<
-    std::string,
-    std::function<Executable::ReturnStatus (Environment&)>
-> Operator::operators_pointers = {
-    {"+", AdditionOperator},
-    {"-", SubtractionOperator},
-    {"*", MultiplicationOperator},
-    {"/", DivisionOperator},
-    {"%", ModulusOperator},
-    {"s+", ConcatenationOperator},
-    {"negate", NegationOperator},
-    {"inverse", InversionOperator},
-    {"lshift", LshiftOperator},
-    {"rshift", RshiftOperator},
-    {"and", AndOperator},
-    {"or", OrOperator},
-    {"xor", XorOperator},
-    {"not", NotOperator},
-    {"dup", DupOperator},
-    {"2dup", TwoDupOperator},
-    {"drop", DropOperator},
-    {"swap", SwapOperator},
-    {"over", OverOperator},
-    {"rot", RotOperator},
-    {"pick", PickOperator},
-    {"nip", NipOperator},
-    {"tuck", TuckOperator},
-    {"=", EqualsOperator},
-    {"s=", EqualsStringOperator},
-    {"<", LessOperator},
-    {"<=", LessEqOperator},
-    {">", GreaterOperator},
-    {">=", GreaterEqOperator},
-    {"!", AssignmentOperator<int64_t>},
-    {"f!", AssignmentOperator<double>},
-    {"c!", AssignmentOperator<char>},
-    {"@", DereferenceOperator<int64_t>},
-    {"f@", DereferenceOperator<double>},
-    {"c@", DereferenceOperator<char>},
-    {"sinput", InputOperator<std::string>},
-    {"finput", InputOperator<double>},
-    {"input", InputOperator<int64_t>},
-    {"type", StringOutputOperator},
-    {"emit", CharOutputOperator},
-    {".", StackBackOutputOperator},
-    {".s", AllStackOutputOperator},
-    {"leave", BreakOperator},
-    {"continue", ContinueOperator},
-    {"return", ReturnOperator},
-    {"tocell", ToCellOperator},
-    {"tofloat", ToFloatOperator},
-};
\ No newline at end of file
+    Push<kChecked>(environment, Pop<kChecked>(environment).template Convert<double>());
+    return Executable::ReturnStatus::kSuccess;
+}
+
+namespace {
+
+struct BuiltinImplementation {
+    std::string_view name;
+    Operator::BuiltinDescriptor descriptor;
+};
+
+constexpr BuiltinImplementation kImplementations[] = {
+    {"+", {AdditionOperator<true>, AdditionOperator<false>, {2, 1}}},
+    {"-", {SubtractionOperator<true>, SubtractionOperator<false>, {2, 1}}},
+    {"*", {MultiplicationOperator<true>, MultiplicationOperator<false>, {2, 1}}},
+    {"/", {DivisionOperator<true>, DivisionOperator<false>, {2, 1}}},
+    {"%", {ModulusOperator<true>, ModulusOperator<false>, {2, 1}}},
+    {"s+", {ConcatenationOperator<true>, ConcatenationOperator<false>, {4, 2}}},
+    {"negate", {NegationOperator<true>, NegationOperator<false>, {1, 1}}},
+    {"invert", {InversionOperator<true>, InversionOperator<false>, {1, 1}}},
+    {"lshift", {LshiftOperator<true>, LshiftOperator<false>, {2, 1}}},
+    {"rshift", {RshiftOperator<true>, RshiftOperator<false>, {2, 1}}},
+    {"and", {AndOperator<true>, AndOperator<false>, {2, 1}}},
+    {"or", {OrOperator<true>, OrOperator<false>, {2, 1}}},
+    {"xor", {XorOperator<true>, XorOperator<false>, {2, 1}}},
+    {"not", {NotOperator<true>, NotOperator<false>, {1, 1}}},
+    {"dup", {DupOperator<true>, DupOperator<false>, {1, 2}}},
+    {"2dup", {TwoDupOperator<true>, TwoDupOperator<false>, {2, 4}}},
+    {"drop", {DropOperator<true>, DropOperator<false>, {1, 0}}},
+    {"swap", {SwapOperator<true>, SwapOperator<false>, {2, 2}}},
+    {"over", {OverOperator<true>, OverOperator<false>, {2, 3}}},
+    {"rot", {RotOperator<true>, RotOperator<false>, {3, 3}}},
+    {"pick", {PickOperator<true>, PickOperator<false>, {1, 1}}},
+    {"roll", {RollOperator<true>, RollOperator<false>, {1, 0}}},
+    {"nip", {NipOperator<true>, NipOperator<false>, {2, 1}}},
+    {"tuck", {TuckOperator<true>, TuckOperator<false>, {2, 3}}},
+    {"=", {EqualsOperator<true>, EqualsOperator<false>, {2, 1}}},
+    {"s=", {EqualsStringOperator<true>, EqualsStringOperator<false>, {4, 1}}},
+    {"<", {LessOperator<true>, LessOperator<false>, {2, 1}}},
+    {"<=", {LessEqOperator<true>, LessEqOperator<false>, {2, 1}}},
+    {">", {GreaterOperator<true>, GreaterOperator<false>, {2, 1}}},
+    {">=", {GreaterEqOperator<true>, GreaterEqOperator<false>, {2, 1}}},
+    {"!", {AssignmentOperator<int64_t, true>, AssignmentOperator<int64_t, false>, {2, 0}}},
+    {"f!", {AssignmentOperator<double, true>, AssignmentOperator<double, false>, {2, 0}}},
+    {"c!", {AssignmentOperator<char, true>, AssignmentOperator<char, false>, {2, 0}}},
+    {"@", {DereferenceOperator<int64_t, true>, DereferenceOperator<int64_t, false>, {1, 1}}},
+    {"f@", {DereferenceOperator<double, true>, DereferenceOperator<double, false>, {1, 1}}},
+    {"c@", {DereferenceOperator<char, true>, DereferenceOperator<char, false>, {1, 1}}},
+    {"sinput", {StringInputOperator<true>, StringInputOperator<false>, {0, 2}}},
+    {"finput", {InputOperator<double, true>, InputOperator<double, false>, {0, 1}}},
+    {"input", {InputOperator<int64_t, true>, InputOperator<int64_t, false>, {0, 1}}},
+    {"type", {StringOutputOperator<true>, StringOutputOperator<false>, {2, 0}}},
+    {"emit", {CharOutputOperator<true>, CharOutputOperator<false>, {1, 0}}},
+    {".", {StackBackOutputOperator<true>, StackBackOutputOperator<false>, {1, 0}}},
+    {".s", {AllStackOutputOperator, AllStackOutputOperator, {0, 0}}},
+    {"leave", {BreakOperator, BreakOperator, StackEffect::Unknown()}},
+    {"continue", {ContinueOperator, ContinueOperator, StackEffect::Unknown()}},
+    {"return", {ReturnOperator, ReturnOperator, StackEffect::Unknown()}},
+    {"tocell", {ToCellOperator<true>, ToCellOperator<false>, {1, 1}}},
+    {"tofloat", {ToFloatOperator<true>, ToFloatOperator<false>, {1, 1}}},
+    {"here", {HereOperator<true>, HereOperator<false>, {0, 1}}},
+    {"PAUSE", {PauseOperator, PauseOperator, {0, 0}}},
+    {"v+", {ArrayMapOperator<int64_t, &ArrayKernels::Add<int64_t>, true>, ArrayMapOperator<int64_t, &ArrayKernels::Add<int64_t>, false>, {4, 0}}},
+    {"v-", {ArrayMapOperator<int64_t, &ArrayKernels::Subtract<int64_t>, true>, ArrayMapOperator<int64_t, &ArrayKernels::Subtract<int64_t>, false>, {4, 0}}},
+    {"v*", {ArrayMapOperator<int64_t, &ArrayKernels::Multiply<int64_t>, true>, ArrayMapOperator<int64_t, &ArrayKernels::Multiply<int64_t>, false>, {4, 0}}},
+    {"vscale", {ArrayScaleOperator<int64_t, true>, ArrayScaleOperator<int64_t, false>, {4, 0}}},
+    {"vaxpy", {ArrayAxpyOperator<int64_t, true>, ArrayAxpyOperator<int64_t, false>, {4, 0}}},
+    {"vdot", {ArrayDotOperator<int64_t, true>, ArrayDotOperator<int64_t, false>, {3, 1}}},
+    {"vsum", {ArrayReduceOperator<int64_t, &ArrayKernels::Sum<int64_t>, true>, ArrayReduceOperator<int64_t, &ArrayKernels::Sum<int64_t>, false>, {2, 1}}},
+    {"vmin", {ArrayReduceOperator<int64_t, &ArrayKernels::Min<int64_t>, true>, ArrayReduceOperator<int64_t, &ArrayKernels::Min<int64_t>, false>, {2, 1}}},
+    {"vmax", {ArrayReduceOperator<int64_t, &ArrayKernels::Max<int64_t>, true>, ArrayReduceOperator<int64_t, &ArrayKernels::Max<int64_t>, false>, {2, 1}}},
+    {"v<", {ArrayCompareOperator<int64_t, &ArrayKernels::Less<int64_t>, true>, ArrayCompareOperator<int64_t, &ArrayKernels::Less<int64_t>, false>, {4, 0}}},
+    {"v=", {ArrayCompareOperator<int64_t, &ArrayKernels::Equal<int64_t>, true>, ArrayCompareOperator<int64_t, &ArrayKernels::Equal<int64_t>, false>, {4, 0}}},
+    {"v>", {ArrayCompareOperator<int64_t, &ArrayKernels::Greater<int64_t>, true>, ArrayCompareOperator<int64_t, &ArrayKernels::Greater<int64_t>, false>, {4, 0}}},
+    {"fv+", {ArrayMapOperator<double, &ArrayKernels::Add<double>, true>, ArrayMapOperator<double, &ArrayKernels::Add<double>, false>, {4, 0}}},
+    {"fv-", {ArrayMapOperator<double, &ArrayKernels::Subtract<double>, true>, ArrayMapOperator<double, &ArrayKernels::Subtract<double>, false>, {4, 0}}},
+    {"fv*", {ArrayMapOperator<double, &ArrayKernels::Multiply<double>, true>, ArrayMapOperator<double, &ArrayKernels::Multiply<double>, false>, {4, 0}}},
+    {"fvscale", {ArrayScaleOperator<double, true>, ArrayScaleOperator<double, false>, {4, 0}}},
+    {"fvaxpy", {ArrayAxpyOperator<double, true>, ArrayAxpyOperator<double, false>, {4, 0}}},
+    {"fvdot", {ArrayDotOperator<double, true>, ArrayDotOperator<double, false>, {3, 1}}},
+    {"fvsum", {ArrayReduceOperator<double, &ArrayKernels::Sum<double>, true>, ArrayReduceOperator<double, &ArrayKernels::Sum<double>, false>, {2, 1}}},
+    {"fvmin", {ArrayReduceOperator<double, &ArrayKernels::Min<double>, true>, ArrayReduceOperator<double, &ArrayKernels::Min<double>, false>, {2, 1}}},
+    {"fvmax", {ArrayReduceOperator<double, &ArrayKernels::Max<double>, true>, ArrayReduceOperator<double, &ArrayKernels::Max<double>, false>, {2, 1}}},
+    {"fv<", {ArrayCompareOperator<double, &ArrayKernels::Less<double>, true>, ArrayCompareOperator<double, &ArrayKernels::Less<double>, false>, {4, 0}}},
+    {"fv=", {ArrayCompareOperator<double, &ArrayKernels::Equal<double>, true>, ArrayCompareOperator<double, &ArrayKernels::Equal<double>, false>, {4, 0}}},
+    {"fv>", {ArrayCompareOperator<double, &ArrayKernels::Greater<double>, true>, ArrayCompareOperator<double, &ArrayKernels::Greater<double>, false>, {4, 0}}},
+    {"I", {LoopIndexOperator<0, true>, LoopIndexOperator<0, false>, {0, 1}}},
+    {"J", {LoopIndexOperator<1, true>, LoopIndexOperator<1, false>, {0, 1}}},
+    {"K", {LoopIndexOperator<2, true>, LoopIndexOperator<2, false>, {0, 1}}},
+};
+
+// Operators the GrammaticalAnalyzer turns into other nodes, which never reach the dispatcher.
+constexpr std::string_view kSyntaxOperators[] = {"VARIABLE", "CREATE", "allot", "chars", "floats", "cells", "SPAWN"};
+
+// The implementations at the index of their word in Builtins::kWords. Which slots are filled is
+// kept apart, since comparing function pointers with nullptr is not a constant expression everywhere.
+struct IndexedImplementations {
+    std::array<Operator::BuiltinDescriptor, Builtins::kWords.size()> descriptors{};
+    std::array<bool, Builtins::kWords.size()> implemented{};
+};
+
+// Places every implementation at the index of its word in Builtins::kWords, failing to compile
+// if the implementations and the operators the lexer knows have drifted apart.
+consteval IndexedImplementations IndexImplementations() {
+    IndexedImplementations indexed;
+    for (const auto& implementation : kImplementations) {
+        int index = Builtins::Find(implementation.name);
+        if (index < 0 || Builtins::kWords[index].type != Lexeme::LexemeType::kOperator) {
+            throw "an implemented operator is missing from Builtins::kWords";
+        }
+        if (indexed.implemented[index]) {
+            throw "an operator is implemented twice";
+        }
+        indexed.descriptors[index] = implementation.descriptor;
+        indexed.implemented[index] = true;
+    }
+    for (size_t i = 0; i < indexed.descriptors.size(); ++i) {
+        if (Builtins::kWords[i].type == Lexeme::LexemeType::kOperator && !indexed.implemented[i] &&
+            std::find(std::begin(kSyntaxOperators), std::end(kSyntaxOperators), Builtins::kWords[i].name) ==
+            std::end(kSyntaxOperators)) {
+            throw "an operator of Builtins::kWords is not implemented";
+        }
+    }
+    return indexed;
+}
+
+constexpr auto kIndexed = IndexImplementations();
+
+} // namespace
+
+const Operator::BuiltinDescriptor* Operator::FindBuiltin(std::string_view name) {
+    int index = Builtins::Find(name);
+    return index >= 0 && kIndexed.implemented[index] ? &kIndexed.descriptors[index] : nullptr;
+}
+
+const Operator::BuiltinDescriptor& Operator::GetBuiltin(std::string_view name) {
+    auto descriptor = FindBuiltin(name);
+    if (descriptor == nullptr) {
+        throw std::out_of_range("'" + std::string(name) + "' is not a builtin operator");
+    }
+    return *descriptor;
+}
@@ -0,0 +1,56 @@
+#include "ParallelLoop.h"
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+#include "WorkStealingPool.h"
+
+void ParallelLoop::Run(Environment& environment, Operator::Builtin reduction, const Body& body) {
+    auto from = environment.PopStack().Convert<int64_t>();
+    auto to = environment.PopStack().Convert<int64_t>();
+    auto step = environment.PopStack().Convert<int64_t>();
+    if (step == 0) {
+        throw std::runtime_error("PDO step must not be zero");
+    }
+    if (reduction != nullptr && environment.stack.empty()) {
+        throw std::runtime_error("Zero elements on stack when popping it");
+    }
+    // computed in unsigned arithmetic, so that ranges spanning more than half of int64_t do not overflow
+    uint64_t distance = step > 0 ? static_cast<uint64_t>(to) - static_cast<uint64_t>(from)
+                                 : static_cast<uint64_t>(from) - static_cast<uint64_t>(to);
+    uint64_t stride = step > 0 ? static_cast<uint64_t>(step) : 0 - static_cast<uint64_t>(step);
+    if (step > 0 ? from >= to : from <= to) {
+        return;
+    }
+    uint64_t iterations = (distance - 1) / stride + 1;
+    uint64_t chunks = std::min(iterations, kMaxChunks);
+    std::vector<StackElement> results(chunks, StackElement(int64_t(0)));
+    WorkStealingPool::Shared().Run(chunks, [&](size_t chunk) {
+        uint64_t first = iterations / chunks * chunk + std::min<uint64_t>(chunk, iterations % chunks);
+        uint64_t last = first + iterations / chunks + (chunk < iterations % chunks ? 1 : 0);
+        Environment worker;
+        worker.stack = environment.stack;
+        worker.loops = environment.loops;
+        worker.slots = environment.slots;
+        worker.scheduler = environment.scheduler;
+        worker.loops.push_back({from, to, step});
+        for (uint64_t i = first; i < last; ++i) {
+            auto index = static_cast<int64_t>(static_cast<uint64_t>(from) + i * static_cast<uint64_t>(step));
+            worker.loops.back().index = index;
+            body(worker, index);
+        }
+        if (worker.stack.size() != environment.stack.size()) {
+            throw std::runtime_error("PDO loop changes the stack depth");
+        }
+        if (reduction != nullptr) {
+            results[chunk] = worker.stack.back();
+        }
+    });
+    if (reduction == nullptr) {
+        return;
+    }
+    environment.stack.set_back(results[0]);
+    for (size_t chunk = 1; chunk < chunks; ++chunk) {
+        environment.PushOnStack(results[chunk]);
+        reduction(environment);
+    }
+}
@@ -0,0 +1,47 @@
+/**
+ * @file ParallelLoop.h
+ * @brief Defines the ParallelLoop class running the iterations of a PDO ... PLOOP on a WorkStealingPool.
+ */
+
+#ifndef PARALLELLOOP_H
+#define PARALLELLOOP_H
+
+#include <cstdint>
+#include <functional>
+#include "Executable.h"
+
+/**
+ * @class ParallelLoop
+ * @brief Splits the range of a parallel DO LOOP into chunks run concurrently.
+ *
+ * Every chunk runs its iterations in order in an Environment of its own, starting with a copy of
+ * the data stack and the loop-control stack, and must leave the stack depth unchanged. With a
+ * reduction, the top of stack of every chunk is its result; the results are combined in chunk order
+ * and replace the top of stack, which must be the identity of the reduction, such as 0 for `+`.
+ * The number of chunks depends only on the number of iterations, so results do not depend on the
+ * number of threads.
+ */
+class ParallelLoop {
+public:
+    /**
+     * @brief Runs one iteration in the environment of a chunk with the given loop index.
+     */
+    using Body = std::function<void(Environment&, int64_t)>;
+
+    /**
+     * @brief The largest number of chunks a range is split into.
+     */
+    static constexpr uint64_t kMaxChunks = 64;
+
+    /**
+     * @brief Pops from, to and step and runs the body for every index of the range.
+     * @param environment The execution environment.
+     * @param reduction The builtin combining the results of two chunks, or nullptr for no reduction.
+     * @param body The loop body.
+     * @throws std::runtime_error If step is zero, the stack holds nothing to reduce into or a chunk
+     *         changes the stack depth, or whatever the body threw.
+     */
+    static void Run(Environment& environment, Operator::Builtin reduction, const Body& body);
+};
+
+#endif //PARALLELLOOP_H
@@ -1,82 +1,237 @@
-#include <regex>
+#include <algorithm>
+#include <bit>
+#include <functional>
+#include <set>
+#include "Builtins.h"
 #include "Lexeme.h"
 #include "Literals.h"
 #include "Parser.h"
-std::vector<Lexeme> Parser::GetResult() {
+#include "SourceScanner.h"
+#include "WorkStealingPool.h"
+
+const std::vector<Lexeme>& Parser::GetResult() const {
     return result;
 }
 
-bool IsDelimeter(char c) {
-    return c == '\n' || c == ' ';
+const std::map<std::string, std::string>& Parser::GetStackComments() const {
+    return stack_comments;
 }
 
-Parser::Parser(const std::string& input, const std::vector<std::string>& keywords, const std::vector<std::string>& operators) {
-    Trie keyword_trie;
-    for (const auto& str : keywords) {
-        keyword_trie.Add(str);
-    }
-    Trie operator_trie;
-    for (const auto& str : operators) {
-        operator_trie.Add(str);
-    }
-    std::string cur_str;
-    int line = 1;
-    int current_column = 0;
-    for (int i = 0; i < input.size(); ++i) {
-        char c = input[i];
-        if (IsDelimeter(c) && !cur_str.empty() &&
-            !(cur_str.size() >= 3 && cur_str[0] == 's' && cur_str[1] == '"' && cur_str.back() != '"')) {
-            Lexeme current;
-            current.row = line;
-            current.column = current_column;
-            current.type = Lexeme::LexemeType::kError;
-            current.text = cur_str;
-            if (keyword_trie.Contains(cur_str)) {
-                current.type = Lexeme::LexemeType::kKeyword;
-            } else if (IsLiteral(cur_str)) {
-                current.type = Lexeme::LexemeType::kLiteral;
-            } else if (operator_trie.Contains(cur_str)) {
-                current.type = Lexeme::LexemeType::kOperator;
-            } else if (cur_str == ":") {
-                current.type = Lexeme::LexemeType::kFunctionDefinitionStart;
-            } else if (cur_str == ";") {
-                current.type = Lexeme::LexemeType::kFunctionDefinitionEnd;
-            } else {
-                current.type = Lexeme::LexemeType::kIdentifier;
+bool Parser::EndsInsideCommentOrString() const {
+    return ends_inside;
+}
+
+namespace {
+
+// What the characters being scanned belong to.
+enum class State {
+    kBetween,      // whitespace between lexemes
+    kToken,        // a lexeme, ended by whitespace or the start of a comment
+    kString,       // a s" string, ended like a lexeme but only right after a quote
+    kParenComment, // a ( ) comment, which may nest
+    kSlashComment  // a \ comment, up to the end of the line
+};
+
+bool EndsToken(char c) {
+    return c == ' ' || c == '\n' || c == '(' || c == '\\';
+}
+
+// s" followed by more than whitespace starts a string, in which whitespace and comment characters
+// belong to the string until one follows a quote
+bool StartsString(std::string_view input, size_t i) {
+    return input.substr(i, 2) == "s\"" && i + 2 < input.size() && !EndsToken(input[i + 2]);
+}
+
+// Inputs are lexed in pieces of about this many bytes on the WorkStealingPool.
+constexpr size_t kPieceBytes = 1 << 18;
+
+// The lexemes of a part of the input, with lines counted from its start.
+struct Piece {
+    std::vector<Lexeme> lexemes;
+    std::map<std::string, std::string> stack_comments;
+    int lines = 1;                 // the line of the last character
+    State state = State::kBetween; // what the last character belongs to
+};
+
+void Lex(std::string_view input, const std::set<std::string, std::less<>>& extra_operators, Piece& piece) {
+    auto& result = piece.lexemes;
+    auto add_lexeme = [&](std::string_view text, int line, int column) {
+        Lexeme current;
+        current.row = line;
+        current.column = column;
+        current.text = text;
+        int builtin = Builtins::Find(text);
+        if (builtin >= 0) {
+            current.type = Builtins::kWords[builtin].type;
+        } else if (IsLiteral(text)) {
+            current.type = Lexeme::LexemeType::kLiteral;
+        } else if (!extra_operators.empty() && extra_operators.contains(text)) {
+            current.type = Lexeme::LexemeType::kOperator;
+        } else {
+            current.type = Lexeme::LexemeType::kIdentifier;
+        }
+        result.push_back(current);
+    };
+    // code averages six to seven bytes per lexeme; the pages of the unused tail are never touched
+    result.reserve(input.size() / 4);
+    // the input is classified in blocks, and each state only looks at the characters that can end it;
+    // comments right after ": name" are remembered as stack comments of the word
+    State state = State::kBetween;
+    size_t token_start = 0;
+    size_t comment_start = 0;
+    int balance = 0;
+    int line = 1;              // the line at the start of the block
+    size_t line_start = 0;     // the position of the first character of that line
+    uint64_t quote_carry = 0;  // whether the last character of the previous block is a quote
+    SourceScanner::Block blocks[SourceScanner::kBatchBlocks];
+    for (size_t block_start = 0; block_start < input.size(); block_start += SourceScanner::kBlockSize) {
+        size_t size = std::min(SourceScanner::kBlockSize, input.size() - block_start);
+        size_t in_batch = block_start / SourceScanner::kBlockSize % SourceScanner::kBatchBlocks;
+        if (in_batch == 0) {
+            SourceScanner::Classify(input.data() + block_start,
+                                    std::min(SourceScanner::kBlockSize * SourceScanner::kBatchBlocks,
+                                             input.size() - block_start), blocks);
+        }
+        const auto& block = blocks[in_batch];
+        uint64_t in_block = size == SourceScanner::kBlockSize ? ~uint64_t(0) : (uint64_t(1) << size) - 1;
+        uint64_t token_ends = block.whitespace | block.open | block.backslash;
+        uint64_t after_quote = (block.quote << 1) | quote_carry;
+        quote_carry = block.quote >> 63;
+        size_t offset = 0;
+        while (offset < size) {
+            uint64_t candidates = 0;
+            switch (state) {
+                case State::kBetween:
+                    candidates = ~block.whitespace & in_block;
+                    break;
+                case State::kToken:
+                    candidates = token_ends;
+                    break;
+                case State::kString:
+                    candidates = token_ends & after_quote;
+                    break;
+                case State::kParenComment:
+                    candidates = block.open | block.close;
+                    break;
+                case State::kSlashComment:
+                    candidates = block.newline;
+                    break;
+            }
+            candidates &= ~uint64_t(0) << offset;
+            if (candidates == 0) {
+                break;
+            }
+            offset = std::countr_zero(candidates);
+            size_t i = block_start + offset;
+            char c = input[i];
+            switch (state) {
+                case State::kBetween:
+                    if (c == '(') {
+                        state = State::kParenComment;
+                        balance = 1;
+                        comment_start = i;
+                    } else if (c == '\\') {
+                        state = State::kSlashComment;
+                    } else {
+                        state = StartsString(input, i) ? State::kString : State::kToken;
+                        token_start = i;
+                    }
+                    ++offset;
+                    break;
+                case State::kToken:
+                case State::kString: {
+                    uint64_t newlines = block.newline & ((uint64_t(1) << offset) - 1);
+                    size_t current_line_start = newlines == 0 ? line_start : block_start + 64 - std::countl_zero(newlines);
+                    add_lexeme(input.substr(token_start, i - token_start), line + std::popcount(newlines),
+                               static_cast<int>(i - current_line_start));
+                    // the character ending the lexeme may start a comment
+                    state = State::kBetween;
+                    break;
+                }
+                case State::kParenComment:
+                    if (c == '(') {
+                        ++balance;
+                    } else if (--balance == 0) {
+                        auto comment = input.substr(comment_start, i + 1 - comment_start);
+                        if (result.size() >= 2 && result[result.size() - 2].text == ":" &&
+                            result.back().type == Lexeme::LexemeType::kIdentifier &&
+                            comment.find("--") != std::string_view::npos) {
+                            piece.stack_comments[std::string(result.back().text)] = comment;
+                        }
+                        state = State::kBetween;
+                    }
+                    ++offset;
+                    break;
+                case State::kSlashComment:
+                    state = State::kBetween;
+                    ++offset;
+                    break;
             }
-            result.push_back(current);
-            cur_str.clear();
-        } else if (!IsDelimeter(c) || (cur_str.size() >= 2 && cur_str[0] == 's' && cur_str[1] == '"')) {
-            cur_str += c;
         }
-        if (c == '\n') {
-            line++;
-            current_column = 0;
-        } else {
-            current_column++;
+        if (block.newline != 0) {
+            line += std::popcount(block.newline);
+            line_start = block_start + 64 - std::countl_zero(block.newline);
         }
     }
+    if (state == State::kToken || state == State::kString) {
+        add_lexeme(input.substr(token_start), line, static_cast<int>(input.size() - line_start));
+    }
+    piece.lines = line;
+    piece.state = state;
 }
 
-void Parser::Trie::Add(std::string str) {
-    Node* current_node = root.get();
-    for (auto c : str) {
-        if (current_node->go.find(c) == current_node->go.end()) {
-            current_node->go[c] = std::make_unique<Node>();
+} // namespace
+
+Parser::Parser(std::string_view input, const std::vector<std::string>& operators) {
+    std::set<std::string, std::less<>> extra_operators(operators.begin(), operators.end());
+    // pieces start at a definition at the start of a line, which begins a lexeme unless the line
+    // before ends inside a string or ( ) comment; that is only known once the previous piece is lexed
+    std::vector<size_t> starts = {0};
+    size_t definition = 0;
+    while (WorkStealingPool::Shared().Threads() > 0 && input.size() - starts.back() > 2 * kPieceBytes) {
+        definition = input.find("\n: ", std::max(definition + 1, starts.back() + kPieceBytes));
+        if (definition == std::string_view::npos) {
+            break;
         }
-        current_node = current_node->go[c].get();
+        starts.push_back(definition + 1);
     }
-    current_node->is_terminal = true;
-}
-
-bool Parser::Trie::Contains(std::string str) {
-    Node* current_node = root.get();
-    for (auto c : str) {
-        if (current_node->go.find(c) == current_node->go.end()) {
-            return false;
+    starts.push_back(input.size());
+    std::vector<Piece> pieces(starts.size() - 1);
+    WorkStealingPool::Shared().Run(pieces.size(), [&](size_t i) {
+        Lex(input.substr(starts[i], starts[i + 1] - starts[i]), extra_operators, pieces[i]);
+    });
+    for (size_t i = 0; i + 1 < pieces.size(); ++i) {
+        if (pieces[i].state != State::kBetween) {
+            pieces.assign(1, Piece());
+            Lex(input, extra_operators, pieces[0]);
+            break;
         }
-        current_node = current_node->go[c].get();
     }
-    return current_node->is_terminal;
+    // a \ comment ends with its line, a lexeme with the input
+    ends_inside = pieces.back().state == State::kString || pieces.back().state == State::kParenComment;
+    if (pieces.size() == 1) {
+        result = std::move(pieces[0].lexemes);
+        stack_comments = std::move(pieces[0].stack_comments);
+        return;
+    }
+    std::vector<size_t> first_lexeme(pieces.size() + 1, 0);
+    std::vector<int> first_line(pieces.size(), 1);
+    for (size_t i = 0; i < pieces.size(); ++i) {
+        first_lexeme[i + 1] = first_lexeme[i] + pieces[i].lexemes.size();
+        if (i + 1 < pieces.size()) {
+            first_line[i + 1] = first_line[i] + pieces[i].lines - 1;
+        }
+        // a later stack comment of the same word replaces an earlier one
+        for (auto& [name, comment] : pieces[i].stack_comments) {
+            stack_comments.insert_or_assign(name, std::move(comment));
+        }
+    }
+    result.resize(first_lexeme.back());
+    WorkStealingPool::Shared().Run(pieces.size(), [&](size_t i) {
+        auto out = result.begin() + static_cast<ptrdiff_t>(first_lexeme[i]);
+        for (auto& lexeme : pieces[i].lexemes) {
+            lexeme.row += first_line[i] - 1;
+            *out++ = lexeme;
+        }
+    });
 }
-
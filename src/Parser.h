@@ -6,8 +6,8 @@
 #ifndef PARSER_H
 #define PARSER_H
 
-#include <memory>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <map>
 #include "Lexeme.h"
@@ -15,59 +15,46 @@
 /**
  * @class Parser
  * @brief Performs lexical analysis of input strings, producing a vector of lexemes.
+ *
+ * Comments are stripped in the same pass over the input: their characters separate lexemes like
+ * spaces do. Inside an unterminated s" string they are part of the string. The input is classified
+ * by the SourceScanner in blocks, so only characters that can start or end a lexeme or comment are
+ * looked at one by one. Keywords and builtin operators are found with the perfect hash of Builtins.
+ * Large inputs are split before definitions that start a line and the pieces are lexed on the
+ * WorkStealingPool; if a piece turns out to end inside a string or comment, the input is lexed
+ * again in one pass. The lexemes point into the input, which must outlive them.
  */
 class Parser {
 public:
     /**
      * @brief Constructs a Parser instance.
-     * @param input The input string to parse.
-     * @param keywords A list of keywords to recognize.
-     * @param operators A list of operators to recognize.
+     * @param input The source text to parse, comments included.
+     * @param operators Words to recognize as operators besides the Builtins, such as native words.
      */
-    explicit Parser(const std::string& input,
-                    const std::vector<std::string>& keywords,
-                    const std::vector<std::string>& operators);
+    explicit Parser(std::string_view input, const std::vector<std::string>& operators = {});
 
     /**
      * @brief Retrieves the result of the parsing operation.
      * @return A vector of lexemes generated from the input string.
      */
-    std::vector<Lexeme> GetResult();
+    const std::vector<Lexeme>& GetResult() const;
 
-private:
     /**
-     * @struct Trie
-     * @brief A simple trie structure for keyword and operator matching.
-     *
-     * While its use in this project is debatable, it is implemented for demonstration purposes.
+     * @brief Retrieves the comments right after ": name" that contain "--", such as "( a b -- c )".
+     * @return The comments, including their parentheses, by the name of the word.
      */
-    struct Trie {
-        /**
-         * @struct Node
-         * @brief Represents a single node in the Trie.
-         */
-        struct Node {
-            bool is_terminal = false; ///< Indicates whether this node represents the end of a valid string.
-            std::map<char, std::unique_ptr<Node>> go; ///< Map of child nodes indexed by characters.
-        };
-
-        std::unique_ptr<Node> root = std::make_unique<Node>(); ///< The root node of the Trie.
-
-        /**
-         * @brief Adds a string to the Trie.
-         * @param str The string to add.
-         */
-        void Add(std::string str);
+    const std::map<std::string, std::string>& GetStackComments() const;
 
-        /**
-         * @brief Checks if a string exists in the Trie.
-         * @param str The string to check.
-         * @return True if the string exists, false otherwise.
-         */
-        bool Contains(std::string str);
-    };
+    /**
+     * @brief Tells whether the input stops inside a ( ) comment or an s" string, which more input could close.
+     * @return True if the input ends inside a comment or string.
+     */
+    bool EndsInsideCommentOrString() const;
 
+private:
     std::vector<Lexeme> result; ///< Stores the parsed lexemes.
+    std::map<std::string, std::string> stack_comments; ///< Stack comments of the words, by name.
+    bool ends_inside = false; ///< Whether the input ends inside a ( ) comment or s" string.
 };
 
 #endif // PARSER_H
@@ -0,0 +1,119 @@
+#include "Peephole.h"
+
+const std::vector<FusionRule> PeepholeOptimizer::rules = {
+    {"dup *", {{Opcode::kBuiltin, "dup"}, {Opcode::kBuiltin, "*"}}, Opcode::kDupMultiply, 0},
+    {"over over", {{Opcode::kBuiltin, "over"}, {Opcode::kBuiltin, "over"}}, Opcode::kOverOver, 0},
+    {"swap drop", {{Opcode::kBuiltin, "swap"}, {Opcode::kBuiltin, "drop"}}, Opcode::kNip, 0},
+    {"literal +", {{Opcode::kPushConstant, ""}, {Opcode::kBuiltin, "+"}}, Opcode::kAddConstant, 0},
+    {"literal -", {{Opcode::kPushConstant, ""}, {Opcode::kBuiltin, "-"}}, Opcode::kSubtractConstant, 0},
+    {"literal *", {{Opcode::kPushConstant, ""}, {Opcode::kBuiltin, "*"}}, Opcode::kMultiplyConstant, 0},
+    {"literal <", {{Opcode::kPushConstant, ""}, {Opcode::kBuiltin, "<"}}, Opcode::kLessConstant, 0},
+    {"literal >", {{Opcode::kPushConstant, ""}, {Opcode::kBuiltin, ">"}}, Opcode::kGreaterConstant, 0},
+    {"literal =", {{Opcode::kPushConstant, ""}, {Opcode::kBuiltin, "="}}, Opcode::kEqualsConstant, 0},
+    {"variable @", {{Opcode::kPushVariable, ""}, {Opcode::kBuiltin, "@"}}, Opcode::kFetchVariable, 0},
+    {"< IF", {{Opcode::kBuiltin, "<"}, {Opcode::kJumpIfFalse, ""}}, Opcode::kJumpIfNotLess, 1},
+    {"<= IF", {{Opcode::kBuiltin, "<="}, {Opcode::kJumpIfFalse, ""}}, Opcode::kJumpIfNotLessEqual, 1},
+    {"> IF", {{Opcode::kBuiltin, ">"}, {Opcode::kJumpIfFalse, ""}}, Opcode::kJumpIfNotGreater, 1},
+    {">= IF", {{Opcode::kBuiltin, ">="}, {Opcode::kJumpIfFalse, ""}}, Opcode::kJumpIfNotGreaterEqual, 1},
+    {"= IF", {{Opcode::kBuiltin, "="}, {Opcode::kJumpIfFalse, ""}}, Opcode::kJumpIfNotEqual, 1},
+};
+
+void PeepholeOptimizer::Optimize(BytecodeProgram& program) {
+    const auto& code = program.code;
+    std::vector<bool> is_target(code.size() + 1, false);
+    for (size_t address = 0; address < code.size(); ++address) {
+        if (IsBranch(code[address].opcode)) {
+            is_target[address + code[address].operand] = true;
+        }
+        if (code[address].opcode == Opcode::kSwitch) {
+            for (const auto& [selector, offset] : program.switches[code[address].operand]) {
+                is_target[address + offset] = true;
+            }
+        }
+    }
+    for (const auto& [name, entry] : program.entries) {
+        is_target[entry] = true;
+    }
+
+    std::vector<Instruction> optimized;
+    std::vector<size_t> new_address(code.size() + 1);
+    std::vector<size_t> operand_source; // old address of the instruction each new one took its operand from
+    for (size_t address = 0; address < code.size();) {
+        new_address[address] = optimized.size();
+        const FusionRule* match = nullptr;
+        for (const auto& rule : rules) {
+            if (Matches(program, rule, address, is_target)) {
+                match = &rule;
+                break;
+            }
+        }
+        if (!match) {
+            optimized.push_back(code[address]);
+            operand_source.push_back(address);
+            ++address;
+            continue;
+        }
+        Instruction fused;
+        fused.opcode = match->fused;
+        fused.operand = code[address + match->operand_from].operand;
+        optimized.push_back(fused);
+        operand_source.push_back(address + match->operand_from);
+        for (size_t i = 1; i < match->pattern.size(); ++i) {
+            new_address[address + i] = optimized.size() - 1;
+        }
+        fired_[match->name]++;
+        address += match->pattern.size();
+    }
+    new_address[code.size()] = optimized.size();
+
+    for (size_t address = 0; address < optimized.size(); ++address) {
+        auto& instruction = optimized[address];
+        auto source = operand_source[address];
+        if (IsBranch(instruction.opcode)) {
+            instruction.operand = static_cast<int32_t>(new_address[source + instruction.operand] - address);
+        }
+        if (instruction.opcode == Opcode::kSwitch) {
+            for (auto& [selector, offset] : program.switches[instruction.operand]) {
+                offset = static_cast<int32_t>(new_address[source + offset] - address);
+            }
+        }
+    }
+    for (auto& [name, entry] : program.entries) {
+        entry = static_cast<int32_t>(new_address[entry]);
+    }
+    program.code = std::move(optimized);
+}
+
+void PeepholeOptimizer::Report(std::ostream& out) const {
+    int total = 0;
+    for (const auto& rule : rules) {
+        auto fired = fired_.find(rule.name);
+        if (fired != fired_.end()) {
+            out << rule.name << ": " << fired->second << "\n";
+            total += fired->second;
+        }
+    }
+    out << "fusions: " << total << "\n";
+}
+
+bool PeepholeOptimizer::Matches(const BytecodeProgram& program, const FusionRule& rule, size_t address,
+                                const std::vector<bool>& is_target) const {
+    if (address + rule.pattern.size() > program.code.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < rule.pattern.size(); ++i) {
+        const auto& instruction = program.code[address + i];
+        const auto& step = rule.pattern[i];
+        if (instruction.opcode != step.opcode || (i > 0 && is_target[address + i])) {
+            return false;
+        }
+        if (step.opcode == Opcode::kBuiltin) {
+            const auto& descriptor = Operator::GetBuiltin(step.builtin);
+            auto builtin = program.builtins[instruction.operand];
+            if (builtin != descriptor.checked && builtin != descriptor.unchecked) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
@@ -0,0 +1,74 @@
+/**
+ * @file Peephole.h
+ * @brief Defines the PeepholeOptimizer fusing common instruction sequences into superinstructions.
+ */
+
+#ifndef PEEPHOLE_H
+#define PEEPHOLE_H
+
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "Bytecode.h"
+
+/**
+ * @struct FusionRule
+ * @brief A sequence of instructions and the superinstruction replacing it.
+ */
+struct FusionRule {
+    /**
+     * @brief One instruction of a pattern.
+     */
+    struct Step {
+        Opcode opcode;       ///< The operation code to match.
+        std::string builtin; ///< For kBuiltin, the name of the builtin to match.
+    };
+
+    std::string name;         ///< Name of the rule used in the fusion report.
+    std::vector<Step> pattern; ///< The instructions to match.
+    Opcode fused;             ///< The superinstruction replacing them.
+    size_t operand_from;      ///< Index of the pattern instruction whose operand the superinstruction keeps.
+};
+
+/**
+ * @class PeepholeOptimizer
+ * @brief Replaces instruction sequences listed in the fusion table with superinstructions.
+ *
+ * A sequence is only fused if no branch lands inside it. The code is compacted afterwards
+ * and all branch offsets, switch tables and word entries are relocated.
+ */
+class PeepholeOptimizer {
+public:
+    /**
+     * @brief Fuses all matching sequences of the program.
+     * @param program The program to optimize in place.
+     */
+    void Optimize(BytecodeProgram& program);
+
+    /**
+     * @brief Prints how many times each rule fired.
+     * @param out The stream to print to.
+     */
+    void Report(std::ostream& out) const;
+
+    /**
+     * @brief The fusion table, longer patterns first.
+     */
+    static const std::vector<FusionRule> rules;
+
+private:
+    /**
+     * @brief Checks whether a rule matches the code at the given address.
+     * @param program The program being optimized.
+     * @param rule The rule to match.
+     * @param address The address of the first instruction.
+     * @param is_target Whether a branch lands on each address; such instructions may only start a sequence.
+     */
+    bool Matches(const BytecodeProgram& program, const FusionRule& rule, size_t address,
+                 const std::vector<bool>& is_target) const;
+
+    std::map<std::string, int> fired_; ///< Number of fusions per rule name.
+};
+
+#endif //PEEPHOLE_H
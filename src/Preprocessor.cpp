@@ -1,59 +1,15 @@
 #include "Preprocessor.h"
-#include <fstream>
-#include <stdexcept>
-#include <algorithm>
+#include <utility>
 
-Preprocessor::Preprocessor(std::string file_path) {
-    std::ifstream code_file(file_path);
-    if (!code_file.is_open()) {
-        throw std::logic_error("failed to open file for preprocessing");
-    }
-    std::string line;
-    while (std::getline(code_file, line)) {
-        line += '\n';
-        current_text += line;
-    }
+Preprocessor::Preprocessor(const std::string& file_path) : file(std::make_unique<MappedFile>(file_path)) {
 }
 
-std::string Preprocessor::GetCurrentText() {
-    return current_text;
+Preprocessor Preprocessor::FromText(std::string text) {
+    Preprocessor preprocessor;
+    preprocessor.text = std::move(text);
+    return preprocessor;
 }
 
-void Preprocessor::ToOneLine() {
-    std::replace_if(current_text.begin(), current_text.end(), [](auto c) {
-        return static_cast<int>(c) < 32;
-    }, ' ');
+std::string_view Preprocessor::GetText() const {
+    return file ? file->text() : std::string_view(text);
 }
-
-void Preprocessor::RemoveComments() {
-    // braces are for comments in forth
-    // so if character is inside at least one pair of braces or goes after \ in line it is irrevelant
-    int balance = 0;
-    bool slash_comment = false;
-    std::string result;
-    for (auto c : current_text) {
-        if (c == '\\') {
-            slash_comment = true;
-        }
-        if (c == '\n') {
-            slash_comment = false;
-        }
-        if (c == '(') {
-            balance++;
-        }
-        if ((balance == 0 && !slash_comment) || c == '\n') {
-            result += c;
-        } else {
-            result += ' ';
-        }
-        if (c == ')') {
-            balance--;
-        }
-    }
-
-    current_text = result;
-}
-
-
-
-
@@ -1,21 +1,26 @@
+
 #ifndef PREPROCESSOR_H
 #define PREPROCESSOR_H
+#include <memory>
 #include <string>
+#include <string_view>
+#include "MappedFile.h"
 
 
 class Preprocessor {
 public:
-    explicit Preprocessor(std::string file_path);
-    std::string GetCurrentText();
-    void ToOneLine(); // transform file to one line for easier parsing
-    void RemoveComments();
+    explicit Preprocessor(const std::string& file_path); // maps the file instead of reading it
+    static Preprocessor FromText(std::string text); // source held in memory instead of a file
+    std::string_view GetText() const; // comments are stripped by the Parser while it tokenizes the text
 private:
+    Preprocessor() = default;
 
 public:
 
 
 private:
-    std::string current_text;
+    std::unique_ptr<MappedFile> file;
+    std::string text;
 
 };
 
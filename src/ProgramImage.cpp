@@ -0,0 +1,322 @@
+#include "ProgramImage.h"
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include "Builtins.h"
+#include "MappedFile.h"
+
+namespace {
+
+// Appends values to an image file in the byte order of the machine.
+class ImageWriter {
+public:
+    explicit ImageWriter(std::ostream& out) : out_(out) {
+    }
+
+    template<typename T>
+    void Put(T value) {
+        static_assert(std::is_arithmetic_v<T> || std::is_enum_v<T>);
+        out_.write(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    void PutString(const std::string& text) {
+        Put<uint64_t>(text.size());
+        out_.write(text.data(), static_cast<std::streamsize>(text.size()));
+    }
+
+    void PutEffect(const StackEffect& effect) {
+        Put(effect.inputs);
+        Put(effect.outputs);
+        Put(effect.peak);
+        Put<uint8_t>(effect.known);
+    }
+
+private:
+    std::ostream& out_;
+};
+
+// Reads values back from a mapped image file, checking every read against its end.
+class ImageReader {
+public:
+    ImageReader(const char* begin, const char* end) : position_(begin), end_(end) {
+    }
+
+    template<typename T>
+    T Get() {
+        static_assert(std::is_arithmetic_v<T> || std::is_enum_v<T>);
+        T value;
+        std::memcpy(&value, Take(sizeof(value)), sizeof(value));
+        return value;
+    }
+
+    std::string GetString() {
+        auto size = Get<uint64_t>();
+        return std::string(Take(size), size);
+    }
+
+    StackEffect GetEffect() {
+        StackEffect effect;
+        effect.inputs = Get<int64_t>();
+        effect.outputs = Get<int64_t>();
+        effect.peak = Get<int64_t>();
+        effect.known = Get<uint8_t>() != 0;
+        return effect;
+    }
+
+    // Returns the number of records of a table, each of which takes at least one byte.
+    size_t GetCount() {
+        auto count = Get<uint64_t>();
+        if (count > static_cast<uint64_t>(end_ - position_)) {
+            throw std::runtime_error("Image file is truncated");
+        }
+        return count;
+    }
+
+private:
+    const char* Take(size_t bytes) {
+        if (bytes > static_cast<size_t>(end_ - position_)) {
+            throw std::runtime_error("Image file is truncated");
+        }
+        auto result = position_;
+        position_ += bytes;
+        return result;
+    }
+
+    const char* position_;
+    const char* end_;
+};
+
+// Checks that an operand indexes a table of the given size.
+void CheckIndex(int32_t operand, size_t size) {
+    if (operand < 0 || static_cast<size_t>(operand) >= size) {
+        throw std::runtime_error("Image file is corrupted");
+    }
+}
+
+} // namespace
+
+void ProgramImage::Write(const Environment& definitions, const BytecodeProgram& program,
+                         const std::string& file_path) {
+    std::map<Operator::Builtin, std::pair<std::string, bool>> builtin_names;
+    for (const auto& word : Builtins::kWords) {
+        if (auto descriptor = Operator::FindBuiltin(word.name)) {
+            builtin_names.try_emplace(descriptor->unchecked, word.name, true);
+            builtin_names[descriptor->checked] = {std::string(word.name), false};
+        }
+    }
+    std::vector<const VariableCreation*> variable_creations;
+    for (auto node : program.nodes) {
+        auto creation = dynamic_cast<const VariableCreation*>(node);
+        if (creation == nullptr) {
+            throw std::runtime_error("Programs with PDO loops or native words cannot be saved as an image");
+        }
+        variable_creations.push_back(creation);
+    }
+
+    std::ofstream out(file_path, std::ios::binary);
+    if (!out.is_open()) {
+        throw std::runtime_error("failed to create image " + file_path);
+    }
+    ImageWriter writer(out);
+    out.write(kMagic, sizeof(kMagic));
+    writer.Put(kVersion);
+    writer.Put(static_cast<uint32_t>(Opcode::kOpcodeCount));
+    writer.Put<uint64_t>(definitions.data_space.Here());
+    writer.Put<uint8_t>(definitions.data_space.UsesHugePages());
+
+    writer.Put<uint64_t>(definitions.variables.size());
+    for (const auto& [name, slot] : definitions.variables) {
+        writer.PutString(name);
+        writer.Put<uint64_t>(slot);
+    }
+    writer.Put<uint64_t>(definitions.word_effects.size());
+    for (const auto& [name, effect] : definitions.word_effects) {
+        writer.PutString(name);
+        writer.PutEffect(effect);
+    }
+    writer.Put<uint64_t>(program.entries.size());
+    for (const auto& [name, entry] : program.entries) {
+        writer.PutString(name);
+        writer.Put(entry);
+    }
+    writer.Put<uint64_t>(program.builtins.size());
+    for (auto builtin : program.builtins) {
+        const auto& [name, unchecked] = builtin_names.at(builtin);
+        writer.PutString(name);
+        writer.Put<uint8_t>(unchecked);
+    }
+    writer.Put<uint64_t>(program.constants.size());
+    for (const auto& constant : program.constants) {
+        writer.Put(constant.cell.integer);
+        writer.Put(constant.type);
+    }
+    writer.Put<uint64_t>(program.strings.size());
+    for (const auto& text : program.strings) {
+        writer.PutString(text);
+    }
+    writer.Put<uint64_t>(variable_creations.size());
+    for (auto creation : variable_creations) {
+        writer.PutString(creation->name);
+        writer.Put(creation->size);
+        writer.PutString(creation->type);
+        writer.Put<uint64_t>(creation->offset);
+        writer.Put<uint64_t>(creation->slot);
+    }
+    writer.Put<uint64_t>(program.effects.size());
+    for (const auto& effect : program.effects) {
+        writer.PutEffect(effect);
+    }
+    writer.Put<uint64_t>(program.switches.size());
+    for (const auto& cases : program.switches) {
+        writer.Put<uint64_t>(cases.size());
+        for (const auto& [selector, target] : cases) {
+            writer.Put(selector);
+            writer.Put(target);
+        }
+    }
+    writer.Put<uint64_t>(program.code.size());
+    for (const auto& instruction : program.code) {
+        writer.Put(instruction.opcode);
+        writer.Put(instruction.operand);
+    }
+    if (!out) {
+        throw std::runtime_error("failed to write image " + file_path);
+    }
+}
+
+ProgramImage ProgramImage::Read(const std::string& file_path) {
+    MappedFile file(file_path);
+    if (static_cast<size_t>(file.end() - file.begin()) < sizeof(kMagic) ||
+        std::memcmp(file.begin(), kMagic, sizeof(kMagic)) != 0) {
+        throw std::runtime_error(file_path + " is not a program image");
+    }
+    ImageReader reader(file.begin() + sizeof(kMagic), file.end());
+    if (reader.Get<uint32_t>() != kVersion || reader.Get<uint32_t>() != static_cast<uint32_t>(Opcode::kOpcodeCount)) {
+        throw std::runtime_error(file_path + " was saved by another version of the interpreter");
+    }
+    ProgramImage image;
+    image.definitions = std::make_shared<Environment>();
+    auto& definitions = *image.definitions;
+    auto& program = image.program;
+    auto data_space_bytes = reader.Get<uint64_t>();
+    definitions.data_space.UseHugePages(reader.Get<uint8_t>() != 0);
+    if (data_space_bytes > 0) {
+        definitions.data_space.Allot(data_space_bytes);
+    }
+
+    for (size_t count = reader.GetCount(); count > 0; --count) {
+        auto name = reader.GetString();
+        definitions.variables[name] = reader.Get<uint64_t>();
+    }
+    definitions.slots.resize(definitions.variables.size(), nullptr);
+    for (size_t count = reader.GetCount(); count > 0; --count) {
+        auto name = reader.GetString();
+        definitions.word_effects[name] = reader.GetEffect();
+    }
+    for (size_t count = reader.GetCount(); count > 0; --count) {
+        auto name = reader.GetString();
+        program.entries[name] = reader.Get<int32_t>();
+    }
+    for (size_t count = reader.GetCount(); count > 0; --count) {
+        auto name = reader.GetString();
+        auto builtin = Operator::FindBuiltin(name);
+        if (builtin == nullptr) {
+            throw std::runtime_error("Image uses unknown builtin '" + name + "'");
+        }
+        program.builtins.push_back(reader.Get<uint8_t>() ? builtin->unchecked : builtin->checked);
+    }
+    for (size_t count = reader.GetCount(); count > 0; --count) {
+        auto value = reader.Get<int64_t>();
+        auto type = reader.Get<StackElement::Type>();
+        auto& constant = program.constants.emplace_back(value);
+        constant.type = type;
+    }
+    for (size_t count = reader.GetCount(); count > 0; --count) {
+        program.strings.push_back(reader.GetString());
+    }
+    // the nodes executed by kExecute are owned by the main code of the loaded environment
+    std::shared_ptr<Codeblock> creations(new Codeblock);
+    for (size_t count = reader.GetCount(); count > 0; --count) {
+        std::shared_ptr<VariableCreation> creation(new VariableCreation);
+        creation->name = reader.GetString();
+        creation->size = reader.Get<int64_t>();
+        creation->type = reader.GetString();
+        creation->offset = reader.Get<uint64_t>();
+        creation->slot = reader.Get<uint64_t>();
+        if (creation->slot >= definitions.slots.size() || creation->offset > data_space_bytes) {
+            throw std::runtime_error("Image file is corrupted");
+        }
+        program.nodes.push_back(creation.get());
+        creations->statements.push_back(std::move(creation));
+    }
+    definitions.code = creations;
+    for (size_t count = reader.GetCount(); count > 0; --count) {
+        program.effects.push_back(reader.GetEffect());
+    }
+    for (size_t count = reader.GetCount(); count > 0; --count) {
+        auto& cases = program.switches.emplace_back();
+        for (size_t size = reader.GetCount(); size > 0; --size) {
+            auto selector = reader.Get<int64_t>();
+            cases[selector] = reader.Get<int32_t>();
+        }
+    }
+    program.code.resize(reader.GetCount());
+    for (auto& instruction : program.code) {
+        instruction.opcode = reader.Get<Opcode>();
+        instruction.operand = reader.Get<int32_t>();
+    }
+
+    // a damaged image must not make the machine jump or index out of its tables
+    auto code_size = static_cast<int64_t>(program.code.size());
+    for (int64_t address = 0; address < code_size; ++address) {
+        const auto& instruction = program.code[address];
+        auto opcode = instruction.opcode;
+        if (opcode < Opcode::kHalt || opcode >= Opcode::kOpcodeCount) {
+            throw std::runtime_error("Image file is corrupted");
+        }
+        if (IsBranch(opcode)) {
+            CheckIndex(static_cast<int32_t>(address + instruction.operand), program.code.size());
+        }
+        switch (opcode) {
+            case Opcode::kBuiltin:
+                CheckIndex(instruction.operand, program.builtins.size());
+                break;
+            case Opcode::kPushConstant:
+            case Opcode::kAddConstant:
+            case Opcode::kSubtractConstant:
+            case Opcode::kMultiplyConstant:
+            case Opcode::kLessConstant:
+            case Opcode::kGreaterConstant:
+            case Opcode::kEqualsConstant:
+                CheckIndex(instruction.operand, program.constants.size());
+                break;
+            case Opcode::kPushString:
+                CheckIndex(instruction.operand, program.strings.size());
+                break;
+            case Opcode::kPushVariable:
+            case Opcode::kFetchVariable:
+                CheckIndex(instruction.operand, definitions.slots.size());
+                break;
+            case Opcode::kExecute:
+                CheckIndex(instruction.operand, program.nodes.size());
+                break;
+            case Opcode::kRequire:
+                CheckIndex(instruction.operand, program.effects.size());
+                break;
+            case Opcode::kSwitch:
+                CheckIndex(instruction.operand, program.switches.size());
+                for (const auto& [selector, target] : program.switches[instruction.operand]) {
+                    CheckIndex(static_cast<int32_t>(address + target), program.code.size());
+                }
+                break;
+            default:
+                break;
+        }
+    }
+    for (const auto& [name, entry] : program.entries) {
+        CheckIndex(entry, program.code.size());
+    }
+    return image;
+}
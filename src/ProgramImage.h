@@ -0,0 +1,56 @@
+/**
+ * @file ProgramImage.h
+ * @brief Defines the ProgramImage structure saving compiled programs to files and loading them back.
+ */
+
+#ifndef PROGRAMIMAGE_H
+#define PROGRAMIMAGE_H
+
+#include <memory>
+#include <string>
+#include "Bytecode.h"
+#include "Environment.h"
+
+/**
+ * @struct ProgramImage
+ * @brief A compiled program as stored in an image file.
+ *
+ * The file holds the bytecode with all its tables, the entry address and stack effect of every word,
+ * the variables and the size of the data space, so a program loaded from it runs without the
+ * front end. Builtins are stored by name and bound again on loading; everything else is copied
+ * from the mapped file as is. Programs whose bytecode executes tree nodes other than variable
+ * creation, that is PDO loops and native words, cannot be saved.
+ */
+struct ProgramImage {
+    std::shared_ptr<Environment> definitions; ///< Variables, word effects and data space layout; without words or main code.
+    BytecodeProgram program;                  ///< The bytecode, ready for a VirtualMachine.
+
+    /**
+     * @brief Writes a compiled program to an image file.
+     * @param definitions The environment the program was compiled from.
+     * @param program The bytecode of the program.
+     * @param file_path The path of the image file.
+     * @throws std::runtime_error If the program cannot be saved or the file cannot be written.
+     */
+    static void Write(const Environment& definitions, const BytecodeProgram& program, const std::string& file_path);
+
+    /**
+     * @brief Maps an image file and loads the program in it.
+     * @param file_path The path of the image file.
+     * @return The loaded program.
+     * @throws std::runtime_error If the file cannot be read or is not a valid image.
+     */
+    static ProgramImage Read(const std::string& file_path);
+
+    /**
+     * @brief The first bytes of every image file.
+     */
+    static constexpr char kMagic[8] = {'F', 'O', 'R', 'T', 'H', 'I', 'M', 'G'};
+
+    /**
+     * @brief The version of the format, increased whenever the layout or the opcodes change.
+     */
+    static constexpr uint32_t kVersion = 1;
+};
+
+#endif //PROGRAMIMAGE_H
@@ -0,0 +1,72 @@
+#include "Repl.h"
+#include <stdexcept>
+#include <vector>
+#include "Executable.h"
+#include "Linker.h"
+#include "Preprocessor.h"
+#include "Scheduler.h"
+
+Repl::Repl(const Compiler& compiler) : compiler_(compiler), analyzer_(Compiler::kCodeBlockEnders) {
+    auto& environment = analyzer_.resulting_environment;
+    environment.native_words = compiler.native_words();
+    environment.data_space.UseHugePages(compiler.options().use_huge_pages);
+}
+
+bool Repl::Execute(const std::string& line) {
+    pending_ += line;
+    pending_ += '\n';
+    std::vector<std::string> words;
+    std::shared_ptr<Executable> code;
+    try {
+        auto parser = compiler_.Lex(pending_);
+        if (parser.EndsInsideCommentOrString()) {
+            return false;
+        }
+        code = analyzer_.AnalyzeMore(parser.GetResult(), words);
+    } catch (std::exception&) {
+        pending_.clear();
+        throw;
+    }
+    if (!code) {
+        return false;
+    }
+    pending_.clear();
+    auto& environment = analyzer_.resulting_environment;
+    Linker linker;
+    for (const auto& word : words) {
+        linker.Link(environment, *environment.functions.at(word));
+    }
+    linker.Link(environment, *code);
+    try {
+        code->Execute(environment);
+        Scheduler::Shared().Run();
+    } catch (std::exception&) {
+        // the stack stays as the failed input left it, but no loop is running anymore
+        environment.loops.clear();
+        environment.return_stack.clear();
+        throw;
+    }
+    return true;
+}
+
+void Repl::Load(const std::string& file_path) {
+    if (!Execute(std::string(Preprocessor(file_path).GetText()))) {
+        pending_.clear();
+        throw std::runtime_error(file_path + " ends inside a definition, control structure, comment or string");
+    }
+}
+
+void Repl::Run(std::istream& input, std::ostream& output) {
+    std::string line;
+    while (std::getline(input, line)) {
+        try {
+            if (Execute(line)) {
+                output << " ok\n";
+            }
+        } catch (std::exception& e) {
+            std::string message = e.what();
+            output << message << (message.ends_with('\n') ? "" : "\n");
+        }
+        output.flush();
+    }
+}
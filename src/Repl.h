@@ -0,0 +1,67 @@
+/**
+ * @file Repl.h
+ * @brief Defines the Repl class compiling and running input line by line.
+ */
+
+#ifndef REPL_H
+#define REPL_H
+
+#include <istream>
+#include <ostream>
+#include <string>
+#include "Compiler.h"
+#include "Environment.h"
+#include "GrammaticalAnalyzer.h"
+
+/**
+ * @class Repl
+ * @brief An interactive session keeping its words, variables and stack between inputs.
+ *
+ * Every input is lexed, analyzed and linked on its own against the words defined so far, and
+ * its main code runs on the tree right away, so the cost of an input does not depend on how
+ * much was loaded before it. Words defined in the session are not inlined or compiled to bytecode.
+ */
+class Repl {
+public:
+    /**
+     * @brief Starts a session with the builtins and native words of the compiler.
+     * @param compiler The compiler whose native words and huge page setting the session uses.
+     */
+    explicit Repl(const Compiler& compiler);
+
+    /**
+     * @brief Analyzes and runs one line of input.
+     * @param line The line.
+     * @return False if the input so far ends inside a definition, control structure, ( ) comment or s"
+     * string, which later lines complete.
+     * @throws std::runtime_error On syntax and runtime errors; the definitions of the failed input are dropped.
+     */
+    bool Execute(const std::string& line);
+
+    /**
+     * @brief Analyzes and runs a whole file, such as a library to work with.
+     * @param file_path The path of the Forth source.
+     */
+    void Load(const std::string& file_path);
+
+    /**
+     * @brief Reads lines until the end of the input, printing "ok" after every completed one and the errors.
+     * @param input The stream to read lines from.
+     * @param output The stream to print to.
+     */
+    void Run(std::istream& input, std::ostream& output);
+
+    /**
+     * @brief Returns the environment of the session, holding its words, variables and stack.
+     */
+    Environment& environment() {
+        return analyzer_.resulting_environment;
+    }
+
+private:
+    Compiler compiler_;             ///< Lexes the input with the native words of the session.
+    GrammaticalAnalyzer analyzer_;  ///< Knows the identifiers defined so far and holds the environment.
+    std::string pending_;           ///< Lines of a definition, control structure, comment or string not complete yet.
+};
+
+#endif //REPL_H
@@ -0,0 +1,178 @@
+#include "Scheduler.h"
+#include <algorithm>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+namespace {
+
+// The scheduler and queue of the current thread while it runs tasks, so that spawned tasks stay on its queue.
+thread_local Scheduler* current_scheduler = nullptr;
+thread_local size_t current_queue = 0;
+
+} // namespace
+
+Scheduler& Scheduler::Shared() {
+    static Scheduler scheduler;
+    return scheduler;
+}
+
+Scheduler& Scheduler::Of(const Environment& environment) {
+    if (current_scheduler != nullptr) {
+        return *current_scheduler;
+    }
+    return environment.scheduler ? *environment.scheduler : Shared();
+}
+
+std::unique_ptr<Scheduler::Task> Scheduler::NewTask(Environment& parent) {
+    auto count = parent.PopStack().Convert<int64_t>();
+    if (count < 0) {
+        throw std::runtime_error("SPAWN needs a non-negative number of arguments");
+    }
+    if (static_cast<uint64_t>(count) > parent.stack.size()) {
+        throw std::runtime_error("Zero elements on stack when popping it");
+    }
+    auto task = std::make_unique<Task>();
+    task->environment.slots = parent.slots;
+    size_t first = parent.stack.size() - static_cast<size_t>(count);
+    task->environment.stack.reserve(static_cast<size_t>(count));
+    for (size_t i = first; i < parent.stack.size(); ++i) {
+        task->environment.stack.push_back(parent.stack[i]);
+    }
+    while (parent.stack.size() > first) {
+        parent.stack.pop_back();
+    }
+    return task;
+}
+
+void Scheduler::SetThreads(size_t threads) {
+    threads_ = std::max<size_t>(threads, 1);
+}
+
+void Scheduler::Spawn(std::unique_ptr<Task> task) {
+    ++live_;
+    if (current_scheduler == this) {
+        Push(current_queue, std::move(task));
+        return;
+    }
+    {
+        std::lock_guard lock(mutex_);
+        if (queues_.empty()) {
+            queues_.push_back(std::make_unique<Queue>());
+        }
+    }
+    // outside of Run there is one queue, which Run spreads over the threads
+    Push(0, std::move(task));
+}
+
+void Scheduler::Run() {
+    if (live_ == 0) {
+        return;
+    }
+    size_t threads = threads_ != 0 ? threads_ : std::max(std::thread::hardware_concurrency(), 1u);
+    {
+        std::lock_guard lock(mutex_);
+        auto pending = std::move(queues_.front()->tasks);
+        queues_.clear();
+        for (size_t i = 0; i < threads; ++i) {
+            queues_.push_back(std::make_unique<Queue>());
+        }
+        for (size_t i = 0; i < pending.size(); ++i) {
+            queues_[i % threads]->tasks.push_back(std::move(pending[i]));
+        }
+    }
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < threads; ++i) {
+        workers.emplace_back(&Scheduler::Work, this, i);
+    }
+    Work(0);
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    std::lock_guard lock(mutex_);
+    queues_.resize(1);
+    failed_ = false;
+    if (auto error = std::exchange(error_, nullptr)) {
+        std::rethrow_exception(error);
+    }
+}
+
+std::unique_ptr<Scheduler::Task> Scheduler::Take(size_t home) {
+    for (size_t i = 0; i < queues_.size(); ++i) {
+        auto& queue = *queues_[(home + i) % queues_.size()];
+        std::unique_ptr<Task> task;
+        {
+            std::lock_guard lock(queue.mutex);
+            if (queue.tasks.empty()) {
+                continue;
+            }
+            // the own queue is served in order, so that paused tasks take turns; thieves take the newest task
+            if (i == 0) {
+                task = std::move(queue.tasks.front());
+                queue.tasks.pop_front();
+            } else {
+                task = std::move(queue.tasks.back());
+                queue.tasks.pop_back();
+            }
+            --queued_;
+        }
+        return task;
+    }
+    return nullptr;
+}
+
+void Scheduler::Push(size_t queue, std::unique_ptr<Task> task) {
+    {
+        std::lock_guard lock(queues_[queue]->mutex);
+        queues_[queue]->tasks.push_back(std::move(task));
+        ++queued_;
+    }
+    // a thread going to sleep counts itself before checking queued_, so one of both sees the other
+    if (sleeping_ > 0) {
+        std::lock_guard lock(mutex_);
+        wake_.notify_one();
+    }
+}
+
+void Scheduler::Work(size_t id) {
+    current_scheduler = this;
+    current_queue = id;
+    while (true) {
+        auto task = Take(id);
+        if (!task) {
+            std::unique_lock lock(mutex_);
+            ++sleeping_;
+            wake_.wait(lock, [&] {
+                return live_ == 0 || queued_ > 0;
+            });
+            --sleeping_;
+            if (live_ == 0) {
+                break;
+            }
+            continue;
+        }
+        bool finished = true;
+        if (!failed_) {
+            try {
+                finished = task->step(task->environment, task->resume);
+            } catch (...) {
+                std::lock_guard lock(mutex_);
+                if (!error_) {
+                    error_ = std::current_exception();
+                }
+                failed_ = true;
+            }
+        }
+        if (!finished) {
+            Push(id, std::move(task));
+            continue;
+        }
+        task.reset();
+        if (--live_ == 0) {
+            // taking the lock orders the decrement before the check of a thread about to wait
+            std::lock_guard lock(mutex_);
+            wake_.notify_all();
+        }
+    }
+    current_scheduler = nullptr;
+}
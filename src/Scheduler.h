@@ -0,0 +1,136 @@
+/**
+ * @file Scheduler.h
+ * @brief Defines the Scheduler class running lightweight Forth tasks on a few threads.
+ */
+
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "Environment.h"
+
+/**
+ * @class Scheduler
+ * @brief Multiplexes tasks started with SPAWN onto a fixed number of threads.
+ *
+ * Every task has an Environment of its own, so its data stack, return stack and DO LOOPs are
+ * separate from those of other tasks, while variables are shared. A task runs until it executes PAUSE
+ * or finishes; a paused task goes to the back of the queue of its thread. Each thread takes tasks
+ * from the front of its own queue and, when that is empty, steals from the back of another queue.
+ * Tasks start once the main code of the program has finished.
+ */
+class Scheduler {
+public:
+    /**
+     * @brief Runs a task until it pauses or finishes.
+     *
+     * The first call gets the resume value the task was spawned with; the step stores where to continue.
+     * Returns whether the task finished.
+     */
+    using Step = std::function<bool(Environment& environment, size_t& resume)>;
+
+    /**
+     * @struct Task
+     * @brief A lightweight thread of Forth execution.
+     */
+    struct Task {
+        Environment environment; ///< The stacks of the task.
+        size_t resume = 0;       ///< Where to continue, interpreted by step.
+        Step step;               ///< Runs the task until it pauses or finishes.
+    };
+
+    /**
+     * @brief Returns the scheduler of environments without one of their own.
+     *
+     * Only one thread at a time may use it.
+     */
+    static Scheduler& Shared();
+
+    /**
+     * @brief Returns the scheduler that tasks spawned by code running on an environment go to.
+     *
+     * That is the scheduler running the code if it is a task, else the scheduler of the environment
+     * or the shared one.
+     *
+     * @param environment The environment of the spawning code.
+     */
+    static Scheduler& Of(const Environment& environment);
+
+    /**
+     * @brief Creates a task for SPAWN, moving its arguments from the stack of the spawning code.
+     *
+     * Pops n and moves the n elements below it, keeping their order, to the stack of the task.
+     *
+     * @param parent The environment of the spawning code.
+     * @return The task, without a step yet.
+     * @throws std::runtime_error If n is negative or the stack holds fewer than n elements.
+     */
+    static std::unique_ptr<Task> NewTask(Environment& parent);
+
+    /**
+     * @brief Sets the number of threads Run uses; defaults to the number of hardware threads.
+     * @param threads The number of threads, at least 1.
+     */
+    void SetThreads(size_t threads);
+
+    /**
+     * @brief Queues a task; may be called from any thread, including from running tasks.
+     * @param task The task to run.
+     */
+    void Spawn(std::unique_ptr<Task> task);
+
+    /**
+     * @brief Runs all queued tasks and the tasks they spawn until every one has finished.
+     *
+     * The calling thread is one of the threads running tasks.
+     *
+     * @throws Whatever the first failing task threw; the remaining tasks are dropped.
+     */
+    void Run();
+
+private:
+    /**
+     * @brief The tasks of one thread, ready to run.
+     */
+    struct Queue {
+        std::mutex mutex;                        ///< Guards tasks.
+        std::deque<std::unique_ptr<Task>> tasks; ///< Next task to run first.
+    };
+
+    /**
+     * @brief Takes the next task of the given queue or steals one from another queue.
+     * @param home The queue of the calling thread.
+     * @return The task, or nullptr if all queues are empty.
+     */
+    std::unique_ptr<Task> Take(size_t home);
+
+    /**
+     * @brief Puts a task at the back of a queue and wakes an idle thread if there is one.
+     */
+    void Push(size_t queue, std::unique_ptr<Task> task);
+
+    /**
+     * @brief The loop of the thread owning queue number id.
+     */
+    void Work(size_t id);
+
+    size_t threads_ = 0;                         ///< Number of threads Run uses, 0 for one per hardware thread.
+    std::vector<std::unique_ptr<Queue>> queues_; ///< One queue per thread while Run is active, else at most one.
+    std::mutex mutex_;                           ///< Guards queues_ outside of Run, error_ and the waits of idle threads.
+    std::condition_variable wake_;               ///< Signalled when a task is queued or everything is done.
+    std::atomic<size_t> live_ = 0;               ///< Number of tasks not finished.
+    std::atomic<size_t> queued_ = 0;             ///< Number of tasks in all queues.
+    std::atomic<size_t> sleeping_ = 0;           ///< Number of threads waiting for tasks.
+    std::atomic<bool> failed_ = false;           ///< Set when a task threw; later tasks are dropped unrun.
+    std::exception_ptr error_;                   ///< What the first failing task threw.
+};
+
+#endif //SCHEDULER_H
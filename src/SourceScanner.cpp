@@ -0,0 +1,154 @@
+#include "SourceScanner.h"
+#include <algorithm>
+#include <cstring>
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+namespace {
+
+using Block = SourceScanner::Block;
+constexpr size_t kBlockSize = SourceScanner::kBlockSize;
+
+inline Block ClassifyScalar(const char* data) {
+    Block block;
+    for (size_t i = 0; i < kBlockSize; ++i) {
+        uint64_t bit = uint64_t(1) << i;
+        switch (data[i]) {
+            case '\n':
+                block.newline |= bit;
+                block.whitespace |= bit;
+                break;
+            case ' ':
+                block.whitespace |= bit;
+                break;
+            case '(':
+                block.open |= bit;
+                break;
+            case ')':
+                block.close |= bit;
+                break;
+            case '\\':
+                block.backslash |= bit;
+                break;
+            case '"':
+                block.quote |= bit;
+                break;
+            default:
+                break;
+        }
+    }
+    return block;
+}
+
+#if defined(__x86_64__)
+// The bytes of 16 equal to c, one bit each.
+inline uint64_t Matches(__m128i bytes, char c) {
+    return static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(c))));
+}
+
+inline Block ClassifySse(const char* data) {
+    Block block;
+    for (size_t i = 0; i < kBlockSize; i += 16) {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        uint64_t newline = Matches(bytes, '\n');
+        block.newline |= newline << i;
+        block.whitespace |= (newline | Matches(bytes, ' ')) << i;
+        block.open |= Matches(bytes, '(') << i;
+        block.close |= Matches(bytes, ')') << i;
+        block.backslash |= Matches(bytes, '\\') << i;
+        block.quote |= Matches(bytes, '"') << i;
+    }
+    return block;
+}
+
+// The bytes of 32 equal to c, one bit each.
+[[gnu::target("avx2")]] inline uint64_t Matches(__m256i bytes, char c) {
+    return static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(bytes, _mm256_set1_epi8(c))));
+}
+
+[[gnu::target("avx2")]] inline Block ClassifyAvx2(const char* data) {
+    Block block;
+    for (size_t i = 0; i < kBlockSize; i += 32) {
+        __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        uint64_t newline = Matches(bytes, '\n');
+        block.newline |= newline << i;
+        block.whitespace |= (newline | Matches(bytes, ' ')) << i;
+        block.open |= Matches(bytes, '(') << i;
+        block.close |= Matches(bytes, ')') << i;
+        block.backslash |= Matches(bytes, '\\') << i;
+        block.quote |= Matches(bytes, '"') << i;
+    }
+    return block;
+}
+
+void ClassifySse(const char* data, size_t count, Block* blocks) {
+    for (size_t i = 0; i < count; ++i) {
+        blocks[i] = ClassifySse(data + i * kBlockSize);
+    }
+}
+
+[[gnu::target("avx2")]] void ClassifyAvx2(const char* data, size_t count, Block* blocks) {
+    for (size_t i = 0; i < count; ++i) {
+        blocks[i] = ClassifyAvx2(data + i * kBlockSize);
+    }
+}
+#endif
+
+void ClassifyScalar(const char* data, size_t count, Block* blocks) {
+    for (size_t i = 0; i < count; ++i) {
+        blocks[i] = ClassifyScalar(data + i * kBlockSize);
+    }
+}
+
+// Classifies count whole blocks with the selected instruction set.
+void ClassifyBlocks(ArrayKernels::InstructionSet instruction_set, const char* data, size_t count, Block* blocks) {
+    switch (instruction_set) {
+#if defined(__x86_64__)
+        case ArrayKernels::InstructionSet::kAvx2:
+            ClassifyAvx2(data, count, blocks);
+            break;
+        case ArrayKernels::InstructionSet::kSse:
+            ClassifySse(data, count, blocks);
+            break;
+#endif
+        default:
+            ClassifyScalar(data, count, blocks);
+            break;
+    }
+}
+
+ArrayKernels::InstructionSet Detect() {
+#if defined(__x86_64__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return ArrayKernels::InstructionSet::kAvx2;
+    }
+    return ArrayKernels::InstructionSet::kSse;
+#else
+    return ArrayKernels::InstructionSet::kScalar;
+#endif
+}
+
+ArrayKernels::InstructionSet selected = Detect();
+
+} // namespace
+
+void SourceScanner::Classify(const char* data, size_t size, Block* blocks) {
+    size_t whole = size / kBlockSize;
+    ClassifyBlocks(selected, data, whole, blocks);
+    if (size % kBlockSize != 0) {
+        // the zero bytes of the padding belong to no class
+        char padded[kBlockSize] = {};
+        std::memcpy(padded, data + whole * kBlockSize, size % kBlockSize);
+        ClassifyBlocks(selected, padded, 1, blocks + whole);
+    }
+}
+
+ArrayKernels::InstructionSet SourceScanner::Selected() {
+    return selected;
+}
+
+void SourceScanner::Select(ArrayKernels::InstructionSet instruction_set) {
+    selected = std::min(instruction_set, Detect());
+}
@@ -0,0 +1,68 @@
+/**
+ * @file SourceScanner.h
+ * @brief Defines the SourceScanner class classifying source text 64 bytes at a time for the Parser.
+ */
+
+#ifndef SOURCESCANNER_H
+#define SOURCESCANNER_H
+
+#include <cstddef>
+#include <cstdint>
+#include "ArrayKernels.h"
+
+/**
+ * @class SourceScanner
+ * @brief Finds the characters that start or end lexemes and comments in blocks of source text.
+ *
+ * A block is classified into one bitmask per character class, bit i standing for byte i, so the
+ * Parser jumps from one interesting character to the next instead of branching on every byte.
+ * Blocks are classified with AVX2 or SSE2 compares on x86-64 and one byte at a time elsewhere;
+ * the instruction set is detected at runtime like the one of the ArrayKernels, and all of them
+ * give the same masks.
+ */
+class SourceScanner {
+public:
+    /**
+     * @brief The number of bytes classified at once.
+     */
+    static constexpr size_t kBlockSize = 64;
+
+    /**
+     * @struct Block
+     * @brief The characters of one block, by class.
+     */
+    struct Block {
+        uint64_t whitespace = 0; ///< Spaces and newlines, which separate lexemes.
+        uint64_t newline = 0;    ///< Newlines, which also end backslash comments.
+        uint64_t open = 0;       ///< '(' starting or nesting a comment.
+        uint64_t close = 0;      ///< ')' ending a comment.
+        uint64_t backslash = 0;  ///< '\' starting a comment up to the end of the line.
+        uint64_t quote = 0;      ///< '"' ending a s" string.
+    };
+
+    /**
+     * @brief The number of blocks classified by one call, enough to pay for the dispatch on the instruction set.
+     */
+    static constexpr size_t kBatchBlocks = 64;
+
+    /**
+     * @brief Classifies the bytes of consecutive blocks.
+     * @param data The first byte of the first block.
+     * @param size The number of bytes to classify, at most kBlockSize * kBatchBlocks; the masks have no bits beyond it.
+     * @param blocks Receives the masks of the (size + kBlockSize - 1) / kBlockSize blocks.
+     */
+    static void Classify(const char* data, size_t size, Block* blocks);
+
+    /**
+     * @brief Returns the instruction set used, detected on first use.
+     */
+    static ArrayKernels::InstructionSet Selected();
+
+    /**
+     * @brief Uses the given instruction set, or the best supported one if the CPU lacks it.
+     * @param instruction_set The instruction set to use.
+     */
+    static void Select(ArrayKernels::InstructionSet instruction_set);
+};
+
+#endif //SOURCESCANNER_H
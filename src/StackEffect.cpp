@@ -0,0 +1,65 @@
+#include "StackEffect.h"
+#include <algorithm>
+#include <sstream>
+
+StackEffect StackEffect::Then(const StackEffect& next) const {
+    if (!known || !next.known) {
+        return Unknown();
+    }
+    // heights relative to the height the code starts at
+    int64_t after_first = outputs - inputs;
+    int64_t lowest = std::min(-inputs, after_first - next.inputs);
+    int64_t highest = std::max(peak - inputs, after_first - next.inputs + next.peak);
+    int64_t final_height = after_first - next.inputs + next.outputs;
+    StackEffect result;
+    result.inputs = -lowest;
+    result.outputs = final_height - lowest;
+    result.peak = highest - lowest;
+    return result;
+}
+
+StackEffect StackEffect::Either(const StackEffect& a, const StackEffect& b) {
+    if (!a.known || !b.known || a.Net() != b.Net()) {
+        return Unknown();
+    }
+    StackEffect result;
+    result.inputs = std::max(a.inputs, b.inputs);
+    result.outputs = result.inputs + a.Net();
+    result.peak = std::max(a.peak + result.inputs - a.inputs, b.peak + result.inputs - b.inputs);
+    return result;
+}
+
+int64_t StackEffect::Net() const {
+    return outputs - inputs;
+}
+
+std::string StackEffect::ToString() const {
+    if (!known) {
+        return "( ? )";
+    }
+    return "( " + std::to_string(inputs) + " -- " + std::to_string(outputs) + " )";
+}
+
+StackEffect StackEffect::Parse(const std::string& comment) {
+    std::istringstream words(comment);
+    std::string word;
+    int64_t inputs = 0;
+    int64_t outputs = 0;
+    bool after_separator = false;
+    while (words >> word) {
+        if (word == "(" || word == ")") {
+            continue;
+        }
+        if (word == "--") {
+            after_separator = true;
+        } else if (after_separator) {
+            outputs++;
+        } else {
+            inputs++;
+        }
+    }
+    if (!after_separator) {
+        return Unknown();
+    }
+    return StackEffect(inputs, outputs);
+}
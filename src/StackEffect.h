@@ -0,0 +1,79 @@
+/**
+ * @file StackEffect.h
+ * @brief Defines the StackEffect structure describing how code changes the data stack.
+ */
+
+#ifndef STACKEFFECT_H
+#define STACKEFFECT_H
+
+#include <cstdint>
+#include <string>
+
+/**
+ * @struct StackEffect
+ * @brief The effect of a piece of code on the data stack, written ( inputs -- outputs ) in Forth.
+ *
+ * Started on a stack of height h >= inputs, the code never goes below h - inputs,
+ * never goes above h - inputs + peak and finishes at h - inputs + outputs.
+ */
+struct StackEffect {
+    int64_t inputs = 0;  ///< The number of elements consumed.
+    int64_t outputs = 0; ///< The number of elements produced.
+    int64_t peak = 0;    ///< The highest height reached, relative to the lowest point.
+    bool known = true;   ///< Whether the effect could be determined statically.
+
+    /**
+     * @brief Constructs the effect of code that does nothing.
+     */
+    constexpr StackEffect() = default;
+
+    /**
+     * @brief Constructs the effect of code that pops all inputs before pushing its outputs.
+     * @param inputs The number of elements consumed.
+     * @param outputs The number of elements produced.
+     */
+    constexpr StackEffect(int64_t inputs, int64_t outputs)
+        : inputs(inputs), outputs(outputs), peak(inputs > outputs ? inputs : outputs) {
+    }
+
+    /**
+     * @brief Returns the effect of code whose stack usage cannot be determined statically.
+     */
+    static constexpr StackEffect Unknown() {
+        StackEffect result;
+        result.known = false;
+        return result;
+    }
+
+    /**
+     * @brief Returns the effect of running this code followed by the next.
+     * @param next The effect of the code running afterwards.
+     */
+    StackEffect Then(const StackEffect& next) const;
+
+    /**
+     * @brief Returns the effect of running one of two alternatives.
+     *
+     * The result is unknown unless both alternatives change the depth by the same amount.
+     */
+    static StackEffect Either(const StackEffect& a, const StackEffect& b);
+
+    /**
+     * @brief Returns how much the code changes the stack depth.
+     */
+    int64_t Net() const;
+
+    /**
+     * @brief Formats the effect in Forth stack comment notation.
+     */
+    std::string ToString() const;
+
+    /**
+     * @brief Parses a Forth stack comment such as "( a b -- c )".
+     * @param comment The comment including its braces.
+     * @return The described effect, unknown if the comment has no "--".
+     */
+    static StackEffect Parse(const std::string& comment);
+};
+
+#endif //STACKEFFECT_H
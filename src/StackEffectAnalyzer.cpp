@@ -0,0 +1,246 @@
+#include "StackEffectAnalyzer.h"
+#include <iostream>
+
+namespace {
+
+/**
+ * @brief Rebinds the operators of one word or of the main code after stack effects are known.
+ */
+class CheckMarker final : public ExecutableVisitor {
+public:
+    CheckMarker(const StackEffectAnalyzer& analyzer, bool verified) : analyzer_(analyzer), verified_(verified) {
+    }
+
+    void Visit(VariableCreation&) override {
+    }
+
+    void Visit(Codeblock& node) override {
+        for (const auto& statement : node.statements) {
+            statement->Accept(*this);
+        }
+    }
+
+    void Visit(class While& node) override {
+        node.condition->Accept(*this);
+        node.body->Accept(*this);
+    }
+
+    void Visit(class For& node) override {
+        node.body->Accept(*this);
+    }
+
+    void Visit(class If& node) override {
+        node.if_part->Accept(*this);
+        if (node.else_part) {
+            node.else_part->Accept(*this);
+        }
+    }
+
+    void Visit(class Switch& node) override {
+        for (const auto& [selector, code] : node.cases) {
+            code->Accept(*this);
+        }
+    }
+
+    void Visit(Operator& node) override {
+        if (node.kind == Operator::Kind::kSpawn) {
+            // a task starts on a stack of its own, which no check of the spawning code covers
+            node.entry_check = analyzer_.GetEffect(node.text);
+            return;
+        }
+        if (verified_) {
+            // the depth check on entry of the enclosing word covers everything it executes
+            node.unchecked = true;
+            if (node.kind == Operator::Kind::kBuiltin) {
+                node.builtin = Operator::GetBuiltin(node.text).unchecked;
+            }
+            return;
+        }
+        if (node.kind == Operator::Kind::kFunctionCall) {
+            node.entry_check = analyzer_.GetEffect(node.text);
+        }
+    }
+
+private:
+    const StackEffectAnalyzer& analyzer_;
+    bool verified_;
+};
+
+} // namespace
+
+void StackEffectAnalyzer::Analyze(Environment& environment, const std::map<std::string, std::string>& stack_comments) {
+    environment_ = &environment;
+    for (const auto& [name, body] : environment.functions) {
+        WordEffect(name);
+    }
+    for (const auto& [name, comment] : stack_comments) {
+        auto word = words_.find(name);
+        if (word == words_.end()) {
+            continue;
+        }
+        word->second.declared = comment;
+        auto declared = StackEffect::Parse(comment);
+        const auto& inferred = word->second.effect;
+        if (declared.known && inferred.known &&
+            (declared.Net() != inferred.Net() || declared.inputs < inferred.inputs)) {
+            std::cerr << "Warning: word '" << name << "' is declared " << comment
+                      << " but has stack effect " << inferred.ToString() << "\n";
+        }
+    }
+    for (const auto& [name, body] : environment.functions) {
+        const auto& effect = words_[name].effect;
+        if (effect.known) {
+            environment.word_effects[name] = effect;
+        }
+        CheckMarker marker(*this, effect.known);
+        body->Accept(marker);
+    }
+    CheckMarker marker(*this, false);
+    environment.code->Accept(marker);
+}
+
+void StackEffectAnalyzer::Report(std::ostream& out) const {
+    for (const auto& [name, word] : words_) {
+        out << name << " " << word.effect.ToString();
+        if (word.effect.known) {
+            out << " peak " << word.effect.peak << ", unchecked";
+        } else {
+            out << " checked: " << word.reason;
+        }
+        if (!word.declared.empty()) {
+            out << ", declared " << word.declared;
+        }
+        out << "\n";
+    }
+}
+
+StackEffect StackEffectAnalyzer::GetEffect(const std::string& word) const {
+    auto info = words_.find(word);
+    if (info == words_.end() || !info->second.done) {
+        return StackEffect::Unknown();
+    }
+    return info->second.effect;
+}
+
+void StackEffectAnalyzer::Visit(VariableCreation&) {
+    result_ = StackEffect();
+}
+
+void StackEffectAnalyzer::Visit(Codeblock& node) {
+    StackEffect effect;
+    for (const auto& statement : node.statements) {
+        effect = effect.Then(Infer(*statement));
+    }
+    result_ = effect;
+}
+
+void StackEffectAnalyzer::Visit(class While& node) {
+    auto condition = Infer(*node.condition).Then(StackEffect(1, 0));
+    auto iteration = condition.Then(Infer(*node.body));
+    if (iteration.known && iteration.Net() != 0) {
+        result_ = Fail("BEGIN loop changes the stack depth");
+        return;
+    }
+    result_ = iteration.Then(condition);
+}
+
+void StackEffectAnalyzer::Visit(class For& node) {
+    auto body = Infer(*node.body);
+    if (body.known && body.Net() != 0) {
+        result_ = Fail(node.parallel ? "PDO loop changes the stack depth" : "DO loop changes the stack depth");
+        return;
+    }
+    // a reduction needs the value it replaces below the loop parameters
+    result_ = (node.reduction.empty() ? StackEffect(3, 0) : StackEffect(4, 1)).Then(body);
+}
+
+void StackEffectAnalyzer::Visit(class If& node) {
+    auto if_part = Infer(*node.if_part);
+    auto else_part = node.else_part ? Infer(*node.else_part) : StackEffect();
+    auto branches = StackEffect::Either(if_part, else_part);
+    if (if_part.known && else_part.known && !branches.known) {
+        result_ = Fail("IF branches change the stack depth differently");
+        return;
+    }
+    result_ = StackEffect(1, 0).Then(branches);
+}
+
+void StackEffectAnalyzer::Visit(class Switch& node) {
+    StackEffect cases;
+    for (const auto& [selector, code] : node.cases) {
+        auto effect = Infer(*code);
+        auto combined = StackEffect::Either(cases, effect);
+        if (cases.known && effect.known && !combined.known) {
+            result_ = Fail("CASE branches change the stack depth differently");
+            return;
+        }
+        cases = combined;
+    }
+    result_ = StackEffect(1, 0).Then(cases);
+}
+
+void StackEffectAnalyzer::Visit(Operator& node) {
+    if (node.kind == Operator::Kind::kUnresolved) {
+        node.Resolve(*environment_);
+    }
+    switch (node.kind) {
+        case Operator::Kind::kBuiltin: {
+            auto effect = Operator::GetBuiltin(node.text).effect;
+            result_ = effect.known ? effect : Fail("uses '" + node.text + "'");
+            break;
+        }
+        case Operator::Kind::kFunctionCall: {
+            auto effect = WordEffect(node.text);
+            result_ = effect.known ? effect : Fail("calls '" + node.text + "'");
+            break;
+        }
+        case Operator::Kind::kNative:
+            result_ = node.native->effect.known ? node.native->effect : Fail("calls native word '" + node.text + "'");
+            break;
+        case Operator::Kind::kStringLiteral:
+            result_ = StackEffect(0, 2);
+            break;
+        case Operator::Kind::kSpawn:
+            // the number of arguments moved to the task is only known at runtime
+            result_ = Fail("spawns '" + node.text + "'");
+            break;
+        case Operator::Kind::kVariableUse:
+        case Operator::Kind::kLiteral:
+        case Operator::Kind::kUnresolved:
+            result_ = StackEffect(0, 1);
+            break;
+    }
+}
+
+StackEffect StackEffectAnalyzer::Infer(Executable& node) {
+    node.Accept(*this);
+    return result_;
+}
+
+StackEffect StackEffectAnalyzer::WordEffect(const std::string& name) {
+    auto& word = words_[name];
+    if (word.done) {
+        return word.effect;
+    }
+    if (word.in_progress) {
+        return Fail("recursively calls '" + name + "'");
+    }
+    word.in_progress = true;
+    auto outer_reason = std::move(reason_);
+    reason_.clear();
+    auto effect = Infer(*environment_->functions[name]);
+    // words_ may have grown while analyzing callees, but std::map keeps references valid
+    word.effect = effect;
+    word.reason = reason_;
+    word.in_progress = false;
+    word.done = true;
+    reason_ = std::move(outer_reason);
+    return effect;
+}
+
+StackEffect StackEffectAnalyzer::Fail(const std::string& reason) {
+    if (reason_.empty()) {
+        reason_ = reason;
+    }
+    return StackEffect::Unknown();
+}
@@ -0,0 +1,89 @@
+/**
+ * @file StackEffectAnalyzer.h
+ * @brief Defines the StackEffectAnalyzer pass inferring the stack effect of every word.
+ */
+
+#ifndef STACKEFFECTANALYZER_H
+#define STACKEFFECTANALYZER_H
+
+#include <map>
+#include <ostream>
+#include <string>
+#include "Executable.h"
+#include "Environment.h"
+#include "StackEffect.h"
+
+/**
+ * @class StackEffectAnalyzer
+ * @brief Infers stack effects of words and switches words with a known effect to unchecked stack operations.
+ *
+ * A word whose effect is known checks the stack depth once when it is called from checked code
+ * and then runs unchecked builtins. Words using leave, continue or return, recursive words,
+ * words with unbalanced loops or branches and words calling such words keep the checked path.
+ * Must run after the Linker.
+ */
+class StackEffectAnalyzer final : public ExecutableVisitor {
+public:
+    /**
+     * @brief Infers the effect of every word and rebinds operators accordingly.
+     * @param environment The linked environment.
+     * @param stack_comments Stack comments declared after word names, verified against the inferred effects.
+     */
+    void Analyze(Environment& environment, const std::map<std::string, std::string>& stack_comments = {});
+
+    /**
+     * @brief Prints the inferred effect of every word and why inference failed where it did.
+     * @param out The stream to print to.
+     */
+    void Report(std::ostream& out) const;
+
+    /**
+     * @brief Returns the inferred effect of a word, unknown for words that were not analyzed.
+     * @param word The name of the word.
+     */
+    StackEffect GetEffect(const std::string& word) const;
+
+    void Visit(VariableCreation& node) override;
+    void Visit(Codeblock& node) override;
+    void Visit(class While& node) override;
+    void Visit(class For& node) override;
+    void Visit(class If& node) override;
+    void Visit(class Switch& node) override;
+    void Visit(Operator& node) override;
+
+private:
+    /**
+     * @struct WordInfo
+     * @brief Analysis state and result of one word.
+     */
+    struct WordInfo {
+        StackEffect effect = StackEffect::Unknown(); ///< The inferred effect.
+        std::string reason;       ///< Why the effect is unknown.
+        std::string declared;     ///< The stack comment written after the word name, if any.
+        bool in_progress = false; ///< Whether the word is being analyzed, used to detect recursion.
+        bool done = false;        ///< Whether the word has been analyzed.
+    };
+
+    /**
+     * @brief Returns the effect of a tree node.
+     */
+    StackEffect Infer(Executable& node);
+
+    /**
+     * @brief Returns the effect of a word, analyzing it first if needed.
+     */
+    StackEffect WordEffect(const std::string& name);
+
+    /**
+     * @brief Records why the current word has no known effect.
+     * @return The unknown effect.
+     */
+    StackEffect Fail(const std::string& reason);
+
+    Environment* environment_ = nullptr; ///< The environment being analyzed.
+    std::map<std::string, WordInfo> words_; ///< Results per word.
+    StackEffect result_; ///< The effect of the node visited last.
+    std::string reason_; ///< The first failure reason in the word being analyzed.
+};
+
+#endif //STACKEFFECTANALYZER_H
@@ -1,109 +1,98 @@
 #include "StackElement.h"
 
 StackElement StackElement::operator+(const StackElement& other) {
-    return std::visit([](auto a, auto b) {
-       return StackElement(a + b);
-    }, value, other.value);
+    return Combine(*this, other, [](auto a, auto b) {
+       return a + b;
+    });
 }
 
 StackElement StackElement::operator-(const StackElement& other) {
-    return std::visit([](auto a, auto b) {
-       return StackElement(a - b);
-    }, value, other.value);
+    return Combine(*this, other, [](auto a, auto b) {
+       return a - b;
+    });
 }
 
 StackElement StackElement::operator-() {
-    return std::visit([](auto a) {
-       return StackElement(-a);
-    }, value);
+    if (IsInteger()) {
+        return StackElement(-cell.integer);
+    }
+    return StackElement(-cell.floating);
 }
 
 StackElement StackElement::operator*(const StackElement& other) {
-    return std::visit([](auto a, auto b) {
-       return StackElement(a * b);
-    }, value, other.value);
+    return Combine(*this, other, [](auto a, auto b) {
+       return a * b;
+    });
 }
 
 StackElement StackElement::operator/(const StackElement& other) {
-    return std::visit([](auto a, auto b) {
-       return StackElement(a / b);
-    }, value, other.value);
+    return Combine(*this, other, [](auto a, auto b) {
+       return a / b;
+    });
 }
 
 StackElement StackElement::operator%(const StackElement& other) {
-    return std::visit([](auto a, auto b) {
-       return StackElement(static_cast<int64_t>(a) % static_cast<int64_t>(b));
-    }, value, other.value);
+    return StackElement(Convert<int64_t>() % other.Convert<int64_t>());
 }
 
 StackElement StackElement::operator~() {
-    return std::visit([](auto a) {
-       return StackElement(~static_cast<int64_t>(a));
-    }, value);
+    return StackElement(~Convert<int64_t>());
 }
 
 StackElement StackElement::operator!() {
-    return std::visit([](auto a) {
-       return StackElement(!a);
-    }, value);
+    if (IsInteger()) {
+        return StackElement(!cell.integer);
+    }
+    return StackElement(!cell.floating);
 }
 
 StackElement StackElement::operator&(const StackElement& other) {
-    return std::visit([](auto a, auto b) {
-       return StackElement(static_cast<int64_t>(a) & static_cast<int64_t>(b));
-    }, value, other.value);
+    return StackElement(Convert<int64_t>() & other.Convert<int64_t>());
 }
 
 StackElement StackElement::operator|(const StackElement& other) {
-    return std::visit([](auto a, auto b) {
-       return StackElement(static_cast<int64_t>(a) | static_cast<int64_t>(b));
-    }, value, other.value);
+    return StackElement(Convert<int64_t>() | other.Convert<int64_t>());
 }
 
 StackElement StackElement::operator^(const StackElement& other) {
-    return std::visit([](auto a, auto b) {
-       return StackElement(static_cast<int64_t>(a) ^ static_cast<int64_t>(b));
-    }, value, other.value);
+    return StackElement(Convert<int64_t>() ^ other.Convert<int64_t>());
 }
 
 StackElement StackElement::operator<(const StackElement& other) {
-    auto result = std::visit([](auto a, auto b) {
+    return Combine(*this, other, [](auto a, auto b) {
        return a < b;
-    }, value, other.value);
-    return StackElement(result);
+    });
 }
 
 StackElement StackElement::operator<=(const StackElement& other) {
-    auto result = std::visit([](auto a, auto b) {
+    return Combine(*this, other, [](auto a, auto b) {
        return a <= b;
-    }, value, other.value);
-    return StackElement(result);
+    });
 }
 
 StackElement StackElement::operator>(const StackElement& other) {
-    auto result = std::visit([](auto a, auto b) {
+    return Combine(*this, other, [](auto a, auto b) {
        return a > b;
-    }, value, other.value);
-    return StackElement(result);
+    });
 }
 
 StackElement StackElement::operator>=(const StackElement& other) {
-    auto result = std::visit([](auto a, auto b) {
+    return Combine(*this, other, [](auto a, auto b) {
        return a >= b;
-    }, value, other.value);
-    return StackElement(result);
+    });
 }
 
 StackElement StackElement::operator==(const StackElement& other) {
-    auto result = std::visit([](auto a, auto b) {
+    return Combine(*this, other, [](auto a, auto b) {
        return a == b;
-    }, value, other.value);
-    return StackElement(result);
+    });
 }
 
 std::ostream& operator<<(std::ostream& out, const StackElement& val) {
-    std::visit([&out](auto a) {
-       out << a;
-    }, val.value);
+    if (val.IsInteger()) {
+        out << val.cell.integer;
+    } else {
+        out << val.cell.floating;
+    }
     return out;
 }
@@ -7,7 +7,6 @@
 #define STACKELEMENT_H
 
 #include <cstdint>
-#include <variant>
 #include <istream>
 #include <type_traits>
 
@@ -20,34 +19,81 @@ concept Rational = std::integral<T> || std::is_same_v<double, T> || std::is_same
 /**
  * @class StackElement
  * @brief Represents an element on the stack that supports various operations.
+ *
+ * The value is an 8 byte cell holding either an integer or a double and a one byte tag telling which.
+ * Type tests are a single comparison of the tag; arithmetic has fast paths for integer/integer
+ * and double/double operands and falls back to double arithmetic for mixed operands.
  */
 class StackElement {
 public:
     /**
-     * @brief Holds the value of the stack element, which can be an integer or a double.
+     * @brief The type of the value held in the cell.
      */
-    std::variant<int64_t, double> value;
+    enum class Type : uint8_t {
+        kInteger, ///< The cell holds an int64_t.
+        kDouble   ///< The cell holds a double.
+    };
+
+    /**
+     * @brief Untagged 8 byte storage of a value.
+     */
+    union Cell {
+        int64_t integer; ///< The value if the type is kInteger.
+        double floating; ///< The value if the type is kDouble.
+    };
+
+    Cell cell; ///< The value of the stack element.
+    Type type; ///< The type of the value.
 
     /**
      * @brief Constructs a StackElement from a given value.
-     * @tparam T The type of the value, which must be compatible with the stack element.
+     * @tparam T The type of the value; floating point values are stored as double, everything else as int64_t.
      * @param other The value to initialize the StackElement.
      */
     template<typename T>
     StackElement(T other) {
-        value = std::variant<int64_t, double>(other);
+        if constexpr (std::is_floating_point_v<T>) {
+            cell.floating = static_cast<double>(other);
+            type = Type::kDouble;
+        } else {
+            cell.integer = static_cast<int64_t>(other);
+            type = Type::kInteger;
+        }
+    }
+
+    /**
+     * @brief Reassembles a StackElement from its cell and tag.
+     * @param cell The value.
+     * @param type The type of the value.
+     */
+    StackElement(Cell cell, Type type) : cell(cell), type(type) {
+    }
+
+    /**
+     * @brief Checks whether the element holds an integer.
+     */
+    bool IsInteger() const {
+        return type == Type::kInteger;
+    }
+
+    /**
+     * @brief Returns the value as a double regardless of its type.
+     */
+    double ToDouble() const {
+        return IsInteger() ? static_cast<double>(cell.integer) : cell.floating;
     }
 
     /**
      * @brief Converts the stack element to a specified type.
+     *
+     * The bits of the cell are reinterpreted, which is how addresses are stored on the stack.
+     *
      * @tparam T The type to convert to.
      * @return The converted value.
      */
     template<typename T>
-    T Convert() {
-        return std::visit([](auto a) {
-            return *((T*)&a);
-        }, value);
+    T Convert() const {
+        return *((const T*)&cell);
     }
 
     /**
@@ -56,10 +102,8 @@ public:
      * @return The converted value.
      */
     template<Rational T>
-    T Convert() {
-        return std::visit([](auto a) {
-            return (T)a;
-        }, value);
+    T Convert() const {
+        return IsInteger() ? (T)cell.integer : (T)cell.floating;
     }
 
     // Arithmetic and bitwise operators
@@ -80,6 +124,25 @@ public:
     StackElement operator>(const StackElement& other);
     StackElement operator>=(const StackElement& other);
     StackElement operator==(const StackElement& other);
+
+private:
+    /**
+     * @brief Applies a binary operation, specialized on the types of both operands.
+     * @param a The left operand.
+     * @param b The right operand.
+     * @param operation The operation, callable with two int64_t or two double values.
+     * @return The result of the operation.
+     */
+    template<typename Operation>
+    static StackElement Combine(const StackElement& a, const StackElement& b, Operation operation) {
+        if (a.type == Type::kInteger && b.type == Type::kInteger) {
+            return StackElement(operation(a.cell.integer, b.cell.integer));
+        }
+        if (a.type == Type::kDouble && b.type == Type::kDouble) {
+            return StackElement(operation(a.cell.floating, b.cell.floating));
+        }
+        return StackElement(operation(a.ToDouble(), b.ToDouble()));
+    }
 };
 
 /**
@@ -2,9 +2,20 @@
 
 Executable::ReturnStatus Switch::Execute(Environment& environment) {
     auto selector = environment.PopStack().Convert<int64_t>();
-    if (cases.contains(selector)) {
-        return cases[selector]->Execute(environment);
+    if (auto body = table.Find(selector)) {
+        return (*body)->Execute(environment);
     }
     return ReturnStatus::kSuccess;
 }
 
+void Switch::BuildTable() {
+    std::map<int64_t, Executable*> bodies;
+    for (const auto& [selector, code] : cases) {
+        bodies[selector] = code.get();
+    }
+    table = CaseTable<Executable*>(bodies);
+}
+
+void Switch::Accept(ExecutableVisitor& visitor) {
+    visitor.Visit(*this);
+}
@@ -2,15 +2,23 @@
 #include "Executable.h"
 
 Executable::ReturnStatus VariableCreation::Execute(Environment& environment) {
-    if (environment.variables.contains(name)) {
+    auto& address = environment.slots[slot];
+    if (address != nullptr) {
         std::string s = "Variable " + name + " is already defined";
         throw std::runtime_error(s);
     }
+    address = environment.data_space.Address(offset);
+    return ReturnStatus::kSuccess;
+}
+
+size_t VariableCreation::ByteSize() const {
     size_t byte_size = size;
     if (type == "cells" || type == "floats") {
         byte_size *= 8;
     }
-    void* allocated_memory = malloc(byte_size);
-    environment.variables[name] = allocated_memory;
-    return ReturnStatus::kSuccess;
+    return byte_size;
+}
+
+void VariableCreation::Accept(ExecutableVisitor& visitor) {
+    visitor.Visit(*this);
 }
@@ -0,0 +1,832 @@
+#include "VirtualMachine.h"
+#include "Scheduler.h"
+#include <stdexcept>
+#include <iterator>
+#include <map>
+#include <string>
+#include <utility>
+
+VirtualMachine::VirtualMachine(BytecodeProgram program) : program_(std::move(program)) {
+    for (const auto& cases : program_.switches) {
+        switches_.emplace_back(cases);
+    }
+}
+
+void VirtualMachine::Run(Environment& environment) {
+    ExecuteWith(environment, 0);
+}
+
+void VirtualMachine::Call(Environment& environment, const std::string& word) {
+    auto entry = program_.entries.find(word);
+    if (entry == program_.entries.end()) {
+        throw std::runtime_error("Unknown word '" + word + "'");
+    }
+    CallWord(environment, static_cast<size_t>(entry->second));
+}
+
+void VirtualMachine::SetEngine(Engine engine) {
+    engine = FORTH_THREADED_DISPATCH ? engine : Engine::kStack;
+    // the handlers point into the dispatch loop of the engine that filled them
+    if (engine != engine_ && handlers_filled_) {
+        throw std::logic_error("The engine of a VirtualMachine cannot change after its first run");
+    }
+    engine_ = engine;
+}
+
+void VirtualMachine::ExecuteWith(Environment& environment, size_t entry, size_t* pause) {
+#if FORTH_THREADED_DISPATCH
+    if (engine_ == Engine::kTopOfStackCache) {
+        ExecuteCached(environment, entry, pause);
+        return;
+    }
+#endif
+    Execute(environment, entry, pause);
+}
+
+bool VirtualMachine::RunTask(Environment& environment, size_t& resume) {
+    auto entry = std::exchange(resume, kTaskFinished);
+    ExecuteWith(environment, entry, &resume);
+    return resume == kTaskFinished;
+}
+
+void VirtualMachine::Spawn(Environment& environment, size_t entry) {
+    auto task = Scheduler::NewTask(environment);
+    task->resume = entry;
+    task->step = [this](Environment& task_environment, size_t& resume) {
+        return RunTask(task_environment, resume);
+    };
+    Scheduler::Of(environment).Spawn(std::move(task));
+}
+
+void VirtualMachine::EnableJit(uint32_t threshold) {
+    if (!FORTH_JIT || threshold == 0) {
+        return;
+    }
+    jit_ = std::make_unique<JitCompiler>();
+    jit_threshold_ = threshold;
+    call_counts_ = std::make_unique<std::atomic<uint32_t>[]>(program_.code.size());
+    native_ = std::make_unique<std::atomic<JitFunction>[]>(program_.code.size());
+}
+
+JitFunction VirtualMachine::Compile(size_t entry) {
+    std::lock_guard lock(jit_mutex_);
+    auto function = jit_->Compile(program_, entry);
+    native_[entry].store(function, std::memory_order_release);
+    return function;
+}
+
+void VirtualMachine::ReportJit(std::ostream& out) const {
+    if (jit_) {
+        jit_->Report(out);
+    }
+}
+
+void VirtualMachine::RunNative(Environment& environment, JitFunction function) {
+    JitContext context{environment.stack.storage(), &environment, this, nullptr};
+    size_t loop_base = environment.loops.size();
+    ++environment.native_depth;
+    int status = function(&context);
+    --environment.native_depth;
+    while (environment.loops.size() > loop_base) {
+        LeaveLoop(environment);
+    }
+    if (status == kJitError) {
+        std::rethrow_exception(context.error);
+    }
+}
+
+void VirtualMachine::CallWord(Environment& environment, size_t entry) {
+    if (auto function = NativeCode(environment, entry)) {
+        RunNative(environment, function);
+    } else {
+        ExecuteWith(environment, entry);
+    }
+}
+
+void VirtualMachine::LeaveLoop(Environment& environment) {
+    environment.loops.pop_back();
+}
+
+#if FORTH_THREADED_DISPATCH
+#define TARGET(name) label_##name:
+#define DISPATCH() goto *ip->handler
+#else
+#define TARGET(name) case Opcode::name:
+#define DISPATCH() goto dispatch
+#endif
+#define NEXT() ++ip; DISPATCH()
+
+void VirtualMachine::Execute(Environment& environment, size_t entry, size_t* pause) {
+#if FORTH_THREADED_DISPATCH
+    static const void* const dispatch_table[] = {
+        &&label_kHalt,
+        &&label_kReturn,
+        &&label_kBuiltin,
+        &&label_kCall,
+        &&label_kTailCall,
+        &&label_kRequire,
+        &&label_kPushConstant,
+        &&label_kPushString,
+        &&label_kPushVariable,
+        &&label_kExecute,
+        &&label_kJump,
+        &&label_kJumpIfFalse,
+        &&label_kSwitch,
+        &&label_kDoEnter,
+        &&label_kDoLoop,
+        &&label_kDoExit,
+        &&label_kLoopIndex,
+        &&label_kSpawn,
+        &&label_kPause,
+        &&label_kDupMultiply,
+        &&label_kOverOver,
+        &&label_kNip,
+        &&label_kAddConstant,
+        &&label_kSubtractConstant,
+        &&label_kMultiplyConstant,
+        &&label_kLessConstant,
+        &&label_kGreaterConstant,
+        &&label_kEqualsConstant,
+        &&label_kFetchVariable,
+        &&label_kJumpIfNotLess,
+        &&label_kJumpIfNotLessEqual,
+        &&label_kJumpIfNotGreater,
+        &&label_kJumpIfNotGreaterEqual,
+        &&label_kJumpIfNotEqual,
+    };
+    static_assert(std::size(dispatch_table) == static_cast<size_t>(Opcode::kOpcodeCount));
+    // the first run fills in the handlers; runs on other threads wait for it
+    std::call_once(threaded_, [&] {
+        for (auto& instruction : program_.code) {
+            instruction.handler = dispatch_table[static_cast<size_t>(instruction.opcode)];
+        }
+        handlers_filled_ = true;
+    });
+#endif
+    const Instruction* code = program_.code.data();
+    const Instruction* ip = code + entry;
+    // a task owns its environment, so it runs until its stacks are empty and resumes on the stacks it paused with
+    size_t loop_base = pause == nullptr ? environment.loops.size() : 0;
+    size_t frame_base = pause == nullptr ? environment.return_stack.size() : 0;
+    auto& return_stack = environment.return_stack;
+    auto& stack = environment.stack;
+
+#if FORTH_THREADED_DISPATCH
+    DISPATCH();
+    {
+#else
+dispatch:
+    switch (ip->opcode) {
+#endif
+    TARGET(kHalt)
+        while (environment.loops.size() > loop_base) {
+            LeaveLoop(environment);
+        }
+        return;
+    TARGET(kReturn)
+    return_from_word: {
+        if (return_stack.size() == frame_base) {
+            while (environment.loops.size() > loop_base) {
+                LeaveLoop(environment);
+            }
+            return;
+        }
+        auto frame = return_stack.back();
+        return_stack.pop_back();
+        while (environment.loops.size() > frame.loops) {
+            LeaveLoop(environment);
+        }
+        ip = code + frame.address;
+        DISPATCH();
+    }
+    TARGET(kBuiltin)
+        program_.builtins[ip->operand](environment);
+        NEXT();
+    TARGET(kCall)
+        if (auto function = pause == nullptr ? NativeCode(environment, ip - code + ip->operand) : nullptr) {
+            RunNative(environment, function);
+            NEXT();
+        }
+        return_stack.push_back({static_cast<size_t>(ip + 1 - code), environment.loops.size()});
+        ip += ip->operand;
+        DISPATCH();
+    TARGET(kTailCall)
+        if (auto function = pause == nullptr ? NativeCode(environment, ip - code + ip->operand) : nullptr) {
+            RunNative(environment, function);
+            goto return_from_word;
+        }
+        ip += ip->operand;
+        DISPATCH();
+    TARGET(kRequire) {
+        const auto& effect = program_.effects[ip->operand];
+        environment.RequireStack(effect.inputs, effect.peak);
+        NEXT();
+    }
+    TARGET(kPushConstant)
+        environment.PushOnStack(program_.constants[ip->operand]);
+        NEXT();
+    TARGET(kPushString) {
+        const auto& text = program_.strings[ip->operand];
+        environment.PushOnStack(StackElement(reinterpret_cast<int64_t>(text.c_str() + 2)));
+        environment.PushOnStack(StackElement(static_cast<int64_t>(text.size() - 3)));
+        NEXT();
+    }
+    TARGET(kPushVariable) {
+        auto address = environment.slots[ip->operand];
+        if (address == nullptr) {
+            throw std::runtime_error("unknown operator passed");
+        }
+        environment.PushOnStack(StackElement(reinterpret_cast<int64_t>(address)));
+        NEXT();
+    }
+    TARGET(kExecute)
+        program_.nodes[ip->operand]->Execute(environment);
+        NEXT();
+    TARGET(kJump)
+        ip += ip->operand;
+        DISPATCH();
+    TARGET(kJumpIfFalse)
+        if (environment.PopStack().Convert<bool>()) {
+            NEXT();
+        }
+        ip += ip->operand;
+        DISPATCH();
+    TARGET(kSwitch) {
+        auto target = switches_[ip->operand].Find(environment.PopStack().Convert<int64_t>());
+        if (target == nullptr) {
+            NEXT();
+        }
+        ip += *target;
+        DISPATCH();
+    }
+    TARGET(kDoEnter)
+        if (EnterLoop(environment)) {
+            NEXT();
+        }
+        ip += ip->operand;
+        DISPATCH();
+    TARGET(kDoLoop)
+        if (NextIteration(environment)) {
+            ip += ip->operand;
+            DISPATCH();
+        }
+        NEXT();
+    TARGET(kDoExit)
+        LeaveLoop(environment);
+        NEXT();
+    TARGET(kLoopIndex)
+        environment.PushOnStack(environment.LoopIndex(ip->operand));
+        NEXT();
+    TARGET(kSpawn)
+        Spawn(environment, static_cast<size_t>(ip + 1 - code));
+        ip += ip->operand;
+        DISPATCH();
+    TARGET(kPause)
+        if (pause == nullptr) {
+            NEXT();
+        }
+        *pause = static_cast<size_t>(ip + 1 - code);
+        return;
+    TARGET(kDupMultiply) {
+        environment.RequireStack(1, 1);
+        auto a = stack.back();
+        stack.set_back(a * a);
+        NEXT();
+    }
+    TARGET(kOverOver) {
+        environment.RequireStack(2, 4);
+        auto a = stack[stack.size() - 2];
+        auto b = stack.back();
+        stack.push_back_unchecked(a);
+        stack.push_back_unchecked(b);
+        NEXT();
+    }
+    TARGET(kNip) {
+        environment.RequireStack(2, 2);
+        auto b = stack.back();
+        stack.pop_back();
+        stack.set_back(b);
+        NEXT();
+    }
+    TARGET(kAddConstant)
+        environment.RequireStack(1, 1);
+        stack.set_back(stack.back() + program_.constants[ip->operand]);
+        NEXT();
+    TARGET(kSubtractConstant)
+        environment.RequireStack(1, 1);
+        stack.set_back(stack.back() - program_.constants[ip->operand]);
+        NEXT();
+    TARGET(kMultiplyConstant)
+        environment.RequireStack(1, 1);
+        stack.set_back(stack.back() * program_.constants[ip->operand]);
+        NEXT();
+    TARGET(kLessConstant)
+        environment.RequireStack(1, 1);
+        stack.set_back(stack.back() < program_.constants[ip->operand]);
+        NEXT();
+    TARGET(kGreaterConstant)
+        environment.RequireStack(1, 1);
+        stack.set_back(stack.back() > program_.constants[ip->operand]);
+        NEXT();
+    TARGET(kEqualsConstant)
+        environment.RequireStack(1, 1);
+        stack.set_back(stack.back() == program_.constants[ip->operand]);
+        NEXT();
+    TARGET(kFetchVariable) {
+        auto address = environment.slots[ip->operand];
+        if (address == nullptr) {
+            throw std::runtime_error("unknown operator passed");
+        }
+        environment.PushOnStack(*static_cast<int64_t*>(address));
+        NEXT();
+    }
+    TARGET(kJumpIfNotLess) {
+        auto b = environment.PopStack();
+        auto a = environment.PopStack();
+        if ((a < b).Convert<bool>()) {
+            NEXT();
+        }
+        ip += ip->operand;
+        DISPATCH();
+    }
+    TARGET(kJumpIfNotLessEqual) {
+        auto b = environment.PopStack();
+        auto a = environment.PopStack();
+        if ((a <= b).Convert<bool>()) {
+            NEXT();
+        }
+        ip += ip->operand;
+        DISPATCH();
+    }
+    TARGET(kJumpIfNotGreater) {
+        auto b = environment.PopStack();
+        auto a = environment.PopStack();
+        if ((a > b).Convert<bool>()) {
+            NEXT();
+        }
+        ip += ip->operand;
+        DISPATCH();
+    }
+    TARGET(kJumpIfNotGreaterEqual) {
+        auto b = environment.PopStack();
+        auto a = environment.PopStack();
+        if ((a >= b).Convert<bool>()) {
+            NEXT();
+        }
+        ip += ip->operand;
+        DISPATCH();
+    }
+    TARGET(kJumpIfNotEqual) {
+        auto b = environment.PopStack();
+        auto a = environment.PopStack();
+        if ((a == b).Convert<bool>()) {
+            NEXT();
+        }
+        ip += ip->operand;
+        DISPATCH();
+    }
+#if !FORTH_THREADED_DISPATCH
+    default:
+        throw std::runtime_error("invalid opcode");
+#endif
+    }
+}
+
+#if FORTH_THREADED_DISPATCH
+
+// Moves the cached top of stack into memory, for code that works on Environment::stack directly.
+#define SPILL() if (cached) { stack.push_back(tos); cached = false; }
+// Makes the top of stack cached, pushing the previously cached value below it.
+#define CACHE(value) SPILL(); tos = (value); cached = true
+// Handler of a binary builtin combining the element below the cached top of stack with it.
+// Operands that are not both available take the generic path, which reports underflow.
+#define CACHED_BINARY(label, op) \
+    label: \
+        if (!cached || stack.empty()) { \
+            goto generic_builtin; \
+        } \
+        tos = stack.back() op tos; \
+        stack.pop_back(); \
+        NEXT();
+
+void VirtualMachine::ExecuteCached(Environment& environment, size_t entry, size_t* pause) {
+    static const void* const dispatch_table[] = {
+        &&label_kHalt,
+        &&label_kReturn,
+        &&label_kBuiltin,
+        &&label_kCall,
+        &&label_kTailCall,
+        &&label_kRequire,
+        &&label_kPushConstant,
+        &&label_kPushString,
+        &&label_kPushVariable,
+        &&label_kExecute,
+        &&label_kJump,
+        &&label_kJumpIfFalse,
+        &&label_kSwitch,
+        &&label_kDoEnter,
+        &&label_kDoLoop,
+        &&label_kDoExit,
+        &&label_kLoopIndex,
+        &&label_kSpawn,
+        &&label_kPause,
+        &&label_kDupMultiply,
+        &&label_kOverOver,
+        &&label_kNip,
+        &&label_kAddConstant,
+        &&label_kSubtractConstant,
+        &&label_kMultiplyConstant,
+        &&label_kLessConstant,
+        &&label_kGreaterConstant,
+        &&label_kEqualsConstant,
+        &&label_kFetchVariable,
+        &&label_kJumpIfNotLess,
+        &&label_kJumpIfNotLessEqual,
+        &&label_kJumpIfNotGreater,
+        &&label_kJumpIfNotGreaterEqual,
+        &&label_kJumpIfNotEqual,
+    };
+    static_assert(std::size(dispatch_table) == static_cast<size_t>(Opcode::kOpcodeCount));
+    // builtins with a handler working on the cached top of stack
+    static const std::map<std::string, const void*> builtin_handlers = {
+        {"+", &&builtin_add},
+        {"-", &&builtin_subtract},
+        {"*", &&builtin_multiply},
+        {"/", &&builtin_divide},
+        {"%", &&builtin_modulus},
+        {"and", &&builtin_and},
+        {"or", &&builtin_or},
+        {"xor", &&builtin_xor},
+        {"<", &&builtin_less},
+        {"<=", &&builtin_less_equal},
+        {">", &&builtin_greater},
+        {">=", &&builtin_greater_equal},
+        {"=", &&builtin_equals},
+        {"dup", &&builtin_dup},
+        {"drop", &&builtin_drop},
+        {"swap", &&builtin_swap},
+        {"over", &&builtin_over},
+        {"nip", &&builtin_nip},
+        {"@", &&builtin_fetch},
+        {"!", &&builtin_store},
+    };
+    std::call_once(threaded_, [&] {
+        std::map<Operator::Builtin, const void*> specialized;
+        for (const auto& [name, handler] : builtin_handlers) {
+            const auto& descriptor = Operator::GetBuiltin(name);
+            specialized[descriptor.checked] = handler;
+            specialized[descriptor.unchecked] = handler;
+        }
+        for (auto& instruction : program_.code) {
+            instruction.handler = dispatch_table[static_cast<size_t>(instruction.opcode)];
+            if (instruction.opcode == Opcode::kBuiltin) {
+                auto handler = specialized.find(program_.builtins[instruction.operand]);
+                if (handler != specialized.end()) {
+                    instruction.handler = handler->second;
+                }
+            }
+        }
+        handlers_filled_ = true;
+    });
+    const Instruction* code = program_.code.data();
+    const Instruction* ip = code + entry;
+    // a task owns its environment, so it runs until its stacks are empty and resumes on the stacks it paused with
+    size_t loop_base = pause == nullptr ? environment.loops.size() : 0;
+    size_t frame_base = pause == nullptr ? environment.return_stack.size() : 0;
+    auto& return_stack = environment.return_stack;
+    auto& stack = environment.stack;
+    StackElement tos(int64_t(0)); // the top of stack while cached is set; the rest is in memory
+    bool cached = false;
+
+    DISPATCH();
+    {
+    TARGET(kHalt)
+        SPILL();
+        while (environment.loops.size() > loop_base) {
+            LeaveLoop(environment);
+        }
+        return;
+    TARGET(kReturn)
+    return_from_word: {
+        if (return_stack.size() == frame_base) {
+            SPILL();
+            while (environment.loops.size() > loop_base) {
+                LeaveLoop(environment);
+            }
+            return;
+        }
+        auto frame = return_stack.back();
+        return_stack.pop_back();
+        while (environment.loops.size() > frame.loops) {
+            LeaveLoop(environment);
+        }
+        ip = code + frame.address;
+        DISPATCH();
+    }
+    TARGET(kBuiltin)
+    generic_builtin:
+        SPILL();
+        program_.builtins[ip->operand](environment);
+        NEXT();
+    TARGET(kCall)
+        if (auto function = pause == nullptr ? NativeCode(environment, ip - code + ip->operand) : nullptr) {
+            SPILL();
+            RunNative(environment, function);
+            NEXT();
+        }
+        return_stack.push_back({static_cast<size_t>(ip + 1 - code), environment.loops.size()});
+        ip += ip->operand;
+        DISPATCH();
+    TARGET(kTailCall)
+        if (auto function = pause == nullptr ? NativeCode(environment, ip - code + ip->operand) : nullptr) {
+            SPILL();
+            RunNative(environment, function);
+            goto return_from_word;
+        }
+        ip += ip->operand;
+        DISPATCH();
+    TARGET(kRequire) {
+        // the cached element counts towards the inputs but is not in memory
+        const auto& effect = program_.effects[ip->operand];
+        if (cached && effect.inputs > 0) {
+            environment.RequireStack(effect.inputs - 1, effect.peak);
+        } else if (cached) {
+            environment.RequireStack(0, effect.peak + 1);
+        } else {
+            environment.RequireStack(effect.inputs, effect.peak);
+        }
+        NEXT();
+    }
+    TARGET(kPushConstant)
+        CACHE(program_.constants[ip->operand]);
+        NEXT();
+    TARGET(kPushString) {
+        const auto& text = program_.strings[ip->operand];
+        CACHE(StackElement(reinterpret_cast<int64_t>(text.c_str() + 2)));
+        CACHE(StackElement(static_cast<int64_t>(text.size() - 3)));
+        NEXT();
+    }
+    TARGET(kPushVariable) {
+        auto address = environment.slots[ip->operand];
+        if (address == nullptr) {
+            throw std::runtime_error("unknown operator passed");
+        }
+        CACHE(StackElement(reinterpret_cast<int64_t>(address)));
+        NEXT();
+    }
+    TARGET(kExecute)
+        SPILL();
+        program_.nodes[ip->operand]->Execute(environment);
+        NEXT();
+    TARGET(kJump)
+        ip += ip->operand;
+        DISPATCH();
+    TARGET(kJumpIfFalse) {
+        auto flag = cached ? tos : environment.PopStack();
+        cached = false;
+        if (flag.Convert<bool>()) {
+            NEXT();
+        }
+        ip += ip->operand;
+        DISPATCH();
+    }
+    TARGET(kSwitch) {
+        auto selector = cached ? tos : environment.PopStack();
+        cached = false;
+        auto target = switches_[ip->operand].Find(selector.Convert<int64_t>());
+        if (target == nullptr) {
+            NEXT();
+        }
+        ip += *target;
+        DISPATCH();
+    }
+    TARGET(kDoEnter)
+        SPILL();
+        if (EnterLoop(environment)) {
+            NEXT();
+        }
+        ip += ip->operand;
+        DISPATCH();
+    TARGET(kDoLoop)
+        if (NextIteration(environment)) {
+            ip += ip->operand;
+            DISPATCH();
+        }
+        NEXT();
+    TARGET(kDoExit)
+        LeaveLoop(environment);
+        NEXT();
+    TARGET(kLoopIndex)
+        CACHE(StackElement(environment.LoopIndex(ip->operand)));
+        NEXT();
+    TARGET(kSpawn)
+        SPILL();
+        Spawn(environment, static_cast<size_t>(ip + 1 - code));
+        ip += ip->operand;
+        DISPATCH();
+    TARGET(kPause)
+        if (pause == nullptr) {
+            NEXT();
+        }
+        SPILL();
+        *pause = static_cast<size_t>(ip + 1 - code);
+        return;
+    TARGET(kDupMultiply)
+        if (!cached) {
+            tos = environment.PopStack();
+            cached = true;
+        }
+        tos = tos * tos;
+        NEXT();
+    TARGET(kOverOver) {
+        SPILL();
+        environment.RequireStack(2, 4);
+        auto a = stack[stack.size() - 2];
+        stack.push_back_unchecked(a);
+        tos = stack[stack.size() - 2];
+        cached = true;
+        NEXT();
+    }
+    TARGET(kNip)
+        if (!cached) {
+            tos = environment.PopStack();
+            cached = true;
+        }
+        environment.PopStack();
+        NEXT();
+    TARGET(kAddConstant)
+        if (!cached) {
+            tos = environment.PopStack();
+            cached = true;
+        }
+        tos = tos + program_.constants[ip->operand];
+        NEXT();
+    TARGET(kSubtractConstant)
+        if (!cached) {
+            tos = environment.PopStack();
+            cached = true;
+        }
+        tos = tos - program_.constants[ip->operand];
+        NEXT();
+    TARGET(kMultiplyConstant)
+        if (!cached) {
+            tos = environment.PopStack();
+            cached = true;
+        }
+        tos = tos * program_.constants[ip->operand];
+        NEXT();
+    TARGET(kLessConstant)
+        if (!cached) {
+            tos = environment.PopStack();
+            cached = true;
+        }
+        tos = tos < program_.constants[ip->operand];
+        NEXT();
+    TARGET(kGreaterConstant)
+        if (!cached) {
+            tos = environment.PopStack();
+            cached = true;
+        }
+        tos = tos > program_.constants[ip->operand];
+        NEXT();
+    TARGET(kEqualsConstant)
+        if (!cached) {
+            tos = environment.PopStack();
+            cached = true;
+        }
+        tos = tos == program_.constants[ip->operand];
+        NEXT();
+    TARGET(kFetchVariable) {
+        auto address = environment.slots[ip->operand];
+        if (address == nullptr) {
+            throw std::runtime_error("unknown operator passed");
+        }
+        CACHE(StackElement(*static_cast<int64_t*>(address)));
+        NEXT();
+    }
+    TARGET(kJumpIfNotLess) {
+        auto b = cached ? tos : environment.PopStack();
+        cached = false;
+        auto a = environment.PopStack();
+        if ((a < b).Convert<bool>()) {
+            NEXT();
+        }
+        ip += ip->operand;
+        DISPATCH();
+    }
+    TARGET(kJumpIfNotLessEqual) {
+        auto b = cached ? tos : environment.PopStack();
+        cached = false;
+        auto a = environment.PopStack();
+        if ((a <= b).Convert<bool>()) {
+            NEXT();
+        }
+        ip += ip->operand;
+        DISPATCH();
+    }
+    TARGET(kJumpIfNotGreater) {
+        auto b = cached ? tos : environment.PopStack();
+        cached = false;
+        auto a = environment.PopStack();
+        if ((a > b).Convert<bool>()) {
+            NEXT();
+        }
+        ip += ip->operand;
+        DISPATCH();
+    }
+    TARGET(kJumpIfNotGreaterEqual) {
+        auto b = cached ? tos : environment.PopStack();
+        cached = false;
+        auto a = environment.PopStack();
+        if ((a >= b).Convert<bool>()) {
+            NEXT();
+        }
+        ip += ip->operand;
+        DISPATCH();
+    }
+    TARGET(kJumpIfNotEqual) {
+        auto b = cached ? tos : environment.PopStack();
+        cached = false;
+        auto a = environment.PopStack();
+        if ((a == b).Convert<bool>()) {
+            NEXT();
+        }
+        ip += ip->operand;
+        DISPATCH();
+    }
+    // Handlers of builtins operating on the cached top of stack and the element below it.
+    CACHED_BINARY(builtin_add, +)
+    CACHED_BINARY(builtin_subtract, -)
+    CACHED_BINARY(builtin_multiply, *)
+    CACHED_BINARY(builtin_divide, /)
+    CACHED_BINARY(builtin_modulus, %)
+    CACHED_BINARY(builtin_and, &)
+    CACHED_BINARY(builtin_or, |)
+    CACHED_BINARY(builtin_xor, ^)
+    CACHED_BINARY(builtin_less, <)
+    CACHED_BINARY(builtin_less_equal, <=)
+    CACHED_BINARY(builtin_greater, >)
+    CACHED_BINARY(builtin_greater_equal, >=)
+    CACHED_BINARY(builtin_equals, ==)
+    builtin_dup:
+        if (!cached) {
+            goto generic_builtin;
+        }
+        stack.push_back(tos);
+        NEXT();
+    builtin_drop:
+        if (!cached) {
+            goto generic_builtin;
+        }
+        cached = false;
+        NEXT();
+    builtin_swap: {
+        if (!cached || stack.empty()) {
+            goto generic_builtin;
+        }
+        auto below = stack.back();
+        stack.set_back(tos);
+        tos = below;
+        NEXT();
+    }
+    builtin_over: {
+        if (!cached || stack.empty()) {
+            goto generic_builtin;
+        }
+        auto below = stack.back();
+        stack.push_back(tos);
+        tos = below;
+        NEXT();
+    }
+    builtin_nip:
+        if (!cached || stack.empty()) {
+            goto generic_builtin;
+        }
+        stack.pop_back();
+        NEXT();
+    builtin_fetch:
+        if (!cached) {
+            goto generic_builtin;
+        }
+        tos = StackElement(*tos.Convert<int64_t*>());
+        NEXT();
+    builtin_store:
+        if (!cached || stack.empty()) {
+            goto generic_builtin;
+        }
+        *tos.Convert<int64_t*>() = stack.back().Convert<int64_t>();
+        stack.pop_back();
+        cached = false;
+        NEXT();
+    }
+}
+
+#undef CACHED_BINARY
+#undef CACHE
+#undef SPILL
+
+#endif
+
+#undef NEXT
+#undef DISPATCH
+#undef TARGET
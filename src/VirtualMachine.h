@@ -0,0 +1,252 @@
+/**
+ * @file VirtualMachine.h
+ * @brief Defines the VirtualMachine class executing a BytecodeProgram.
+ */
+
+#ifndef VIRTUALMACHINE_H
+#define VIRTUALMACHINE_H
+
+#include <cstddef>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "Bytecode.h"
+#include "Environment.h"
+#include "Jit.h"
+
+#if defined(__GNUC__)
+/**
+ * @brief Dispatch through the handler addresses stored in each instruction (direct threading via computed goto).
+ *
+ * Compilers without the labels-as-values extension fall back to a switch based dispatch loop.
+ */
+#define FORTH_THREADED_DISPATCH 1
+#else
+#define FORTH_THREADED_DISPATCH 0
+#endif
+
+/**
+ * @class VirtualMachine
+ * @brief Executes bytecode produced by the BytecodeCompiler.
+ *
+ * Calls of words push a frame on Environment::return_stack and jump, so Forth recursion
+ * does not grow the native stack; calls in tail position jump without pushing a frame.
+ * With the JIT enabled, words called often enough are compiled to native code and run
+ * from then on instead of being interpreted. Tasks started by SPAWN are always interpreted,
+ * so that PAUSE can suspend them between two instructions.
+ *
+ * Once configured, the machine may run the program on several threads at once, each with an
+ * Environment of its own: instruction handlers are filled in once, and call counts and compiled
+ * words are shared between the threads.
+ */
+class VirtualMachine {
+public:
+    /**
+     * @brief Constructs a VirtualMachine for the given program.
+     * @param program The compiled program.
+     */
+    explicit VirtualMachine(BytecodeProgram program);
+
+    /**
+     * @brief Dispatch loops the VirtualMachine can run the program with.
+     */
+    enum class Engine {
+        kStack,           ///< Every instruction works on Environment::stack.
+        kTopOfStackCache  ///< The top of stack is kept in a local variable and spilled only when needed.
+    };
+
+    /**
+     * @brief Selects the dispatch loop; kTopOfStackCache needs threaded dispatch and falls back to kStack otherwise.
+     *
+     * Must be called before the first run, which fills in the handlers of the selected loop.
+     *
+     * @param engine The engine to use.
+     * @throws std::logic_error If another engine has already run the program.
+     */
+    void SetEngine(Engine engine);
+
+    /**
+     * @brief Executes the main code of the program.
+     * @param environment The execution environment.
+     */
+    void Run(Environment& environment);
+
+    /**
+     * @brief Executes one word of the program, natively if it is compiled.
+     *
+     * Words with a known stack effect do not check the stack, so the caller verifies it first.
+     *
+     * @param environment The execution environment holding the arguments of the word.
+     * @param word The name of the word.
+     * @throws std::runtime_error If the program defines no such word.
+     */
+    void Call(Environment& environment, const std::string& word);
+
+    /**
+     * @brief Compiles words to native code once they have been called the given number of times.
+     *
+     * Has no effect on platforms without JIT support. Must be called before the first run.
+     *
+     * @param threshold The number of calls after which a word is compiled.
+     */
+    void EnableJit(uint32_t threshold);
+
+    /**
+     * @brief Returns the program being executed.
+     */
+    const BytecodeProgram& program() const {
+        return program_;
+    }
+
+    /**
+     * @brief Prints the words compiled to native code.
+     * @param out The stream to print to.
+     */
+    void ReportJit(std::ostream& out) const;
+
+    /**
+     * @brief Maximal nesting of native words on the native stack; deeper calls are interpreted.
+     */
+    static constexpr int kMaxNativeDepth = 1024;
+
+    /**
+     * @brief Resume address of a task that has finished.
+     */
+    static constexpr size_t kTaskFinished = SIZE_MAX;
+
+private:
+    friend class JitCompiler;
+
+    /**
+     * @brief Executes instructions starting at the given address until the code returns or halts.
+     *
+     * With pause set, the code runs as a task: it may be a resumed one, returns once its return stack
+     * is empty and stops at PAUSE, storing the address to resume at in *pause.
+     *
+     * @param environment The execution environment.
+     * @param entry The address of the first instruction.
+     * @param pause Where to store the resume address of a task, nullptr outside of tasks.
+     */
+    void Execute(Environment& environment, size_t entry, size_t* pause = nullptr);
+
+    /**
+     * @brief Executes like Execute, keeping the top of stack out of Environment::stack between instructions.
+     *
+     * The cached element is spilled before builtins without a dedicated handler, native words,
+     * variable creation and when the code returns or halts.
+     *
+     * @param environment The execution environment.
+     * @param entry The address of the first instruction.
+     * @param pause Where to store the resume address of a task, nullptr outside of tasks.
+     */
+    void ExecuteCached(Environment& environment, size_t entry, size_t* pause = nullptr);
+
+    /**
+     * @brief Executes with the selected engine.
+     * @param environment The execution environment.
+     * @param entry The address of the first instruction.
+     * @param pause Where to store the resume address of a task, nullptr outside of tasks.
+     */
+    void ExecuteWith(Environment& environment, size_t entry, size_t* pause = nullptr);
+
+    /**
+     * @brief Runs a task until it pauses or finishes; the step of tasks started by kSpawn.
+     * @param environment The environment of the task.
+     * @param resume The address to continue at, updated when the task pauses.
+     * @return Whether the task finished.
+     */
+    bool RunTask(Environment& environment, size_t& resume);
+
+    /**
+     * @brief Moves the arguments of SPAWN into a new task starting at the given address.
+     * @param environment The execution environment of the spawning code.
+     * @param entry The address of the code the task runs.
+     */
+    void Spawn(Environment& environment, size_t entry);
+
+    /**
+     * @brief Removes the innermost DO LOOP.
+     * @param environment The execution environment.
+     */
+    void LeaveLoop(Environment& environment);
+
+    /**
+     * @brief Pops from, to and step and starts a DO LOOP.
+     * @param environment The execution environment.
+     * @return Whether the body runs at least once.
+     */
+    bool EnterLoop(Environment& environment) {
+        auto from = environment.PopStack().Convert<int64_t>();
+        auto to = environment.PopStack().Convert<int64_t>();
+        auto step = environment.PopStack().Convert<int64_t>();
+        environment.loops.push_back({from, to, step});
+        return step > 0 ? from < to : from > to;
+    }
+
+    /**
+     * @brief Advances the index of the innermost DO LOOP.
+     * @param environment The execution environment.
+     * @return Whether the body runs again.
+     */
+    bool NextIteration(Environment& environment) {
+        auto& frame = environment.loops.back();
+        frame.index += frame.step;
+        return frame.step > 0 ? frame.index < frame.to : frame.index > frame.to;
+    }
+
+    /**
+     * @brief Returns the native code of the word at the given address, compiling it once it is hot.
+     * @param environment The execution environment, whose native words must not nest too deeply.
+     * @param entry The entry address of the word.
+     * @return The compiled word, or nullptr if it is interpreted.
+     */
+    JitFunction NativeCode(Environment& environment, size_t entry) {
+        if (!jit_ || environment.native_depth >= kMaxNativeDepth) {
+            return nullptr;
+        }
+        auto function = native_[entry].load(std::memory_order_acquire);
+        // exactly one thread sees the count reach the threshold
+        if (function == nullptr && call_counts_[entry].fetch_add(1, std::memory_order_relaxed) + 1 == jit_threshold_) {
+            function = Compile(entry);
+        }
+        return function;
+    }
+
+    /**
+     * @brief Compiles the word at the given address and publishes it to all threads.
+     * @param entry The entry address of the word.
+     * @return The compiled word, or nullptr if it cannot be compiled.
+     */
+    JitFunction Compile(size_t entry);
+
+    /**
+     * @brief Runs a compiled word and rethrows what it threw.
+     * @param environment The execution environment.
+     * @param function The compiled word.
+     */
+    void RunNative(Environment& environment, JitFunction function);
+
+    /**
+     * @brief Calls the word at the given address, natively if it is compiled.
+     * @param environment The execution environment.
+     * @param entry The entry address of the word.
+     */
+    void CallWord(Environment& environment, size_t entry);
+
+    BytecodeProgram program_; ///< The program being executed, changed only to fill in the handlers.
+    std::once_flag threaded_; ///< Fills in the instruction handlers on the first run.
+    std::atomic<bool> handlers_filled_ = false; ///< Set once the handlers point into the loop of engine_.
+    std::vector<CaseTable<int32_t>> switches_; ///< Lookup tables built from program_.switches.
+    Engine engine_ = Engine::kStack; ///< The selected dispatch loop.
+    std::unique_ptr<JitCompiler> jit_;  ///< The native code compiler, null if the JIT is disabled.
+    uint32_t jit_threshold_ = 0;        ///< The number of calls after which a word is compiled.
+    std::unique_ptr<std::atomic<uint32_t>[]> call_counts_; ///< Number of calls per entry address.
+    std::unique_ptr<std::atomic<JitFunction>[]> native_;   ///< Compiled word per entry address.
+    std::mutex jit_mutex_;                                 ///< Serializes compilations.
+};
+
+#endif //VIRTUALMACHINE_H
@@ -23,3 +23,7 @@ Executable::ReturnStatus While::Execute(Environment& environment) {
     }
     return ReturnStatus::kSuccess;
 }
+
+void While::Accept(ExecutableVisitor& visitor) {
+    visitor.Visit(*this);
+}
@@ -0,0 +1,130 @@
+#include "WorkStealingPool.h"
+#include <algorithm>
+#include <chrono>
+
+namespace {
+
+// The pool and queue of the current worker thread, so that batches started by a task stay on its queue.
+thread_local WorkStealingPool* current_pool = nullptr;
+thread_local size_t current_queue = 0;
+
+} // namespace
+
+WorkStealingPool::WorkStealingPool(size_t threads) {
+    for (size_t i = 0; i < std::max<size_t>(threads, 1); ++i) {
+        queues_.push_back(std::make_unique<Queue>());
+    }
+    for (size_t i = 0; i < threads; ++i) {
+        threads_.emplace_back(&WorkStealingPool::Work, this, i);
+    }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    {
+        std::lock_guard lock(sleep_mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    for (auto& thread : threads_) {
+        thread.join();
+    }
+}
+
+WorkStealingPool& WorkStealingPool::Shared() {
+    static WorkStealingPool pool(std::max(std::thread::hardware_concurrency(), 1u) - 1);
+    return pool;
+}
+
+void WorkStealingPool::Run(size_t count, const std::function<void(size_t)>& task) {
+    if (count == 0) {
+        return;
+    }
+    Batch batch;
+    batch.task = &task;
+    batch.pending = count;
+    bool worker = current_pool == this;
+    size_t home = worker ? current_queue : 0;
+    for (size_t i = 0; i < count; ++i) {
+        // a worker keeps its tasks for itself until others steal them; other threads spread them out
+        auto& queue = *queues_[worker ? home : i % queues_.size()];
+        std::lock_guard lock(queue.mutex);
+        queue.tasks.push_back({&batch, i});
+    }
+    {
+        std::lock_guard lock(sleep_mutex_);
+        queued_ += count;
+    }
+    wake_.notify_all();
+    while (batch.pending > 0) {
+        if (RunOne(home)) {
+            continue;
+        }
+        // the remaining tasks are running; wake up now and then to help with tasks they start
+        std::unique_lock lock(batch.mutex);
+        batch.finished.wait_for(lock, std::chrono::milliseconds(1), [&] {
+            return batch.pending == 0;
+        });
+    }
+    // the last task may still hold the mutex while notifying
+    std::lock_guard lock(batch.mutex);
+    if (batch.error) {
+        std::rethrow_exception(batch.error);
+    }
+}
+
+bool WorkStealingPool::RunOne(size_t home) {
+    for (size_t i = 0; i < queues_.size(); ++i) {
+        auto& queue = *queues_[(home + i) % queues_.size()];
+        Task task;
+        {
+            std::lock_guard lock(queue.mutex);
+            if (queue.tasks.empty()) {
+                continue;
+            }
+            if (i == 0) {
+                task = queue.tasks.back();
+                queue.tasks.pop_back();
+            } else {
+                task = queue.tasks.front();
+                queue.tasks.pop_front();
+            }
+        }
+        --queued_;
+        Finish(task);
+        return true;
+    }
+    return false;
+}
+
+void WorkStealingPool::Finish(const Task& task) {
+    auto& batch = *task.batch;
+    try {
+        (*batch.task)(task.index);
+    } catch (...) {
+        std::lock_guard lock(batch.mutex);
+        if (!batch.error) {
+            batch.error = std::current_exception();
+        }
+    }
+    std::lock_guard lock(batch.mutex);
+    if (--batch.pending == 0) {
+        batch.finished.notify_all();
+    }
+}
+
+void WorkStealingPool::Work(size_t id) {
+    current_pool = this;
+    current_queue = id;
+    while (true) {
+        if (RunOne(id)) {
+            continue;
+        }
+        std::unique_lock lock(sleep_mutex_);
+        wake_.wait(lock, [&] {
+            return stopping_ || queued_ > 0;
+        });
+        if (stopping_ && queued_ == 0) {
+            return;
+        }
+    }
+}
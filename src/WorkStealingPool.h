@@ -0,0 +1,117 @@
+/**
+ * @file WorkStealingPool.h
+ * @brief Defines the WorkStealingPool class running batches of tasks on worker threads.
+ */
+
+#ifndef WORKSTEALINGPOOL_H
+#define WORKSTEALINGPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @class WorkStealingPool
+ * @brief A fixed set of threads, each with its own queue of tasks, that take tasks from each other when idle.
+ *
+ * A thread takes the newest task of its own queue and steals the oldest task of another queue.
+ * The thread waiting for a batch runs tasks too, so batches may be started from inside a task
+ * without tying up a worker.
+ */
+class WorkStealingPool {
+public:
+    /**
+     * @brief Starts the worker threads.
+     * @param threads The number of worker threads besides the threads starting batches.
+     */
+    explicit WorkStealingPool(size_t threads);
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    /**
+     * @brief Stops the worker threads once their queues are empty.
+     */
+    ~WorkStealingPool();
+
+    /**
+     * @brief Returns the pool shared by the whole process, with one thread per hardware thread beyond the first.
+     */
+    static WorkStealingPool& Shared();
+
+    /**
+     * @brief Returns the number of worker threads.
+     */
+    size_t Threads() const {
+        return threads_.size();
+    }
+
+    /**
+     * @brief Runs task(0) to task(count - 1), possibly in parallel, and returns when all have finished.
+     * @param count The number of tasks.
+     * @param task The function run for every task number.
+     * @throws Whatever the first failing task threw, after all tasks have finished.
+     */
+    void Run(size_t count, const std::function<void(size_t)>& task);
+
+private:
+    /**
+     * @brief A batch of tasks started by one call of Run.
+     */
+    struct Batch {
+        const std::function<void(size_t)>* task; ///< The function run for every task number.
+        std::atomic<size_t> pending;             ///< Number of tasks not finished yet.
+        std::exception_ptr error;                ///< What the first failing task threw.
+        std::mutex mutex;                        ///< Guards error and the wait for the last task.
+        std::condition_variable finished;        ///< Signalled when pending drops to zero.
+    };
+
+    /**
+     * @brief One task waiting in a queue.
+     */
+    struct Task {
+        Batch* batch; ///< The batch the task belongs to.
+        size_t index; ///< The task number passed to the function.
+    };
+
+    /**
+     * @brief The tasks owned by one thread.
+     */
+    struct Queue {
+        std::mutex mutex;       ///< Guards tasks.
+        std::deque<Task> tasks; ///< Oldest task first.
+    };
+
+    /**
+     * @brief Takes one task from the given queue or steals one from another queue and runs it.
+     * @param home The queue of the calling thread.
+     * @return Whether a task was run.
+     */
+    bool RunOne(size_t home);
+
+    /**
+     * @brief Runs a task and records its completion in its batch.
+     */
+    static void Finish(const Task& task);
+
+    /**
+     * @brief The loop of worker thread number id.
+     */
+    void Work(size_t id);
+
+    std::vector<std::unique_ptr<Queue>> queues_; ///< One queue per worker thread, at least one.
+    std::vector<std::thread> threads_;           ///< The worker threads.
+    std::mutex sleep_mutex_;                     ///< Guards queued_ changes that idle workers wait for.
+    std::condition_variable wake_;               ///< Signalled when tasks are queued or the pool stops.
+    std::atomic<size_t> queued_ = 0;             ///< Number of tasks in all queues.
+    bool stopping_ = false;                      ///< Set when the pool is destroyed.
+};
+
+#endif //WORKSTEALINGPOOL_H
@@ -1,104 +1,118 @@
+#include <chrono>
 #include <iostream>
 #include <stdexcept>
 #include <string>
 #include <fstream>
-#include <csignal>
-#include "Executable.h"
-#include "GrammaticalAnalyzer.h"
-#include "Preprocessor.h"
-#include "Parser.h"
-#include "Lexeme.h"
-#include "StackElement.h"
-int main() {
-    std::vector<std::string> keywords = {
-        "BEGIN",
-        "WHILE",
-        "REPEAT",
-        "DO",
-        "LOOP",
-        "IF",
-        "ENDIF",
-        "ELSE",
-        "CASE",
-        "OF",
-        "ENDOF",
-        "ENDCASE"
-    };
-
-    std::vector<std::string> operators = {
-        "dup",
-        "2dup",
-        "drop",
-        "swap",
-        "over",
-        "swap",
-        "rot",
-        "pick",
-        "nip",
-        "tuck",
-        "roll",
-        "+",
-        "s+",
-        "*",
-        "/",
-        "-",
-        "%",
-        "negate",
-        "invert",
-        "lshift",
-        "rshift",
-        "<",
-        ">",
-        "<=",
-        ">=",
-        "=",
-        "s=",
-        "and",
-        "or",
-        "xor",
-        "not",
-        "!",
-        "f!",
-        "c!",
-        "@",
-        "c@",
-        "f@",
-        "sinput",
-        "finput",
-        "input",
-        "type",
-        ".",
-        ".s",
-        "emit",
-        "leave",
-        "continue",
-        "VARIABLE",
-        "CREATE",
-        "allot",
-        "chars",
-        "floats",
-        "cells",
-        "tofloat",
-        "tocell",
-        "return"
-    };
-    /*
-    if (argc != 2) {
+#include "Compiler.h"
+#include "Repl.h"
+#include "CppEmitter.h"
+#include "Scheduler.h"
+int main(int argc, char* argv[]) {
+    CompilerOptions options;
+    bool print_jit = false; // --jit-report prints the words compiled to native code
+    size_t task_threads = 0; // --task-threads N runs tasks started by SPAWN on N threads, 0 for one per hardware thread
+    std::string cpp_file; // --emit-cpp FILE writes the program as C++ source instead of running it
+    std::string image_file; // --save-image FILE saves the compiled program as an image instead of running it
+    bool load_image = false; // --image runs an image saved with --save-image instead of source
+    bool interactive = false; // --repl reads and runs lines from the standard input after loading the file, if any
+    bool print_load_time = false; // --load-report prints how long compiling or loading the program took
+    std::string code_file;
+    for (int i = 1; i < argc; ++i) {
+        std::string argument(argv[i]);
+        if (argument == "--tree") {
+            options.use_tree_walker = true;
+        } else if (argument == "--stack-effects") {
+            options.report_stack_effects = true;
+        } else if (argument == "--inline-threshold" && i + 1 < argc) {
+            options.inline_threshold = std::stoi(argv[++i]);
+        } else if (argument == "--inline-report") {
+            options.report_inlining = true;
+        } else if (argument == "--no-fold") {
+            options.fold_constants = false;
+        } else if (argument == "--no-fusion") {
+            options.fuse_instructions = false;
+        } else if (argument == "--emit-cpp" && i + 1 < argc) {
+            cpp_file = argv[++i];
+        } else if (argument == "--no-jit") {
+            options.use_jit = false;
+        } else if (argument == "--jit-threshold" && i + 1 < argc) {
+            options.jit_threshold = std::stoul(argv[++i]);
+        } else if (argument == "--jit-report") {
+            print_jit = true;
+        } else if (argument == "--huge-pages") {
+            options.use_huge_pages = true;
+        } else if (argument == "--tos-cache") {
+            options.cache_top_of_stack = true;
+        } else if (argument == "--fusion-report") {
+            options.report_fusions = true;
+        } else if (argument == "--save-image" && i + 1 < argc) {
+            image_file = argv[++i];
+        } else if (argument == "--image") {
+            load_image = true;
+        } else if (argument == "--repl") {
+            interactive = true;
+        } else if (argument == "--load-report") {
+            print_load_time = true;
+        } else if (argument == "--task-threads" && i + 1 < argc) {
+            task_threads = std::stoul(argv[++i]);
+        } else {
+            code_file = argument;
+        }
+    }
+    options.report = &std::cout;
+    Compiler compiler(options);
+    if (interactive) {
+        Repl repl(compiler);
+        if (!code_file.empty()) {
+            try {
+                repl.Load(code_file);
+            } catch (std::exception& e) {
+                std::cout << e.what() << '\n';
+            }
+        }
+        repl.Run(std::cin, std::cout);
+        return 0;
+    }
+    if (code_file.empty()) {
         throw std::logic_error("number of command line arguments arguments doesn't match");
     }
-    */
-    const std::string code_file("C:\\Users\\vvzag\\CLionProjects\\forth_interpretator\\test.txt");
-    Preprocessor preprocessor(code_file);
-    preprocessor.RemoveComments();
-    std::string processed_string = preprocessor.GetCurrentText();
-
-
-    Parser parser(processed_string, keywords, operators);
-    auto lexemes = parser.GetResult();
-    GrammaticalAnalyzer grammatical_analyzer(lexemes, {";", "REPEAT", "LOOP", "ELSE", "ENDOF", ":", "ENDIF", "WHILE"});
-    grammatical_analyzer.Analyze();
+    auto start = std::chrono::steady_clock::now();
+    std::shared_ptr<Environment> environment;
+    if (!load_image) {
+        try {
+            environment = compiler.AnalyzeFile(code_file);
+        } catch (std::exception& e) {
+            std::cout << "Syntax error:\n" << e.what();
+            return 0;
+        }
+    }
+    if (!cpp_file.empty()) {
+        if (load_image) {
+            throw std::logic_error("images cannot be translated to C++");
+        }
+        std::ofstream cpp(cpp_file);
+        CppEmitter().Emit(*environment, code_file, cpp);
+        return 0;
+    }
     try {
-        grammatical_analyzer.resulting_environment.code->Execute(grammatical_analyzer.resulting_environment);
+        auto program = load_image ? compiler.LoadImage(code_file) : compiler.CompileAnalyzed(environment);
+        if (print_load_time) {
+            std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+            std::cout << (load_image ? "loaded image in " : "compiled in ") << elapsed.count() << " ms\n";
+        }
+        if (!image_file.empty()) {
+            program->SaveImage(image_file);
+            return 0;
+        }
+        auto context = program->NewContext();
+        if (task_threads > 0) {
+            context->scheduler->SetThreads(task_threads);
+        }
+        program->Run(*context);
+        context->scheduler->Run();
+        if (print_jit && program->machine()) {
+            program->machine()->ReportJit(std::cout);
+        }
     } catch (std::exception& e) {
         std::cout << e.what() << '\n';
     }